@@ -1,21 +1,160 @@
 #include "CloudsEngine.h"
+#include "EngineKernels.h"
+#include "PointerRelocation.h"
+#include "Semaphore.h"
 #include "clouds/dsp/granular_processor.h"
 #include "clouds/dsp/frame.h"
+#include "stmlib/utils/random.h"
 
 #include <algorithm>
 #include <cmath>
+#include <random>
+#include <vector>
 
-CloudsEngine::CloudsEngine() {}
-CloudsEngine::~CloudsEngine() {}
+namespace
+{
+    float ticksToMicros(int64_t ticks)
+    {
+        static const double microsPerTick = 1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+        return static_cast<float>(static_cast<double>(ticks) * microsPerTick);
+    }
+
+    // RMS of a FrameStats block, 1.0 = int16 full scale.
+    float statsToRms(const EngineKernels::FrameStats& stats, int numFrames)
+    {
+        if (numFrames <= 0)
+            return 0.0f;
+
+        return static_cast<float>(std::sqrt(static_cast<double>(stats.sumOfSquares) / (2.0 * numFrames)) / 32768.0);
+    }
+}
+
+//==============================================================================
+// Runs GranularProcessor::Prepare() off the audio thread.
+//
+// The worker and the audio thread hand the processor back and forth, so
+// Prepare() and Process() never run at the same time. At the end of a host
+// callback (endCallback()) the audio thread hands over the one Prepare()
+// still owed and posts the worker's semaphore; at the start of the next
+// callback it takes the processor back before touching it at all,
+// parameters, mode and quality included. Neither side ever waits for the
+// other: a request the worker has not started by then is withdrawn and run
+// on the audio thread, and while the worker is still in the middle of one
+// the audio thread leaves the processor alone and outputs silence.
+template <int BlockSize>
+class CloudsEngineT<BlockSize>::PrepareWorker : public juce::Thread
+{
+public:
+    explicit PrepareWorker(clouds::GranularProcessor& processor)
+        : juce::Thread("Clouds Prepare"), processor_(processor) {}
+
+    ~PrepareWorker() override
+    {
+        signalThreadShouldExit();
+        wakeUp_.post();
+        stopThread(1000);
+    }
+
+    enum class Reclaim { Done, Withdrawn, Busy };
+
+    // Audio thread: hand over the processor for one Prepare(). Lock-free.
+    void requestPrepare()
+    {
+        state_.store(kRequested, std::memory_order_release);
+        wakeUp_.post();
+    }
+
+    // Audio thread: try to take the processor back. Lock-free. Done if the
+    // worker had finished (or had nothing to do), Withdrawn if it had not
+    // started, so the Prepare() is still owed, Busy if it is running it
+    // and still owns the processor.
+    Reclaim reclaim()
+    {
+        auto expected = kRequested;
+        if (state_.compare_exchange_strong(expected, kIdle, std::memory_order_acquire))
+            return Reclaim::Withdrawn;
+
+        return expected == kIdle ? Reclaim::Done : Reclaim::Busy;
+    }
+
+    bool isBusy() const { return state_.load(std::memory_order_acquire) != kIdle; }
+
+    // Any thread but the audio thread, while it is not processing: lets an
+    // outstanding request finish, e.g. before the processor is copied.
+    void waitUntilIdle() const
+    {
+        while (state_.load(std::memory_order_acquire) != kIdle)
+            juce::Thread::yield();
+    }
+
+    // Time spent in Prepare() since the last call, for telemetry.
+    float takePrepareMicros() { return prepareMicros_.exchange(0.0f, std::memory_order_relaxed); }
+
+    void run() override
+    {
+        for (;;)
+        {
+            wakeUp_.wait();
+            if (threadShouldExit())
+                return;
+
+            // A withdrawn request leaves nothing to do.
+            auto expected = kRequested;
+            if (!state_.compare_exchange_strong(expected, kRunning, std::memory_order_acquire))
+                continue;
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor_.Prepare();
+            prepareMicros_.store(prepareMicros_.load(std::memory_order_relaxed)
+                                     + ticksToMicros(juce::Time::getHighResolutionTicks() - start),
+                                 std::memory_order_relaxed);
+
+            state_.store(kIdle, std::memory_order_release);
+        }
+    }
+
+private:
+    static constexpr int kIdle = 0;
+    static constexpr int kRequested = 1;
+    static constexpr int kRunning = 2;
+
+    clouds::GranularProcessor& processor_;
+    std::atomic<int> state_ { kIdle };
+    Semaphore wakeUp_;
+    std::atomic<float> prepareMicros_ { 0.0f };
+};
+
+//==============================================================================
+template <int BlockSize>
+CloudsEngineT<BlockSize>::CloudsEngineT()
+{
+    // Same hold and smoothing time in seconds at any block size. Smoothing
+    // steps once per Process() call of kProcessBlockSize frames, which come
+    // kProcessBlockSize / 32 times as far apart as the hardware's, so each
+    // step moves (1 - kSmoothingCoeff) to that power.
+    idleHoldBlocks_ = static_cast<int>(kIdleHoldSeconds * kSampleRate / kBlockSize);
+    smoothingCoeff_ = static_cast<float>(1.0 - std::pow(1.0 - kSmoothingCoeff, kProcessBlockSize / 32.0));
+}
+template <int BlockSize>
+CloudsEngineT<BlockSize>::~CloudsEngineT() {}
 
-void CloudsEngine::init()
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::init()
 {
+    // The worker holds a reference to the processor we are about to replace.
+    prepareWorker_.reset();
+
     largeBuffer_ = std::make_unique<uint8_t[]>(kLargeBufferSize);
     smallBuffer_ = std::make_unique<uint8_t[]>(kSmallBufferSize);
 
     std::memset(largeBuffer_.get(), 0, kLargeBufferSize);
     std::memset(smallBuffer_.get(), 0, kSmallBufferSize);
 
+    if (compensationRing_ == nullptr)
+        compensationRing_.reset(new int16_t[2 * kCompensationRingSize]);
+    std::fill(compensationRing_.get(), compensationRing_.get() + 2 * kCompensationRingSize, int16_t(0));
+    compensationWrite_ = 0;
+
     processor_ = std::make_unique<clouds::GranularProcessor>();
     processor_->Init(
         largeBuffer_.get(), kLargeBufferSize,
@@ -36,38 +175,544 @@ void CloudsEngine::init()
     p->stereo_spread = 0.0f;
     p->feedback = 0.0f;
     p->reverb = 0.0f;
-    p->freeze = false;
+    p->freeze = pendingFreeze_;
     p->trigger = false;
     p->gate = false;
 
+    // Smoothing starts from the values above, not from a previous run.
+    smoothedPosition_ = p->position;
+    smoothedSize_ = p->size;
+    smoothedPitch_ = p->pitch;
+    smoothedDensity_ = p->density;
+    smoothedTexture_ = p->texture;
+    smoothedDryWet_ = p->dry_wet;
+    smoothedSpread_ = p->stereo_spread;
+    smoothedFeedback_ = p->feedback;
+    smoothedReverb_ = p->reverb;
+
+    // Mode and quality from pendingParameters_ are applied by the first
+    // process() call; record what the processor holds right now.
+    controlEvents_.reset();
+    appliedPlaybackMode_ = clouds::PLAYBACK_MODE_GRANULAR;
+    appliedQuality_ = 0;
+
     // Init() 後 previous_playback_mode_ = PLAYBACK_MODE_LAST のため
     // 最初の数ブロックは Process() がゼロ出力する。
     // VCV Rack と同様に、Granular モードで空回しして状態を安定させる。
+    // (10 x 32 frames, whatever the block size)
+    // The warm-up draws from a fixed seed, so every init() leaves the
+    // processor in the same state (TraceReader relies on it), and the
+    // global random stream is left where it was.
     {
-        clouds::ShortFrame dummyIn[kBlockSize] = {};
-        clouds::ShortFrame dummyOut[kBlockSize] = {};
-        for (int i = 0; i < 10; ++i) {
+        const uint32_t seed = stmlib::Random::state();
+        stmlib::Random::Seed(kInitSeed);
+
+        clouds::ShortFrame dummyIn[kProcessBlockSize] = {};
+        clouds::ShortFrame dummyOut[kProcessBlockSize] = {};
+        for (int i = 0; i < 10 * 32 / kProcessBlockSize; ++i) {
             processor_->Prepare();
-            processor_->Process(dummyIn, dummyOut, kBlockSize);
+            processor_->Process(dummyIn, dummyOut, kProcessBlockSize);
         }
+
+        stmlib::Random::Seed(seed);
     }
 
+    prepareOverruns_.store(0, std::memory_order_relaxed);
+    telemetry_.reset();
+    telemetryBlockIndex_ = 0;
+    idle_ = false;
+    silentBlocks_ = 0;
+    preparePending_ = false;
+    processedInCallback_ = false;
     initialised_ = true;
+    freshlyInitialised_ = true;
+
+    updatePrepareWorker();
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::setPrepareMode(PrepareMode mode)
+{
+    prepareMode_ = mode;
+    preparePending_ = false;
+    processedInCallback_ = false;
+    updatePrepareWorker();
 }
 
-void CloudsEngine::process(const float* inputL, const float* inputR,
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::updatePrepareWorker()
+{
+    prepareWorker_.reset();
+
+    if (prepareMode_ == PrepareMode::Worker && processor_ != nullptr)
+    {
+        prepareWorker_ = std::make_unique<PrepareWorker>(*processor_);
+        prepareWorker_->startThread(juce::Thread::Priority::high);
+    }
+}
+
+//==============================================================================
+// Snapshot blob layout: SnapshotHeader, GranularProcessor bytes, large buffer,
+// small buffer.
+//
+// GranularProcessor is a plain C++ object (VCV Rack memsets it before Init),
+// but it stores absolute pointers into the two DSP buffers and into itself.
+// Only those members are rebased on restore, found by offset in
+// getProcessorPointers(); every other word is copied as is, whatever its value.
+// That includes pointers into the binary's own tables (the STFT window and
+// other lookup tables in clouds/resources.cc), which are only valid in the
+// process that took the snapshot, so the header carries a token of that
+// process and restoring anywhere else is refused.
+namespace
+{
+    // Random per process, so that a blob from another process (or an
+    // earlier run of this one) never matches.
+    uint64_t getProcessToken()
+    {
+        static const uint64_t token = []
+        {
+            std::random_device device;
+            return (static_cast<uint64_t>(device()) << 32) ^ device()
+                 ^ static_cast<uint64_t>(juce::Time::getHighResolutionTicks());
+        }();
+        return token;
+    }
+}
+
+template <int BlockSize>
+struct CloudsEngineT<BlockSize>::SnapshotHeader
+{
+    static constexpr uint32_t kMagic = 0x4e534c43;  // "CLSN"
+    static constexpr uint32_t kVersion = 7;
+
+    uint32_t magic = kMagic;
+    uint32_t version = kVersion;
+    uint32_t processorSize = sizeof(clouds::GranularProcessor);
+    uint32_t largeBufferSize = static_cast<uint32_t>(kLargeBufferSize);
+    uint32_t smallBufferSize = static_cast<uint32_t>(kSmallBufferSize);
+    int32_t hostDryWet = 0;
+    uint64_t processToken = getProcessToken();
+
+    uint64_t processorBase = 0;
+    uint64_t largeBufferBase = 0;
+    uint64_t smallBufferBase = 0;
+
+    EngineParameters targets;
+    int32_t appliedPlaybackMode = 0;
+    int32_t appliedQuality = 0;
+    float smoothed[9] = {};
+};
+
+namespace
+{
+    // Offsets of the GranularProcessor's pointer members. Two processors
+    // are built side by side over their own buffers and stepped through
+    // every playback mode and quality, so that members only set by
+    // Prepare() in one of them show up too. Prepare() rebuilds the mode's
+    // state whenever the mode or quality changes, so the twins are only
+    // initialised once and run two blocks per configuration. Not
+    // realtime-safe.
+    std::vector<uint32_t> findProcessorPointers(size_t largeBufferSize, size_t smallBufferSize)
+    {
+        struct Twin
+        {
+            std::unique_ptr<clouds::GranularProcessor> processor;
+            std::unique_ptr<uint8_t[]> large;
+            std::unique_ptr<uint8_t[]> small;
+        };
+
+        Twin twins[2];
+        PointerRelocation::Block blocks[2][3];
+
+        for (int t = 0; t < 2; ++t)
+        {
+            twins[t].processor = std::make_unique<clouds::GranularProcessor>();
+            twins[t].large.reset(new uint8_t[largeBufferSize]);
+            twins[t].small.reset(new uint8_t[smallBufferSize]);
+            blocks[t][0] = { reinterpret_cast<uintptr_t>(twins[t].processor.get()), sizeof(clouds::GranularProcessor) };
+            blocks[t][1] = { reinterpret_cast<uintptr_t>(twins[t].large.get()), largeBufferSize };
+            blocks[t][2] = { reinterpret_cast<uintptr_t>(twins[t].small.get()), smallBufferSize };
+
+            std::memset(static_cast<void*>(twins[t].processor.get()), 0, sizeof(clouds::GranularProcessor));
+            std::memset(twins[t].large.get(), 0, largeBufferSize);
+            std::memset(twins[t].small.get(), 0, smallBufferSize);
+
+            auto& processor = *twins[t].processor;
+            processor.Init(twins[t].large.get(), largeBufferSize, twins[t].small.get(), smallBufferSize);
+            processor.set_bypass(false);
+            processor.set_silence(false);
+        }
+
+        // Both twins draw the same grains; the engines' own random stream
+        // is left where it was.
+        const uint32_t seed = stmlib::Random::state();
+        std::vector<uint32_t> offsets;
+
+        for (int mode = 0; mode < clouds::PLAYBACK_MODE_LAST; ++mode)
+        {
+            for (int quality = 0; quality < 4; ++quality)
+            {
+                for (int t = 0; t < 2; ++t)
+                {
+                    auto& processor = *twins[t].processor;
+                    processor.set_playback_mode(static_cast<clouds::PlaybackMode>(mode));
+                    processor.set_quality(quality);
+
+                    stmlib::Random::Seed(seed);
+                    clouds::ShortFrame in[32] = {};
+                    clouds::ShortFrame out[32] = {};
+                    for (int i = 0; i < 2; ++i)
+                    {
+                        processor.Prepare();
+                        processor.Process(in, out, 32);
+                    }
+                }
+
+                PointerRelocation::merge(offsets,
+                    PointerRelocation::findPointers(twins[0].processor.get(), blocks[0],
+                                                    twins[1].processor.get(), blocks[1],
+                                                    sizeof(clouds::GranularProcessor), 3));
+            }
+        }
+
+        stmlib::Random::Seed(seed);
+        return offsets;
+    }
+}
+
+template <int BlockSize>
+const std::vector<uint32_t>& CloudsEngineT<BlockSize>::getProcessorPointers()
+{
+    static const std::vector<uint32_t> pointers = findProcessorPointers(kLargeBufferSize, kSmallBufferSize);
+    return pointers;
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::fillSnapshotHeader(SnapshotHeader& header) const
+{
+    header.hostDryWet = hostDryWet_ ? 1 : 0;
+    header.processorBase = reinterpret_cast<uintptr_t>(processor_.get());
+    header.largeBufferBase = reinterpret_cast<uintptr_t>(largeBuffer_.get());
+    header.smallBufferBase = reinterpret_cast<uintptr_t>(smallBuffer_.get());
+    header.targets = pendingParameters_;
+    header.appliedPlaybackMode = appliedPlaybackMode_;
+    header.appliedQuality = appliedQuality_;
+
+    const float smoothed[] = { smoothedPosition_, smoothedSize_, smoothedPitch_, smoothedDensity_, smoothedTexture_,
+                               smoothedDryWet_, smoothedSpread_, smoothedFeedback_, smoothedReverb_ };
+    std::memcpy(header.smoothed, smoothed, sizeof(smoothed));
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::captureSnapshot(juce::MemoryBlock& destData) const
+{
+    destData.reset();
+    if (!initialised_)
+        return;
+
+    // A Prepare() still running on the worker would tear the copy.
+    if (prepareWorker_ != nullptr)
+        prepareWorker_->waitUntilIdle();
+
+    SnapshotHeader header;
+    fillSnapshotHeader(header);
+
+    destData.append(&header, sizeof(header));
+    destData.append(processor_.get(), sizeof(clouds::GranularProcessor));
+    destData.append(largeBuffer_.get(), kLargeBufferSize);
+    destData.append(smallBuffer_.get(), kSmallBufferSize);
+}
+
+template <int BlockSize>
+bool CloudsEngineT<BlockSize>::restoreSnapshot(const void* data, size_t sizeInBytes)
+{
+    SnapshotHeader header;
+    const size_t expectedSize = sizeof(header) + sizeof(clouds::GranularProcessor)
+                              + kLargeBufferSize + kSmallBufferSize;
+
+    if (data == nullptr || sizeInBytes != expectedSize)
+        return false;
+
+    std::memcpy(&header, data, sizeof(header));
+
+    const auto* bytes = static_cast<const uint8_t*>(data) + sizeof(header);
+    const auto* processorBytes = bytes;
+    const auto* largeBytes = processorBytes + sizeof(clouds::GranularProcessor);
+    const auto* smallBytes = largeBytes + kLargeBufferSize;
+
+    return restoreState(header, processorBytes, largeBytes, smallBytes);
+}
+
+template <int BlockSize>
+bool CloudsEngineT<BlockSize>::cloneFrom(const CloudsEngineT& golden)
+{
+    if (&golden == this || !golden.initialised_)
+        return false;
+
+    if (golden.prepareWorker_ != nullptr)
+        golden.prepareWorker_->waitUntilIdle();
+
+    SnapshotHeader header;
+    golden.fillSnapshotHeader(header);
+
+    return restoreState(header,
+                        reinterpret_cast<const uint8_t*>(golden.processor_.get()),
+                        golden.largeBuffer_.get(),
+                        golden.smallBuffer_.get());
+}
+
+template <int BlockSize>
+bool CloudsEngineT<BlockSize>::restoreState(const SnapshotHeader& header, const uint8_t* processorBytes,
+                                const uint8_t* largeBytes, const uint8_t* smallBytes)
+{
+    const SnapshotHeader current;
+    if (header.magic != current.magic || header.version != current.version
+        || header.processToken != current.processToken
+        || header.processorSize != current.processorSize
+        || header.largeBufferSize != current.largeBufferSize
+        || header.smallBufferSize != current.smallBufferSize)
+        return false;
+
+    // Every pointer member must point into one of the snapshot's own blocks
+    // before anything here is touched.
+    const auto& pointers = getProcessorPointers();
+    const PointerRelocation::Block sourceBlocks[] = {
+        { static_cast<uintptr_t>(header.processorBase), sizeof(clouds::GranularProcessor) },
+        { static_cast<uintptr_t>(header.largeBufferBase), kLargeBufferSize },
+        { static_cast<uintptr_t>(header.smallBufferBase), kSmallBufferSize },
+    };
+    if (!PointerRelocation::validate(processorBytes, sizeof(clouds::GranularProcessor),
+                                     pointers.data(), pointers.size(), sourceBlocks, 3))
+        return false;
+
+    prepareWorker_.reset();
+
+    // Buffers are overwritten wholesale, so unlike init() there is no memset.
+    if (largeBuffer_ == nullptr)
+        largeBuffer_.reset(new uint8_t[kLargeBufferSize]);
+    if (smallBuffer_ == nullptr)
+        smallBuffer_.reset(new uint8_t[kSmallBufferSize]);
+    if (processor_ == nullptr)
+        processor_ = std::make_unique<clouds::GranularProcessor>();
+
+    // The compensation history is not part of the snapshot; it starts silent.
+    if (compensationRing_ == nullptr)
+        compensationRing_.reset(new int16_t[2 * kCompensationRingSize]);
+    std::fill(compensationRing_.get(), compensationRing_.get() + 2 * kCompensationRingSize, int16_t(0));
+    compensationWrite_ = 0;
+
+    std::memcpy(largeBuffer_.get(), largeBytes, kLargeBufferSize);
+    std::memcpy(smallBuffer_.get(), smallBytes, kSmallBufferSize);
+
+    auto* processorDest = reinterpret_cast<uint8_t*>(processor_.get());
+    std::memcpy(processorDest, processorBytes, sizeof(clouds::GranularProcessor));
+
+    const PointerRelocation::Block destBlocks[] = {
+        { reinterpret_cast<uintptr_t>(processorDest), sizeof(clouds::GranularProcessor) },
+        { reinterpret_cast<uintptr_t>(largeBuffer_.get()), kLargeBufferSize },
+        { reinterpret_cast<uintptr_t>(smallBuffer_.get()), kSmallBufferSize },
+    };
+    PointerRelocation::relocate(processorDest, pointers.data(), pointers.size(), sourceBlocks, destBlocks, 3);
+
+    hostDryWet_ = header.hostDryWet != 0;
+    appliedPlaybackMode_ = header.appliedPlaybackMode;
+    appliedQuality_ = header.appliedQuality;
+
+    pendingParameters_ = header.targets;
+    pendingFreeze_ = processor_->mutable_parameters()->freeze;
+    controlEvents_.reset();
+    publishParameters();
+
+    float* smoothed[] = { &smoothedPosition_, &smoothedSize_, &smoothedPitch_, &smoothedDensity_, &smoothedTexture_,
+                          &smoothedDryWet_, &smoothedSpread_, &smoothedFeedback_, &smoothedReverb_ };
+    for (size_t i = 0; i < 9; ++i)
+        *smoothed[i] = header.smoothed[i];
+
+    prepareOverruns_.store(0, std::memory_order_relaxed);
+    telemetry_.reset();
+    telemetryBlockIndex_ = 0;
+    idle_ = false;
+    silentBlocks_ = 0;
+    preparePending_ = false;
+    processedInCallback_ = false;
+    initialised_ = true;
+    freshlyInitialised_ = false;
+
+    updatePrepareWorker();
+    return true;
+}
+
+template <int BlockSize>
+int CloudsEngineT<BlockSize>::getLatencySamples() const
+{
+    return getLatencySamplesForMode(pendingParameters_.playbackMode);
+}
+
+template <int BlockSize>
+int CloudsEngineT<BlockSize>::getLatencySamplesForMode(int playbackMode) const
+{
+    // Only the last Process() call of a block waits for a later Prepare();
+    // the pieces before it have theirs run in between.
+    const int prepareLatency = prepareMode_ == PrepareMode::Inline ? 0 : kProcessBlockSize;
+    const int modeLatency = latencyCompensation_ ? kMaxModeLatencySamples
+                                                 : getModeLatencySamples(playbackMode);
+    return prepareLatency + modeLatency;
+}
+
+template <int BlockSize>
+int CloudsEngineT<BlockSize>::getModeLatencySamples(int playbackMode)
+{
+    // The phase vocoder resynthesises 4096-sample STFT frames (the
+    // phase_vocoder_.Init() call in GranularProcessor::Prepare() passes
+    // lut_sine_window_4096 and 4096, with a hop of a quarter frame), so
+    // its output trails the input by one frame. AudioProcessingTests
+    // measures it against the real processor. Granular, stretch and looping delay
+    // read the recording buffer wherever POSITION and SIZE put them; that
+    // is a musical choice, not a fixed delay, so there is nothing to report.
+    return playbackMode == clouds::PLAYBACK_MODE_SPECTRAL ? kSpectralLatencySamples : 0;
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::compensateModeLatency(int16_t* frames)
+{
+    constexpr uint32_t mask = kCompensationRingSize - 1;
+    const auto delay = static_cast<uint32_t>(kMaxModeLatencySamples - getModeLatencySamples(appliedPlaybackMode_));
+    int16_t* ring = compensationRing_.get();
+
+    // Written before it is read, so a zero delay passes the block through.
+    for (uint32_t i = 0; i < static_cast<uint32_t>(kBlockSize); ++i)
+    {
+        const uint32_t write = 2 * ((compensationWrite_ + i) & mask);
+        const uint32_t read = 2 * ((compensationWrite_ + i - delay) & mask);
+
+        ring[write] = frames[2 * i];
+        ring[write + 1] = frames[2 * i + 1];
+        frames[2 * i] = ring[read];
+        frames[2 * i + 1] = ring[read + 1];
+    }
+
+    compensationWrite_ = (compensationWrite_ + kBlockSize) & mask;
+}
+
+template <int BlockSize>
+bool CloudsEngineT<BlockSize>::isPrepareInFlight() const
+{
+    return prepareWorker_ != nullptr && prepareWorker_->isBusy();
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::runDeferredPrepare()
+{
+    if (!preparePending_ || processor_ == nullptr)
+        return;
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    processor_->Prepare();
+    deferredPrepareMicros_ += ticksToMicros(juce::Time::getHighResolutionTicks() - start);
+    preparePending_ = false;
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::endCallback()
+{
+    const bool processed = processedInCallback_;
+    processedInCallback_ = false;
+
+    // Worker mode: the Prepare() still owed runs on the worker until the
+    // next callback. Nothing is owed while the worker still has the last
+    // one.
+    if (prepareWorker_ != nullptr)
+    {
+        if (preparePending_)
+        {
+            preparePending_ = false;
+            prepareWorker_->requestPrepare();
+        }
+        return;
+    }
+
+    // Deferred mode: a callback that completed no block runs the pending
+    // Prepare() instead, so small host buffers take turns rather than one
+    // of them carrying the whole block.
+    if (!processed)
+        runDeferredPrepare();
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::process(const float* inputL, const float* inputR,
                            float* outputL, float* outputR,
                            int numSamples)
 {
+    processBlocks(inputL, inputR, outputL, outputR, false, numSamples);
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::processInterleaved(const float* input, float* output, int numFrames)
+{
+    processBlocks(input, nullptr, output, nullptr, true, numFrames);
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::processBlocks(const float* inputL, const float* inputR,
+                                 float* outputL, float* outputR,
+                                 bool interleaved, int numSamples)
+{
+    auto clearOutput = [&](int offset, int count)
+    {
+        if (interleaved)
+        {
+            std::fill(outputL + 2 * offset, outputL + 2 * (offset + count), 0.0f);
+        }
+        else
+        {
+            std::fill(outputL + offset, outputL + offset + count, 0.0f);
+            std::fill(outputR + offset, outputR + offset + count, 0.0f);
+        }
+    };
+
     if (!initialised_ || processor_ == nullptr)
     {
-        std::fill(outputL, outputL + numSamples, 0.0f);
-        std::fill(outputR, outputR + numSamples, 0.0f);
+        clearOutput(0, numSamples);
         return;
     }
 
-    float peakD = 0.0f;
-    float peakE = 0.0f;
+    freshlyInitialised_ = false;
+
+    // Worker mode: take the processor back before anything touches it.
+    bool workerOverrun = false;
+    if (prepareWorker_ != nullptr)
+    {
+        const auto reclaimed = prepareWorker_->reclaim();
+        deferredPrepareMicros_ += prepareWorker_->takePrepareMicros();
+
+        if (reclaimed == PrepareWorker::Reclaim::Withdrawn)
+            preparePending_ = true;
+
+        if (reclaimed != PrepareWorker::Reclaim::Done)
+        {
+            prepareOverruns_.fetch_add(1, std::memory_order_relaxed);
+            workerOverrun = true;
+        }
+
+        // Still in Prepare(): the processor is not ours, so this call's
+        // blocks are silent. The next call tries again.
+        if (reclaimed == PrepareWorker::Reclaim::Busy)
+        {
+            for (int offset = 0; offset < numSamples; offset += kBlockSize)
+            {
+                TelemetryRecord record;
+                record.blockIndex = telemetryBlockIndex_++;
+                record.playbackMode = static_cast<uint8_t>(appliedPlaybackMode_);
+                record.quality = static_cast<uint8_t>(appliedQuality_);
+                record.flags = TelemetryRecord::kPrepareWorker | TelemetryRecord::kPrepareOverrun
+                             | TelemetryRecord::kPrepareDropped;
+                telemetry_.push(record);
+            }
+
+            clearOutput(0, numSamples);
+            return;
+        }
+    }
 
     int remaining = numSamples;
     int offset = 0;
@@ -75,105 +720,291 @@ void CloudsEngine::process(const float* inputL, const float* inputR,
     while (remaining > 0)
     {
         const int blockSize = std::min(remaining, kBlockSize);
+        const auto& params = pullParameters();
 
         clouds::ShortFrame inputFrames[kBlockSize];
         clouds::ShortFrame outputFrames[kBlockSize];
 
-        for (int i = 0; i < blockSize; ++i)
+        TelemetryRecord record;
+        record.blockIndex = telemetryBlockIndex_++;
+        record.playbackMode = static_cast<uint8_t>(appliedPlaybackMode_);
+        record.quality = static_cast<uint8_t>(appliedQuality_);
+
+        if (prepareWorker_ != nullptr)
         {
-            float l = inputL[offset + i] * inputTrim_;
-            float r = inputR[offset + i] * inputTrim_;
+            record.flags |= TelemetryRecord::kPrepareWorker;
+            if (workerOverrun)
+                record.flags |= TelemetryRecord::kPrepareOverrun;
+            workerOverrun = false;
+        }
 
-            l = std::max(-1.0f, std::min(1.0f, l));
-            r = std::max(-1.0f, std::min(1.0f, r));
+        // Engine input level (after trim, measured in float).
+        // The kernel zero-pads inputFrames up to kBlockSize.
+        record.inputPeak = interleaved
+            ? EngineKernels::convertInputClampedInterleaved(inputL + 2 * offset, params.inputTrim,
+                                                            &inputFrames[0].l, blockSize, kBlockSize)
+            : EngineKernels::convertInputClamped(inputL + offset, inputR + offset, params.inputTrim,
+                                                 &inputFrames[0].l, blockSize, kBlockSize);
 
-            inputFrames[i].l = static_cast<int16_t>(l * 32767.0f);
-            inputFrames[i].r = static_cast<int16_t>(r * 32767.0f);
+        const auto inputStats = EngineKernels::measureFrames(&inputFrames[0].l, blockSize);
+        record.inputRms = statsToRms(inputStats, blockSize);
+        record.inputClips = static_cast<uint16_t>(inputStats.clips);
 
-            // Meter D: engine input level (after trim, before int16 conversion is lossy, measure float)
-            float absV = (std::abs(l) + std::abs(r)) * 0.5f;
-            if (absV > peakD) peakD = absV;
+        if (processor_->mutable_parameters()->freeze)
+            record.flags |= TelemetryRecord::kFrozen;
+
+        if (idle_)
+        {
+            const auto& p = *processor_->mutable_parameters();
+            if (record.inputPeak > kIdleThreshold || p.trigger || p.freeze || !idleDetectionEnabled_)
+            {
+                idle_ = false;
+                silentBlocks_ = 0;
+            }
+            else
+            {
+                // Smoothing keeps moving, as if the processor were running.
+                for (int piece = 0; piece < kBlockSize; piece += kProcessBlockSize)
+                    applySmoothedParameters(params);
+
+                clearOutput(offset, blockSize);
+
+                record.flags |= TelemetryRecord::kIdle;
+                telemetry_.push(record);
+
+                offset += blockSize;
+                remaining -= blockSize;
+                continue;
+            }
         }
 
-        // Parameter smoothing (one-pole filter per block)
-        auto smooth = [](float& current, float target, float coeff) {
-            current += coeff * (target - current);
-        };
-        smooth(smoothedPosition_, targetPosition_, kSmoothingCoeff);
-        smooth(smoothedSize_, targetSize_, kSmoothingCoeff);
-        smooth(smoothedPitch_, targetPitch_, kSmoothingCoeff);
-        smooth(smoothedDensity_, targetDensity_, kSmoothingCoeff);
-        smooth(smoothedTexture_, targetTexture_, kSmoothingCoeff);
-        smooth(smoothedDryWet_, targetDryWet_, kSmoothingCoeff);
-        smooth(smoothedSpread_, targetSpread_, kSmoothingCoeff);
-        smooth(smoothedFeedback_, targetFeedback_, kSmoothingCoeff);
-        smooth(smoothedReverb_, targetReverb_, kSmoothingCoeff);
-
-        // Apply smoothed parameters to processor
-        auto* p = processor_->mutable_parameters();
-        p->position = smoothedPosition_;
-        p->size = smoothedSize_;
-        p->pitch = smoothedPitch_;
-        p->density = smoothedDensity_;
-        p->texture = smoothedTexture_;
-        p->dry_wet = smoothedDryWet_;
-        p->stereo_spread = smoothedSpread_;
-        p->feedback = smoothedFeedback_;
-        p->reverb = smoothedReverb_;
-
-        for (int i = blockSize; i < kBlockSize; ++i)
+        // The processor takes at most 32 frames per Process() call, and
+        // parameters are smoothed per call, as on the hardware. Process()
+        // writes every output frame, so outputFrames needs no pre-clear.
+        for (int piece = 0; piece < kBlockSize; piece += kProcessBlockSize)
         {
-            inputFrames[i].l = 0;
-            inputFrames[i].r = 0;
+            applySmoothedParameters(params);
+
+            clouds::ShortFrame* pieceInput = inputFrames + piece;
+            clouds::ShortFrame* pieceOutput = outputFrames + piece;
+
+            if (prepareMode_ != PrepareMode::Inline)
+            {
+                // The previous call's Prepare(), unless the worker or a
+                // callback that completed no block has already run it.
+                runDeferredPrepare();
+
+                const auto processStart = juce::Time::getHighResolutionTicks();
+                processor_->Process(pieceInput, pieceOutput, kProcessBlockSize);
+                record.processMicros += ticksToMicros(juce::Time::getHighResolutionTicks() - processStart);
+                record.prepareMicros += deferredPrepareMicros_;
+                deferredPrepareMicros_ = 0.0f;
+
+                processor_->mutable_parameters()->trigger = false;
+                preparePending_ = true;
+                processedInCallback_ = true;
+            }
+            else
+            {
+                // VCV Rack / ctag-tbd approach: Prepare 1回 → Process 1回
+                const auto prepareStart = juce::Time::getHighResolutionTicks();
+                processor_->Prepare();
+                const auto processStart = juce::Time::getHighResolutionTicks();
+                processor_->Process(pieceInput, pieceOutput, kProcessBlockSize);
+                const auto processEnd = juce::Time::getHighResolutionTicks();
+                processor_->mutable_parameters()->trigger = false;
+
+                record.prepareMicros += ticksToMicros(processStart - prepareStart);
+                record.processMicros += ticksToMicros(processEnd - processStart);
+            }
         }
 
-        std::memset(outputFrames, 0, sizeof(outputFrames));
+        if (latencyCompensation_)
+            compensateModeLatency(&outputFrames[0].l);
 
-        // VCV Rack / ctag-tbd approach: Prepare 1回 → Process 1回
-        processor_->Prepare();
-        processor_->Process(inputFrames, outputFrames, kBlockSize);
-        processor_->mutable_parameters()->trigger = false;
+        // Engine output level
+        record.outputPeak = interleaved
+            ? EngineKernels::convertOutputInterleaved(&outputFrames[0].l, params.outputGain,
+                                                      outputL + 2 * offset, blockSize)
+            : EngineKernels::convertOutput(&outputFrames[0].l, params.outputGain,
+                                           outputL + offset, outputR + offset, blockSize);
 
-        for (int i = 0; i < blockSize; ++i)
-        {
-            float outLf = static_cast<float>(outputFrames[i].l) / 32768.0f * outputGain_;
-            float outRf = static_cast<float>(outputFrames[i].r) / 32768.0f * outputGain_;
+        const auto outputStats = EngineKernels::measureFrames(&outputFrames[0].l, blockSize);
+        record.outputRms = statsToRms(outputStats, blockSize) * params.outputGain;
+        record.outputClips = static_cast<uint16_t>(outputStats.clips);
 
-            outputL[offset + i] = outLf;
-            outputR[offset + i] = outRf;
+        telemetry_.push(record);
 
-            // Meter E: engine output level
-            float absV = (std::abs(outLf) + std::abs(outRf)) * 0.5f;
-            if (absV > peakE) peakE = absV;
-        }
+        updateIdleState(record.inputPeak, record.outputPeak);
 
         offset += blockSize;
         remaining -= blockSize;
     }
+}
 
-    // Store meter values (lock-free)
-    if (meterD_) meterD_->store(peakD, std::memory_order_relaxed);
-    if (meterE_) meterE_->store(peakE, std::memory_order_relaxed);
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::updateIdleState(float blockPeakIn, float blockPeakOut)
+{
+    if (!idleDetectionEnabled_ || processor_->mutable_parameters()->freeze
+        || blockPeakIn > kIdleThreshold || blockPeakOut > kIdleThreshold)
+    {
+        silentBlocks_ = 0;
+        return;
+    }
+
+    if (++silentBlocks_ >= idleHoldBlocks_)
+        idle_ = true;
 }
 
-void CloudsEngine::setPlaybackMode(int mode)
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::setIdleDetectionEnabled(bool enabled)
 {
-    if (processor_ && mode >= 0 && mode < 4)
-        processor_->set_playback_mode(static_cast<clouds::PlaybackMode>(mode));
+    idleDetectionEnabled_ = enabled;
 }
 
-void CloudsEngine::setQuality(int quality)
+template <int BlockSize>
+bool CloudsEngineT<BlockSize>::isIdle() const
 {
-    if (processor_ && quality >= 0 && quality <= 3)
-        processor_->set_quality(quality);
+    if (!idle_ || processor_ == nullptr || controlEvents_.hasPending())
+        return false;
+
+    // A pending trigger or freeze wakes the engine on its next block.
+    const auto& params = *processor_->mutable_parameters();
+    return !params.trigger && !params.freeze;
 }
 
-void CloudsEngine::setFreeze(bool v)
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::publishParameters()
 {
-    if (processor_) processor_->mutable_parameters()->freeze = v;
+    parameterBuffer_.getWriteBuffer() = pendingParameters_;
+    parameterBuffer_.publish();
 }
 
-void CloudsEngine::setTrigger(bool v)
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::setParameters(const EngineParameters& parameters)
 {
-    if (processor_) processor_->mutable_parameters()->trigger = v;
+    pendingParameters_ = parameters;
+    publishParameters();
 }
+
+template <int BlockSize>
+const EngineParameters& CloudsEngineT<BlockSize>::peekParameters()
+{
+    parameterBuffer_.update();
+    return parameterBuffer_.read();
+}
+
+template <int BlockSize>
+const EngineParameters& CloudsEngineT<BlockSize>::pullParameters()
+{
+    // One coherent snapshot per engine block; if nothing new was published
+    // the previous one stays current.
+    parameterBuffer_.update();
+    const auto& params = parameterBuffer_.read();
+
+    // Both only take effect in Prepare(). If the one owed from the last
+    // Process() has already run (on the worker or in runDeferredPrepare()),
+    // run another before the next Process(), as Inline mode does, rather
+    // than output a silent block. Extra Prepare() calls are harmless: the
+    // hardware calls it in a loop.
+    const bool reconfigure = params.playbackMode != appliedPlaybackMode_ || params.quality != appliedQuality_;
+
+    if (params.playbackMode != appliedPlaybackMode_)
+    {
+        processor_->set_playback_mode(static_cast<clouds::PlaybackMode>(params.playbackMode));
+        appliedPlaybackMode_ = params.playbackMode;
+    }
+
+    if (params.quality != appliedQuality_)
+    {
+        processor_->set_quality(params.quality);
+        appliedQuality_ = params.quality;
+    }
+
+    if (reconfigure && prepareMode_ != PrepareMode::Inline)
+        preparePending_ = true;
+
+    auto* p = processor_->mutable_parameters();
+    controlEvents_.drain([p](const ControlEventQueue::Event& event)
+    {
+        if (event.type == ControlEventQueue::Event::Type::Freeze)
+            p->freeze = event.value;
+        else
+            p->trigger = p->trigger || event.value;
+    });
+
+    return params;
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::applySmoothedParameters(const EngineParameters& targets)
+{
+    // Parameter smoothing (one-pole filter per block)
+    auto smooth = [](float& current, float target, float coeff) {
+        current += coeff * (target - current);
+    };
+    smooth(smoothedPosition_, targets.position, smoothingCoeff_);
+    smooth(smoothedSize_, targets.size, smoothingCoeff_);
+    smooth(smoothedPitch_, targets.pitch, smoothingCoeff_);
+    smooth(smoothedDensity_, targets.density, smoothingCoeff_);
+    smooth(smoothedTexture_, targets.texture, smoothingCoeff_);
+    smooth(smoothedDryWet_, targets.dryWet, smoothingCoeff_);
+    smooth(smoothedSpread_, targets.stereoSpread, smoothingCoeff_);
+    smooth(smoothedFeedback_, targets.feedback, smoothingCoeff_);
+    smooth(smoothedReverb_, targets.reverb, smoothingCoeff_);
+
+    // Apply smoothed parameters to processor
+    auto* p = processor_->mutable_parameters();
+    p->position = smoothedPosition_;
+    p->size = smoothedSize_;
+    p->pitch = smoothedPitch_;
+    p->density = smoothedDensity_;
+    p->texture = smoothedTexture_;
+    p->dry_wet = hostDryWet_ ? 1.0f : smoothedDryWet_;
+    p->stereo_spread = smoothedSpread_;
+    p->feedback = smoothedFeedback_;
+    p->reverb = smoothedReverb_;
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::setPlaybackMode(int mode)
+{
+    if (mode >= 0 && mode < 4)
+    {
+        pendingParameters_.playbackMode = mode;
+        publishParameters();
+    }
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::setQuality(int quality)
+{
+    if (quality >= 0 && quality <= 3)
+    {
+        pendingParameters_.quality = quality;
+        publishParameters();
+    }
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::setFreeze(bool v)
+{
+    // Only state changes are queued. If the queue is full the change is
+    // retried on the next call.
+    if (v != pendingFreeze_ && controlEvents_.push({ ControlEventQueue::Event::Type::Freeze, v }))
+        pendingFreeze_ = v;
+}
+
+template <int BlockSize>
+void CloudsEngineT<BlockSize>::setTrigger(bool v)
+{
+    // Trigger is a one-block pulse that process() clears itself, so only
+    // the rising request needs to travel.
+    if (v && controlEvents_.push({ ControlEventQueue::Event::Type::Trigger, true }))
+        ++triggerCount_;
+}
+
+template class CloudsEngineT<16>;
+template class CloudsEngineT<32>;
+template class CloudsEngineT<64>;
+template class CloudsEngineT<128>;
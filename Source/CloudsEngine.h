@@ -3,50 +3,216 @@
 #include <memory>
 #include <cstring>
 #include <atomic>
+#include <vector>
 #include <juce_core/juce_core.h>
+#include "ParameterSnapshot.h"
+#include "EngineTelemetry.h"
 
 namespace clouds {
     class GranularProcessor;
 }
 
-class CloudsEngine
+// Wraps one GranularProcessor. BlockSize is the engine block: parameters,
+// telemetry, idle detection and the I/O conversion run once per block, and
+// SampleRateAdapterT<BlockSize> hands over whole blocks. The processor itself
+// still runs in kProcessBlockSize pieces (it takes at most 32 frames), with
+// the parameter smoothing stepped per piece, so the sound does not depend on
+// BlockSize. Larger blocks amortise the per-block work for offline and batch
+// rendering; smaller ones cut the direct path's latency. Instantiated for
+// 16, 32, 64 and 128; CloudsEngine is the hardware's 32.
+template <int BlockSize>
+class CloudsEngineT
 {
 public:
-    CloudsEngine();
-    ~CloudsEngine();
+    static_assert(BlockSize == 16 || BlockSize == 32 || BlockSize == 64 || BlockSize == 128,
+                  "CloudsEngineT is instantiated for 16, 32, 64 and 128 frames");
+
+    // Where GranularProcessor::Prepare() runs.
+    //  Inline   : Prepare() right before Process() on the audio thread (default)
+    //  Worker   : the Deferred schedule, with the Prepare() still owed at
+    //             the end of each host callback (endCallback()) run on a
+    //             dedicated thread until the next one, like the main loop /
+    //             audio interrupt split on the original hardware. The
+    //             processor is handed back and forth, so Prepare() and
+    //             Process() never overlap, and the audio thread never waits
+    //             or locks: a Prepare() the worker has not started is run
+    //             inline, and one it is still running silences the next
+    //             callback's blocks until it is done (getPrepareOverruns()).
+    //             Without endCallback() it behaves like Deferred.
+    //             Adds kProcessBlockSize samples of latency.
+    //  Deferred : Prepare() one Process() call behind, on the audio thread.
+    //             Prepare() for the last Process() call of a block runs in
+    //             endCallback() if the callback completed no block, or in
+    //             runDeferredPrepare(), otherwise right before the next
+    //             Process(). Lets small host buffers share the work of one
+    //             block. Same latency as Worker, and deterministic.
+    enum class PrepareMode { Inline, Worker, Deferred };
+
+    CloudsEngineT();
+    ~CloudsEngineT();
 
     void init();
 
+    // Rate the GranularProcessor runs at: the hardware's, which its grain
+    // sizes, delay lines and STFT size are counted in.
+    static constexpr double kSampleRate = 32000.0;
+    double getSampleRate() const { return kSampleRate; }
+
+    // Not realtime-safe: starts or stops the worker thread. Call from the
+    // message thread while the engine is not processing (e.g. prepareToPlay).
+    void setPrepareMode(PrepareMode mode);
+    PrepareMode getPrepareMode() const { return prepareMode_; }
+
+    // Latency of the engine, in engine-rate samples: the Prepare()
+    // schedule plus the playback mode's algorithmic delay (or
+    // kMaxModeLatencySamples while latency compensation is on).
+    int getLatencySamples() const;
+
+    // The same for a given playback mode. Safe on the audio thread, with
+    // the mode from peekParameters(): getLatencySamples() reads the control
+    // thread's settings.
+    int getLatencySamplesForMode(int playbackMode) const;
+
+    // Algorithmic delay of a playback mode's wet signal, in engine samples.
+    static int getModeLatencySamples(int playbackMode);
+
+    static constexpr int kSpectralLatencySamples = 4096;
+    static constexpr int kMaxModeLatencySamples = kSpectralLatencySamples;
+
+    // Latency compensation delays the output of every playback mode to
+    // kMaxModeLatencySamples, so getLatencySamples() does not change when the
+    // mode does. Off by default: without it granular mode has no delay at all.
+    // Call while the engine is not processing, like setPrepareMode().
+    void setLatencyCompensation(bool enabled) { latencyCompensation_ = enabled; }
+    bool getLatencyCompensation() const { return latencyCompensation_; }
+
+    // Host-rate dry/wet. The processor runs fully wet, and SampleRateAdapter
+    // mixes the input back in at the host rate, in float and delayed to line
+    // up with the wet signal; at 0% wet it stops running the engine. Off by
+    // default. Call while the engine is not processing, before
+    // SampleRateAdapter::prepare().
+    void setHostDryWet(bool enabled) { hostDryWet_ = enabled; }
+    bool getHostDryWet() const { return hostDryWet_; }
+
+    // process() calls that found the worker still owing its Prepare(). The
+    // audio thread then runs it itself if the worker has not started it;
+    // if the worker is in the middle of it, the call's output is silent
+    // (TelemetryRecord::kPrepareDropped). Either way, the count of times
+    // the worker fell behind.
+    uint32_t getPrepareOverruns() const { return prepareOverruns_.load(std::memory_order_relaxed); }
+
+    // Worker mode: true while the worker still holds the processor for the
+    // Prepare() handed over by the last endCallback(), i.e. the next
+    // process() call would be an overrun if it came now.
+    bool isPrepareInFlight() const;
+
     void process(const float* inputL, const float* inputR,
                  float* outputL, float* outputR,
                  int numSamples);
 
+    // Deferred mode: runs the pending Prepare() now, if there is one.
+    // Realtime-safe; does nothing in the other modes.
+    void runDeferredPrepare();
+
+    // Call once at the end of every host callback, after its last
+    // process(). Hands the Prepare() still owed to the worker (Worker), or
+    // runs it if the callback completed no block (Deferred). Realtime-safe
+    // and lock-free; SampleRateAdapter::process() calls it.
+    void endCallback();
+
+    // Same as process() for interleaved (l, r, l, r, ...) buffers, which
+    // convert to and from the processor's ShortFrames without a shuffle.
+    void processInterleaved(const float* input, float* output, int numFrames);
+
     // --- Parameter setters ---
-    void setPosition(float v) { targetPosition_ = v; }
-    void setSize(float v) { targetSize_ = v; }
-    void setPitch(float v) { targetPitch_ = v; }
-    void setDensity(float v) { targetDensity_ = v; }
-    void setTexture(float v) { targetTexture_ = v; }
-    void setDryWet(float v) { targetDryWet_ = v; }
-    void setStereoSpread(float v) { targetSpread_ = v; }
-    void setFeedback(float v) { targetFeedback_ = v; }
-    void setReverb(float v) { targetReverb_ = v; }
+    // Setters are for one control thread (message thread or the host's audio
+    // callback) while process() runs on another. Continuous values, quality
+    // and playback mode are published as a whole EngineParameters snapshot
+    // through a triple buffer; process() picks up the latest one once per
+    // engine block. Freeze and trigger are queued as edges. Nothing here
+    // locks or touches the GranularProcessor directly.
+    void setPosition(float v) { pendingParameters_.position = v; publishParameters(); }
+    void setSize(float v) { pendingParameters_.size = v; publishParameters(); }
+    void setPitch(float v) { pendingParameters_.pitch = v; publishParameters(); }
+    void setDensity(float v) { pendingParameters_.density = v; publishParameters(); }
+    void setTexture(float v) { pendingParameters_.texture = v; publishParameters(); }
+    void setDryWet(float v) { pendingParameters_.dryWet = v; publishParameters(); }
+    void setStereoSpread(float v) { pendingParameters_.stereoSpread = v; publishParameters(); }
+    void setFeedback(float v) { pendingParameters_.feedback = v; publishParameters(); }
+    void setReverb(float v) { pendingParameters_.reverb = v; publishParameters(); }
     void setFreeze(bool v);
     void setTrigger(bool v);
     void setQuality(int quality);
     void setPlaybackMode(int mode);
 
-    void setInputTrim(float v)  { inputTrim_ = v; }
-    void setOutputGain(float v) { outputGain_ = v; }
+    void setInputTrim(float v)  { pendingParameters_.inputTrim = v; publishParameters(); }
+    void setOutputGain(float v) { pendingParameters_.outputGain = v; publishParameters(); }
+
+    // Publishes a complete set in one go, so process() sees either all of
+    // it or none of it.
+    void setParameters(const EngineParameters& parameters);
+
+    // Audio thread: the latest published set, without applying it (process()
+    // still takes it once per block). Lets SampleRateAdapter follow DRY/WET
+    // while the engine is not running.
+    const EngineParameters& peekParameters();
+
+    // Control-thread view of what the setters have requested so far (used
+    // by TraceRecorder). Only meaningful on the thread that calls the setters.
+    const EngineParameters& getPendingParameters() const { return pendingParameters_; }
+    bool getPendingFreeze() const { return pendingFreeze_; }
+    uint32_t getTriggerCount() const { return triggerCount_; }
+
+    // --- Idle detection ---
+    // Once input and output have stayed below kIdleThreshold for
+    // kIdleHoldSeconds, the engine stops calling Prepare()/Process() and
+    // outputs silence. The hold is longer than the recording buffer at any
+    // quality, so the buffer holds only silence by then. Input above the
+    // threshold or a trigger wakes it on the same block, and it never goes
+    // idle while frozen.
+    void setIdleDetectionEnabled(bool enabled);
+    bool getIdleDetectionEnabled() const { return idleDetectionEnabled_; }
+    bool isIdle() const;
+
+    static constexpr float kIdleThreshold = 1.0e-4f;   // -80 dBFS
+    static constexpr float kIdleHoldSeconds = 4.0f;
 
-    // Set pointers to atomic meters owned by the Processor
-    void setMeterPointers(std::atomic<float>* meterD, std::atomic<float>* meterE)
-    {
-        meterD_ = meterD;
-        meterE_ = meterE;
-    }
+    // --- State snapshot ---
+    // Captures everything init() and the audio so far have built up: the
+    // GranularProcessor object, both DSP buffers, the parameter targets
+    // and smoothed values, and setHostDryWet(). Restoring it skips init()'s allocation, memsets
+    // and warm-up cycles. For cloning engines within one process only: the
+    // processor also points into this binary's lookup tables, which are not
+    // part of the blob, so restoreSnapshot() refuses a blob captured by
+    // another process (or an earlier run), as well as one from another
+    // build (processor layout and buffer sizes are checked on restore).
+    // Persist settings and init() instead of saving blobs.
+    // The first restore or clone in a process also finds the processor's
+    // pointer members (SnapshotBenchmark times it); later ones reuse them.
+    // None of these are realtime-safe; call them while the engine is not processing.
+    void captureSnapshot(juce::MemoryBlock& destData) const;
+    bool restoreSnapshot(const void* data, size_t sizeInBytes);
 
-    static constexpr int kBlockSize = 32;
+    // Makes this engine an exact copy of a warmed-up "golden" engine using
+    // straight memcpys, without going through a serialised blob.
+    bool cloneFrom(const CloudsEngineT& golden);
+
+    bool isInitialised() const { return initialised_; }
+
+    // True from init() until the first process() call; a restored snapshot
+    // does not count. TraceRecorder only starts recording from here.
+    bool isFreshlyInitialised() const { return freshlyInitialised_; }
+
+    // --- Telemetry ---
+    // process() pushes one TelemetryRecord per engine block. A single
+    // consumer (GUI timer, logger, test) drains it at its own rate.
+    TelemetryRing& getTelemetry() { return telemetry_; }
+
+    static constexpr int kBlockSize = BlockSize;
+
+    // Frames per GranularProcessor::Process() call: the engine block, or
+    // 32-frame pieces of it (clouds::kMaxBlockSize).
+    static constexpr int kProcessBlockSize = BlockSize < 32 ? BlockSize : 32;
 
 private:
     static constexpr size_t kLargeBufferSize = 118784;
@@ -56,25 +222,72 @@ private:
     std::unique_ptr<uint8_t[]> smallBuffer_;
     std::unique_ptr<clouds::GranularProcessor> processor_;
 
+    class PrepareWorker;
+    std::unique_ptr<PrepareWorker> prepareWorker_;
+    PrepareMode prepareMode_ = PrepareMode::Inline;
+    std::atomic<uint32_t> prepareOverruns_ { 0 };
+    bool preparePending_ = false;         // Deferred: last block's Prepare() not run yet
+    bool processedInCallback_ = false;    // Process() ran since the last endCallback()
+    float deferredPrepareMicros_ = 0.0f;
+
+    void publishParameters();
+    const EngineParameters& pullParameters();
+    void applySmoothedParameters(const EngineParameters& targets);
+    void updatePrepareWorker();
+
+    struct SnapshotHeader;
+    static const std::vector<uint32_t>& getProcessorPointers();
+    void fillSnapshotHeader(SnapshotHeader& header) const;
+    bool restoreState(const SnapshotHeader& header, const uint8_t* processorBytes,
+                      const uint8_t* largeBytes, const uint8_t* smallBytes);
+
+    void updateIdleState(float blockPeakIn, float blockPeakOut);
+    void compensateModeLatency(int16_t* frames);
+
+    // Both process() variants. Interleaved: inputL / outputL hold l, r, l, r, ...
+    // and inputR / outputR are unused.
+    void processBlocks(const float* inputL, const float* inputR,
+                       float* outputL, float* outputR,
+                       bool interleaved, int numSamples);
+
     bool initialised_ = false;
-    float inputTrim_ = 0.5f;
-    float outputGain_ = 1.6f;
+    bool freshlyInitialised_ = false;
 
-    // Non-owning pointers to processor's atomic meters (null = no metering)
-    std::atomic<float>* meterD_ = nullptr;
-    std::atomic<float>* meterE_ = nullptr;
+    // Set by the constructor for the block size.
+    int idleHoldBlocks_ = 0;
+    float smoothingCoeff_ = kSmoothingCoeff;
 
-    // Parameter smoothing
-    float targetPosition_ = 0.5f;
-    float targetSize_ = 0.5f;
-    float targetPitch_ = 0.0f;
-    float targetDensity_ = 0.5f;
-    float targetTexture_ = 0.5f;
-    float targetDryWet_ = 0.5f;
-    float targetSpread_ = 0.0f;
-    float targetFeedback_ = 0.0f;
-    float targetReverb_ = 0.0f;
+    bool idleDetectionEnabled_ = true;
+    bool idle_ = false;
+    int silentBlocks_ = 0;
+
+    // Latency compensation: interleaved l, r output history. A power of two
+    // that holds kMaxModeLatencySamples plus one block.
+    static constexpr uint32_t kCompensationRingSize = 8192;
+    static_assert(kCompensationRingSize >= kMaxModeLatencySamples + kBlockSize, "ring too short");
+    bool latencyCompensation_ = false;
+    std::unique_ptr<int16_t[]> compensationRing_;
+    uint32_t compensationWrite_ = 0;
+
+    bool hostDryWet_ = false;
+
+    TelemetryRing telemetry_;
+    uint64_t telemetryBlockIndex_ = 0;
+
+    // Control thread side: the set being edited, and the last freeze state
+    // queued (so repeated setFreeze calls do not flood the queue).
+    EngineParameters pendingParameters_;
+    bool pendingFreeze_ = false;
+    uint32_t triggerCount_ = 0;
 
+    TripleBuffer<EngineParameters> parameterBuffer_;
+    ControlEventQueue controlEvents_;
+
+    // Audio thread side: what has actually been handed to the processor.
+    int appliedPlaybackMode_ = 0;
+    int appliedQuality_ = 0;
+
+    // Parameter smoothing
     float smoothedPosition_ = 0.5f;
     float smoothedSize_ = 0.5f;
     float smoothedPitch_ = 0.0f;
@@ -85,7 +298,11 @@ private:
     float smoothedFeedback_ = 0.0f;
     float smoothedReverb_ = 0.0f;
 
-    static constexpr float kSmoothingCoeff = 0.02f;
+    static constexpr float kSmoothingCoeff = 0.02f;   // per 32 frames at 32 kHz
 
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CloudsEngine)
+    static constexpr uint32_t kInitSeed = 0x436c6f75;  // stmlib::Random seed of init()'s warm-up
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CloudsEngineT)
 };
+
+using CloudsEngine = CloudsEngineT<32>;
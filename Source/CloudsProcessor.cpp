@@ -0,0 +1,134 @@
+#include "CloudsProcessor.h"
+
+CloudsVSTProcessor::CloudsVSTProcessor()
+    : AudioProcessor(BusesProperties()
+          .withInput("Input", juce::AudioChannelSet::stereo(), true)
+          .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
+      apvts_(*this, nullptr, "PARAMETERS", CloudsVST::createParameterLayout())
+{
+    bypassParameter_ = apvts_.getParameter("bypass");
+
+    positionParam_   = apvts_.getRawParameterValue("position");
+    sizeParam_       = apvts_.getRawParameterValue("size");
+    pitchParam_      = apvts_.getRawParameterValue("pitch");
+    densityParam_    = apvts_.getRawParameterValue("density");
+    textureParam_    = apvts_.getRawParameterValue("texture");
+    dryWetParam_     = apvts_.getRawParameterValue("dry_wet");
+    spreadParam_     = apvts_.getRawParameterValue("stereo_spread");
+    feedbackParam_   = apvts_.getRawParameterValue("feedback");
+    reverbParam_     = apvts_.getRawParameterValue("reverb");
+    freezeParam_     = apvts_.getRawParameterValue("freeze");
+    triggerParam_    = apvts_.getRawParameterValue("trigger");
+    bypassParam_     = apvts_.getRawParameterValue("bypass");
+    modeParam_       = apvts_.getRawParameterValue("playback_mode");
+    qualityParam_    = apvts_.getRawParameterValue("quality");
+    inputGainParam_  = apvts_.getRawParameterValue("input_gain");
+    inputTrimParam_  = apvts_.getRawParameterValue("engine_input_trim");
+    outputGainParam_ = apvts_.getRawParameterValue("engine_output_gain");
+}
+
+void CloudsVSTProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    // init() allocates and resets the Clouds buffers; never on the audio thread.
+    engine_.init();
+    triggerHeld_ = false;
+
+    // Every playback mode delayed to the spectral one's latency, so the
+    // latency reported here holds whatever mode the user picks: hosts only
+    // pick up a change between prepareToPlay() calls, if at all.
+    engine_.setLatencyCompensation(true);
+
+    // DRY/WET mixed at the host rate, in float, and the engine skipped
+    // altogether at 0% wet.
+    engine_.setHostDryWet(true);
+
+    adapter_.setBusLayout(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    adapter_.prepare(sampleRate, samplesPerBlock, engine_.getLatencySamples(), engine_.getSampleRate());
+    setLatencySamples(adapter_.getLatencySamples(engine_));
+}
+
+void CloudsVSTProcessor::releaseResources()
+{
+}
+
+bool CloudsVSTProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+    // Mono -> mono, mono -> stereo or stereo -> stereo, as SampleRateAdapter
+    // runs them.
+    const auto in  = layouts.getMainInputChannelSet();
+    const auto out = layouts.getMainOutputChannelSet();
+
+    if (out != juce::AudioChannelSet::mono() && out != juce::AudioChannelSet::stereo())
+        return false;
+
+    return in == juce::AudioChannelSet::mono() || in == out;
+}
+
+void CloudsVSTProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    // Bypass first: the adapter crossfades to the input it is given and then
+    // skips the resamplers and the engine, so it must see the host input
+    // untouched by anything below.
+    adapter_.setBypass(bypassParam_->load() >= 0.5f);
+
+    const int numSamples = buffer.getNumSamples();
+    const int numInputs  = getTotalNumInputChannels();
+    const int numOutputs = getTotalNumOutputChannels();
+
+    for (int ch = numInputs; ch < numOutputs; ++ch)
+        buffer.clear(ch, 0, numSamples);
+
+    // --- Read parameters into one engine snapshot ---
+    // INPUT GAIN goes in with the engine's input trim rather than onto the
+    // buffer, so that it scales dry and wet alike and never the bypassed
+    // signal.
+    auto parameters = engine_.getPendingParameters();
+    parameters.position     = positionParam_->load();
+    parameters.size         = sizeParam_->load();
+    parameters.pitch        = pitchParam_->load();
+    parameters.density      = densityParam_->load();
+    parameters.texture      = textureParam_->load();
+    parameters.dryWet       = dryWetParam_->load();
+    parameters.stereoSpread = spreadParam_->load();
+    parameters.feedback     = feedbackParam_->load();
+    parameters.reverb       = reverbParam_->load();
+    parameters.inputTrim    = inputTrimParam_->load()
+                              * juce::Decibels::decibelsToGain(inputGainParam_->load());
+    parameters.outputGain   = outputGainParam_->load();
+    parameters.playbackMode = static_cast<int>(modeParam_->load());
+    parameters.quality      = static_cast<int>(qualityParam_->load());
+    engine_.setParameters(parameters);
+
+    engine_.setFreeze(freezeParam_->load() >= 0.5f);
+
+    const bool trigger = triggerParam_->load() >= 0.5f;
+    if (trigger && !triggerHeld_)
+        engine_.setTrigger(true);
+    triggerHeld_ = trigger;
+
+    // --- Host rate in, host rate out, in place ---
+    float* left  = buffer.getWritePointer(0);
+    float* right = numOutputs > 1 ? buffer.getWritePointer(1) : left;
+    adapter_.process(left, numInputs > 1 ? right : nullptr, left, right, numSamples, engine_);
+}
+
+juce::AudioProcessorEditor* CloudsVSTProcessor::createEditor()
+{
+    return new juce::GenericAudioProcessorEditor(*this);
+}
+
+void CloudsVSTProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+    auto state = apvts_.copyState();
+    std::unique_ptr<juce::XmlElement> xml(state.createXml());
+    copyXmlToBinary(*xml, destData);
+}
+
+void CloudsVSTProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+    if (xml != nullptr && xml->hasTagName(apvts_.state.getType()))
+        apvts_.replaceState(juce::ValueTree::fromXml(*xml));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "Parameters.h"
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+
+// The Clouds chain as a juce::AudioProcessor: CloudsVST::createParameterLayout()
+// driving a CloudsEngine through a SampleRateAdapter at the host rate.
+// MT2Plugin owns createPluginFilter(); this processor is built alongside it
+// and constructed directly (tests, hosting code).
+class CloudsVSTProcessor : public juce::AudioProcessor
+{
+public:
+    CloudsVSTProcessor();
+    ~CloudsVSTProcessor() override = default;
+
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+    bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
+    void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    const juce::String getName() const override { return "CloudsVST"; }
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return false; }
+    double getTailLengthSeconds() const override { return CloudsEngine::kIdleHoldSeconds; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+    // The "bypass" parameter, so that the host's own bypass switch drives it
+    // rather than skipping processBlock(): SampleRateAdapter then fades to
+    // the dry input and stops the chain. The latency is still reported, and
+    // the bypassed input is delayed by it, so it stays lined up in the host.
+    juce::AudioProcessorParameter* getBypassParameter() const override { return bypassParameter_; }
+
+    juce::AudioProcessorValueTreeState& getAPVTS() { return apvts_; }
+    const SampleRateAdapter& getAdapter() const { return adapter_; }
+
+private:
+    juce::AudioProcessorValueTreeState apvts_;
+    CloudsEngine engine_;
+    SampleRateAdapter adapter_;
+
+    juce::AudioProcessorParameter* bypassParameter_ = nullptr;
+
+    // Parameter pointers (atomic, read once per processBlock)
+    std::atomic<float>* positionParam_   = nullptr;
+    std::atomic<float>* sizeParam_       = nullptr;
+    std::atomic<float>* pitchParam_      = nullptr;
+    std::atomic<float>* densityParam_    = nullptr;
+    std::atomic<float>* textureParam_    = nullptr;
+    std::atomic<float>* dryWetParam_     = nullptr;
+    std::atomic<float>* spreadParam_     = nullptr;
+    std::atomic<float>* feedbackParam_   = nullptr;
+    std::atomic<float>* reverbParam_     = nullptr;
+    std::atomic<float>* freezeParam_     = nullptr;
+    std::atomic<float>* triggerParam_    = nullptr;
+    std::atomic<float>* bypassParam_     = nullptr;
+    std::atomic<float>* modeParam_       = nullptr;
+    std::atomic<float>* qualityParam_    = nullptr;
+    std::atomic<float>* inputGainParam_  = nullptr;
+    std::atomic<float>* inputTrimParam_  = nullptr;
+    std::atomic<float>* outputGainParam_ = nullptr;
+
+    // TRIGGER is a button; the engine takes one pulse per press.
+    bool triggerHeld_ = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CloudsVSTProcessor)
+};
@@ -0,0 +1,42 @@
+#include "DriftEstimator.h"
+
+#include <cmath>
+
+void DriftEstimator::reset(double nominalRate, double bandwidthHz)
+{
+    nominalRate_ = nominalRate;
+    bandwidthHz_ = bandwidthHz;
+    period_ = 1.0 / nominalRate;
+    time_ = 0.0;
+    lastNumSamples_ = 0;
+    numUpdates_ = 0;
+}
+
+void DriftEstimator::update(double referenceTime, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    const double predicted = time_ + lastNumSamples_ * period_;
+    const double error = referenceTime - predicted;
+
+    if (numUpdates_ == 0 || std::abs(error) > kMaxErrorSeconds)
+    {
+        // (Re)start from this callback, keeping the period learnt so far.
+        time_ = referenceTime;
+        lastNumSamples_ = numSamples;
+        numUpdates_ = 1;
+        return;
+    }
+
+    // Loop coefficients for the time this callback covered, so long and
+    // short callbacks weigh in by their length.
+    const double omega = 2.0 * 3.14159265358979323846 * bandwidthHz_ * lastNumSamples_ * period_;
+    const double b = std::sqrt(2.0) * omega;
+    const double c = omega * omega;
+
+    time_ = predicted + b * error;
+    period_ += c * error / lastNumSamples_;
+    lastNumSamples_ = numSamples;
+    ++numUpdates_;
+}
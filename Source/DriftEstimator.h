@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+// Measures the host's actual sample rate against a reference clock, for
+// SampleRateAdapter's varispeed mode.
+//
+// A second-order delay-locked loop (F. Adriaensen, "Using a DLL to filter
+// time", LAC 2005) runs once per callback. It predicts when the next
+// callback's first sample is due from the filtered time and period so far,
+// compares that with the reference time the caller reports, and corrects
+// both. The period is kept per sample, so callbacks of any length work.
+// Timestamp jitter is rejected above the loop bandwidth; drift below it is
+// followed. Realtime-safe, no allocation.
+class DriftEstimator
+{
+public:
+    // bandwidthHz: lower rejects more jitter and locks more slowly.
+    void reset(double nominalRate, double bandwidthHz = kDefaultBandwidthHz);
+
+    // Once per callback: the reference-clock time, in seconds, of the
+    // callback's first sample, and the number of samples in it. A jump of
+    // more than kMaxErrorSeconds (a dropout, a clock step) restarts the loop.
+    void update(double referenceTime, int numSamples);
+
+    // Estimated sample rate in reference-clock samples per second. The
+    // nominal rate until the loop has seen two callbacks.
+    double getSampleRate() const { return 1.0 / period_; }
+
+    // Deviation from the nominal rate in parts per million.
+    double getDriftPpm() const { return (getSampleRate() / nominalRate_ - 1.0) * 1.0e6; }
+
+    // Callbacks since the last (re)start.
+    int64_t getNumUpdates() const { return numUpdates_; }
+
+    static constexpr double kDefaultBandwidthHz = 0.1;
+    static constexpr double kMaxErrorSeconds = 0.05;
+
+private:
+    double nominalRate_ = 48000.0;
+    double bandwidthHz_ = kDefaultBandwidthHz;
+
+    double period_ = 1.0 / 48000.0;   // filtered seconds per sample
+    double time_ = 0.0;               // filtered time of the last callback's first sample
+    int lastNumSamples_ = 0;
+    int64_t numUpdates_ = 0;
+};
@@ -0,0 +1,400 @@
+#include "EngineKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <juce_core/juce_core.h>
+
+#if CLOUDS_KERNELS_SSE2
+ #include <emmintrin.h>
+#endif
+
+namespace
+{
+    // --- Per-frame scalar steps, shared by the scalar kernels and the SIMD tails ---
+
+    inline float inputClampedFrame(float l, float r, float trim, int16_t* frame)
+    {
+        l = std::max(-1.0f, std::min(1.0f, l * trim));
+        r = std::max(-1.0f, std::min(1.0f, r * trim));
+
+        frame[0] = static_cast<int16_t>(l * 32767.0f);
+        frame[1] = static_cast<int16_t>(r * 32767.0f);
+
+        return (std::abs(l) + std::abs(r)) * 0.5f;
+    }
+
+    inline float outputFrame(const int16_t* frame, float gain, float* outL, float* outR)
+    {
+        const float l = static_cast<float>(frame[0]) / 32768.0f * gain;
+        const float r = static_cast<float>(frame[1]) / 32768.0f * gain;
+
+        *outL = l;
+        *outR = r;
+
+        return (std::abs(l) + std::abs(r)) * 0.5f;
+    }
+
+    inline void measureSample(int16_t x, EngineKernels::FrameStats& stats)
+    {
+        const int32_t v = x;
+        stats.sumOfSquares += static_cast<uint64_t>(v * v);
+        stats.clips += (v >= 32767 || v <= -32767) ? 1 : 0;
+    }
+
+    inline void zeroPad(int16_t* frames, int numFrames, int blockSize)
+    {
+        if (blockSize > numFrames)
+            std::memset(frames + 2 * numFrames, 0,
+                        sizeof(int16_t) * 2 * static_cast<size_t>(blockSize - numFrames));
+    }
+
+#if CLOUDS_KERNELS_SSE2
+    inline float horizontalMax(__m128 v)
+    {
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(v);
+    }
+
+    inline uint64_t horizontalSum64(__m128i v)
+    {
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), v);
+        return lanes[0] + lanes[1];
+    }
+
+    inline int32_t horizontalSum32(__m128i v)
+    {
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(v);
+    }
+
+    inline __m128 framePeak(__m128 l, __m128 r)
+    {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        return _mm_mul_ps(_mm_add_ps(_mm_andnot_ps(signMask, l),
+                                     _mm_andnot_ps(signMask, r)),
+                          _mm_set1_ps(0.5f));
+    }
+
+    inline void storeFrames(int16_t* dst, __m128i l, __m128i r)
+    {
+        const __m128i lo = _mm_unpacklo_epi32(l, r);
+        const __m128i hi = _mm_unpackhi_epi32(l, r);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packs_epi32(lo, hi));
+    }
+#endif
+}
+
+//==============================================================================
+// Scalar reference
+//==============================================================================
+namespace EngineKernels { namespace scalar {
+
+float convertInputClamped(const float* inL, const float* inR, float trim,
+                          int16_t* frames, int numFrames, int blockSize)
+{
+    float peak = 0.0f;
+    for (int i = 0; i < numFrames; ++i)
+        peak = std::max(peak, inputClampedFrame(inL[i], inR[i], trim, frames + 2 * i));
+
+    zeroPad(frames, numFrames, blockSize);
+    return peak;
+}
+
+float convertOutput(const int16_t* frames, float gain,
+                    float* outL, float* outR, int numFrames)
+{
+    float peak = 0.0f;
+    for (int i = 0; i < numFrames; ++i)
+        peak = std::max(peak, outputFrame(frames + 2 * i, gain, outL + i, outR + i));
+
+    return peak;
+}
+
+float convertInputClampedInterleaved(const float* in, float trim,
+                                     int16_t* frames, int numFrames, int blockSize)
+{
+    float peak = 0.0f;
+    for (int i = 0; i < numFrames; ++i)
+        peak = std::max(peak, inputClampedFrame(in[2 * i], in[2 * i + 1], trim, frames + 2 * i));
+
+    zeroPad(frames, numFrames, blockSize);
+    return peak;
+}
+
+float convertOutputInterleaved(const int16_t* frames, float gain, float* out, int numFrames)
+{
+    float peak = 0.0f;
+    for (int i = 0; i < numFrames; ++i)
+        peak = std::max(peak, outputFrame(frames + 2 * i, gain, out + 2 * i, out + 2 * i + 1));
+
+    return peak;
+}
+
+FrameStats measureFrames(const int16_t* frames, int numFrames)
+{
+    FrameStats stats;
+    for (int i = 0; i < 2 * numFrames; ++i)
+        measureSample(frames[i], stats);
+
+    return stats;
+}
+
+}} // namespace EngineKernels::scalar
+
+//==============================================================================
+// SSE2 (AVX2 is in EngineKernelsAVX2.cpp)
+//==============================================================================
+#if CLOUDS_KERNELS_SSE2
+namespace EngineKernels { namespace sse2 {
+
+float convertInputClamped(const float* inL, const float* inR, float trim,
+                          int16_t* frames, int numFrames, int blockSize)
+{
+    const __m128 vTrim = _mm_set1_ps(trim);
+    const __m128 vOne = _mm_set1_ps(1.0f);
+    const __m128 vMinusOne = _mm_set1_ps(-1.0f);
+    const __m128 vScale = _mm_set1_ps(32767.0f);
+    __m128 vPeak = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        __m128 l = _mm_mul_ps(_mm_loadu_ps(inL + i), vTrim);
+        __m128 r = _mm_mul_ps(_mm_loadu_ps(inR + i), vTrim);
+        l = _mm_max_ps(vMinusOne, _mm_min_ps(vOne, l));
+        r = _mm_max_ps(vMinusOne, _mm_min_ps(vOne, r));
+
+        vPeak = _mm_max_ps(vPeak, framePeak(l, r));
+        storeFrames(frames + 2 * i,
+                    _mm_cvttps_epi32(_mm_mul_ps(l, vScale)),
+                    _mm_cvttps_epi32(_mm_mul_ps(r, vScale)));
+    }
+
+    float peak = horizontalMax(vPeak);
+    for (; i < numFrames; ++i)
+        peak = std::max(peak, inputClampedFrame(inL[i], inR[i], trim, frames + 2 * i));
+
+    zeroPad(frames, numFrames, blockSize);
+    return peak;
+}
+
+float convertOutput(const int16_t* frames, float gain,
+                    float* outL, float* outR, int numFrames)
+{
+    const __m128 vInvScale = _mm_set1_ps(1.0f / 32768.0f);
+    const __m128 vGain = _mm_set1_ps(gain);
+    __m128 vPeak = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frames + 2 * i));
+
+        // Sign-extend int16 -> int32 without SSE4.1.
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16);   // l0 r0 l1 r1
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16);   // l2 r2 l3 r3
+
+        // x / 32768 is exact, so multiplying by the reciprocal matches the scalar path.
+        const __m128 a = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), vInvScale), vGain);
+        const __m128 b = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), vInvScale), vGain);
+
+        const __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(outL + i, l);
+        _mm_storeu_ps(outR + i, r);
+        vPeak = _mm_max_ps(vPeak, framePeak(l, r));
+    }
+
+    float peak = horizontalMax(vPeak);
+    for (; i < numFrames; ++i)
+        peak = std::max(peak, outputFrame(frames + 2 * i, gain, outL + i, outR + i));
+
+    return peak;
+}
+
+float convertInputClampedInterleaved(const float* in, float trim,
+                                     int16_t* frames, int numFrames, int blockSize)
+{
+    const __m128 vTrim = _mm_set1_ps(trim);
+    const __m128 vOne = _mm_set1_ps(1.0f);
+    const __m128 vMinusOne = _mm_set1_ps(-1.0f);
+    const __m128 vScale = _mm_set1_ps(32767.0f);
+    __m128 vPeak = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(in + 2 * i), vTrim);       // frames 0-1
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(in + 2 * i + 4), vTrim);   // frames 2-3
+        a = _mm_max_ps(vMinusOne, _mm_min_ps(vOne, a));
+        b = _mm_max_ps(vMinusOne, _mm_min_ps(vOne, b));
+
+        vPeak = _mm_max_ps(vPeak, framePeak(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                                            _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(frames + 2 * i),
+                         _mm_packs_epi32(_mm_cvttps_epi32(_mm_mul_ps(a, vScale)),
+                                         _mm_cvttps_epi32(_mm_mul_ps(b, vScale))));
+    }
+
+    float peak = horizontalMax(vPeak);
+    for (; i < numFrames; ++i)
+        peak = std::max(peak, inputClampedFrame(in[2 * i], in[2 * i + 1], trim, frames + 2 * i));
+
+    zeroPad(frames, numFrames, blockSize);
+    return peak;
+}
+
+float convertOutputInterleaved(const int16_t* frames, float gain, float* out, int numFrames)
+{
+    const __m128 vInvScale = _mm_set1_ps(1.0f / 32768.0f);
+    const __m128 vGain = _mm_set1_ps(gain);
+    __m128 vPeak = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frames + 2 * i));
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16);
+
+        const __m128 a = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), vInvScale), vGain);
+        const __m128 b = _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), vInvScale), vGain);
+
+        _mm_storeu_ps(out + 2 * i, a);
+        _mm_storeu_ps(out + 2 * i + 4, b);
+        vPeak = _mm_max_ps(vPeak, framePeak(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                                            _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+    }
+
+    float peak = horizontalMax(vPeak);
+    for (; i < numFrames; ++i)
+        peak = std::max(peak, outputFrame(frames + 2 * i, gain, out + 2 * i, out + 2 * i + 1));
+
+    return peak;
+}
+
+FrameStats measureFrames(const int16_t* frames, int numFrames)
+{
+    // madd(x, x) sums two squares into one 32-bit lane; 2 * 32768^2 only
+    // fits unsigned, so lanes are zero-extended before widening to 64 bits.
+    // Rail hits are -1 per int16 lane and summed the same way.
+    const __m128i vHigh = _mm_set1_epi16(32766);
+    const __m128i vLow = _mm_set1_epi16(-32766);
+    const __m128i vOnes = _mm_set1_epi16(1);
+    const __m128i vZero = _mm_setzero_si128();
+    __m128i vSum = _mm_setzero_si128();
+    __m128i vClips = _mm_setzero_si128();
+
+    const int numSamples = 2 * numFrames;
+    int i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frames + i));
+        const __m128i squares = _mm_madd_epi16(x, x);
+
+        vSum = _mm_add_epi64(vSum, _mm_unpacklo_epi32(squares, vZero));
+        vSum = _mm_add_epi64(vSum, _mm_unpackhi_epi32(squares, vZero));
+
+        const __m128i hits = _mm_or_si128(_mm_cmpgt_epi16(x, vHigh), _mm_cmpgt_epi16(vLow, x));
+        vClips = _mm_sub_epi32(vClips, _mm_madd_epi16(hits, vOnes));
+    }
+
+    FrameStats stats;
+    stats.sumOfSquares = horizontalSum64(vSum);
+    stats.clips = horizontalSum32(vClips);
+
+    for (; i < numSamples; ++i)
+        measureSample(frames[i], stats);
+
+    return stats;
+}
+
+}} // namespace EngineKernels::sse2
+#endif
+
+//==============================================================================
+// Dispatch
+//==============================================================================
+namespace
+{
+    using namespace EngineKernels;
+
+    // Picked once, on first use.
+    struct KernelSets
+    {
+        KernelSets()
+        {
+           #if CLOUDS_KERNELS_AVX2
+            if (juce::SystemStats::hasAVX2())
+                add({ "AVX2", avx2::convertInputClamped, avx2::convertOutput,
+                      avx2::convertInputClampedInterleaved, avx2::convertOutputInterleaved, avx2::measureFrames });
+           #endif
+           #if CLOUDS_KERNELS_SSE2
+            add({ "SSE2", sse2::convertInputClamped, sse2::convertOutput,
+                  sse2::convertInputClampedInterleaved, sse2::convertOutputInterleaved, sse2::measureFrames });
+           #endif
+            add({ "scalar", scalar::convertInputClamped, scalar::convertOutput,
+                  scalar::convertInputClampedInterleaved, scalar::convertOutputInterleaved, scalar::measureFrames });
+        }
+
+        void add(const KernelSet& set) { sets[size++] = set; }
+
+        KernelSet sets[3] {};
+        int size = 0;
+    };
+
+    const KernelSets& getKernelSets()
+    {
+        static const KernelSets kernelSets;
+        return kernelSets;
+    }
+
+    const KernelSet& active() { return getKernelSets().sets[0]; }
+}
+
+namespace EngineKernels {
+
+int getNumKernelSets() { return getKernelSets().size; }
+
+const KernelSet& getKernelSet(int index)
+{
+    jassert(index >= 0 && index < getKernelSets().size);
+    return getKernelSets().sets[index];
+}
+
+const char* getInstructionSetName() { return active().name; }
+
+float convertInputClamped(const float* inL, const float* inR, float trim,
+                          int16_t* frames, int numFrames, int blockSize)
+{
+    return active().convertInputClamped(inL, inR, trim, frames, numFrames, blockSize);
+}
+
+float convertOutput(const int16_t* frames, float gain,
+                    float* outL, float* outR, int numFrames)
+{
+    return active().convertOutput(frames, gain, outL, outR, numFrames);
+}
+
+float convertInputClampedInterleaved(const float* in, float trim,
+                                     int16_t* frames, int numFrames, int blockSize)
+{
+    return active().convertInputClampedInterleaved(in, trim, frames, numFrames, blockSize);
+}
+
+float convertOutputInterleaved(const int16_t* frames, float gain, float* out, int numFrames)
+{
+    return active().convertOutputInterleaved(frames, gain, out, numFrames);
+}
+
+FrameStats measureFrames(const int16_t* frames, int numFrames)
+{
+    return active().measureFrames(frames, numFrames);
+}
+
+} // namespace EngineKernels
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+
+// Per-block conversion and metering kernels used by CloudsEngine::process.
+//
+// Frames are interleaved int16 (l, r, l, r, ...), i.e. the memory layout of
+// clouds::ShortFrame, so callers pass &frames[0].l. Every kernel returns the
+// block peak as max((|l| + |r|) / 2), which is what the telemetry ring
+// reports as input/output peak.
+//
+// EngineKernels::* dispatch at run time, on first use, to the fastest set
+// this CPU runs: AVX2 (EngineKernelsAVX2.cpp, the one file built with AVX2
+// enabled), SSE2 or the scalar versions in EngineKernels::scalar. All sets
+// are bit-exact with each other; Tests/EngineKernelTests.cpp checks every
+// set the CPU runs.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define CLOUDS_KERNELS_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define CLOUDS_KERNELS_SSE2 1
+#endif
+
+namespace EngineKernels
+{
+    // Integer level statistics of a block of interleaved int16 frames.
+    struct FrameStats
+    {
+        uint64_t sumOfSquares = 0;   // over both channels, exact
+        int clips = 0;               // samples with |x| >= 32767
+    };
+
+    // trim -> clamp to [-1, 1] -> truncate (x * 32767) into frames[0, numFrames),
+    // then zero-pad frames[numFrames, blockSize). Peak is measured after clamping.
+    float convertInputClamped(const float* inL, const float* inR, float trim,
+                              int16_t* frames, int numFrames, int blockSize);
+
+    // frames -> x / 32768 * gain, deinterleaved into outL/outR.
+    float convertOutput(const int16_t* frames, float gain,
+                        float* outL, float* outR, int numFrames);
+
+    // The same two conversions for interleaved (l, r, l, r, ...) float
+    // buffers, which map onto the frames without a shuffle.
+    float convertInputClampedInterleaved(const float* in, float trim,
+                                         int16_t* frames, int numFrames, int blockSize);
+    float convertOutputInterleaved(const int16_t* frames, float gain,
+                                   float* out, int numFrames);
+
+    // Sum of squares and rail hits over frames[0, numFrames).
+    FrameStats measureFrames(const int16_t* frames, int numFrames);
+
+    // Name of the instruction set the dispatching kernels picked.
+    const char* getInstructionSetName();
+
+    // One implementation of all of the above.
+    struct KernelSet
+    {
+        const char* name;
+        float (*convertInputClamped)(const float*, const float*, float, int16_t*, int, int);
+        float (*convertOutput)(const int16_t*, float, float*, float*, int);
+        float (*convertInputClampedInterleaved)(const float*, float, int16_t*, int, int);
+        float (*convertOutputInterleaved)(const int16_t*, float, float*, int);
+        FrameStats (*measureFrames)(const int16_t*, int);
+    };
+
+    // The sets this CPU runs, fastest first: set 0 is the one the
+    // dispatching kernels use, the last one is scalar.
+    int getNumKernelSets();
+    const KernelSet& getKernelSet(int index);
+
+    namespace scalar
+    {
+        float convertInputClamped(const float* inL, const float* inR, float trim,
+                                  int16_t* frames, int numFrames, int blockSize);
+        float convertOutput(const int16_t* frames, float gain,
+                            float* outL, float* outR, int numFrames);
+        float convertInputClampedInterleaved(const float* in, float trim,
+                                             int16_t* frames, int numFrames, int blockSize);
+        float convertOutputInterleaved(const int16_t* frames, float gain,
+                                       float* out, int numFrames);
+        FrameStats measureFrames(const int16_t* frames, int numFrames);
+    }
+
+   #if CLOUDS_KERNELS_SSE2
+    namespace sse2
+    {
+        float convertInputClamped(const float* inL, const float* inR, float trim,
+                                  int16_t* frames, int numFrames, int blockSize);
+        float convertOutput(const int16_t* frames, float gain,
+                            float* outL, float* outR, int numFrames);
+        float convertInputClampedInterleaved(const float* in, float trim,
+                                             int16_t* frames, int numFrames, int blockSize);
+        float convertOutputInterleaved(const int16_t* frames, float gain,
+                                       float* out, int numFrames);
+        FrameStats measureFrames(const int16_t* frames, int numFrames);
+    }
+   #endif
+
+   #if CLOUDS_KERNELS_AVX2
+    // Only on CPUs with AVX2 (juce::SystemStats::hasAVX2()).
+    namespace avx2
+    {
+        float convertInputClamped(const float* inL, const float* inR, float trim,
+                                  int16_t* frames, int numFrames, int blockSize);
+        float convertOutput(const int16_t* frames, float gain,
+                            float* outL, float* outR, int numFrames);
+        float convertInputClampedInterleaved(const float* in, float trim,
+                                             int16_t* frames, int numFrames, int blockSize);
+        float convertOutputInterleaved(const int16_t* frames, float gain,
+                                       float* out, int numFrames);
+        FrameStats measureFrames(const int16_t* frames, int numFrames);
+    }
+   #endif
+}
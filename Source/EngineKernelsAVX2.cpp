@@ -0,0 +1,222 @@
+#include "EngineKernels.h"
+
+// The AVX2 kernels. This is the only file built with AVX2 enabled
+// (CMakeLists.txt), and EngineKernels.cpp only calls into it after
+// juce::SystemStats::hasAVX2().
+//
+// Nothing here may instantiate an inline function or template that other
+// files use as well (std::max, std::abs, ...): the linker keeps one copy of
+// each, and it could be this file's AVX2 one. So there is no standard
+// library here, and the scalar tails are handed to EngineKernels::scalar.
+#if CLOUDS_KERNELS_AVX2
+
+#if ! defined(__AVX2__)
+ #error "EngineKernelsAVX2.cpp must be built with -mavx2 (/arch:AVX2 with MSVC)"
+#endif
+
+#include <immintrin.h>
+
+namespace
+{
+    inline float maxOf(float a, float b) { return a < b ? b : a; }
+
+    inline float horizontalMax(__m256 v)
+    {
+        __m128 x = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        x = _mm_max_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 0, 3, 2)));
+        x = _mm_max_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(x);
+    }
+
+    inline uint64_t horizontalSum64(__m256i v)
+    {
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes),
+                         _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+        return lanes[0] + lanes[1];
+    }
+
+    inline int32_t horizontalSum32(__m256i v)
+    {
+        __m128i x = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+        x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(x);
+    }
+
+    // (|l| + |r|) * 0.5
+    inline __m256 framePeak(__m256 l, __m256 r)
+    {
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        return _mm256_mul_ps(_mm256_add_ps(_mm256_andnot_ps(signMask, l),
+                                           _mm256_andnot_ps(signMask, r)),
+                             _mm256_set1_ps(0.5f));
+    }
+
+    // 8 int32 L + 8 int32 R -> 8 interleaved int16 frames. unpack/packs work
+    // per 128-bit lane, which happens to keep the frames in order.
+    inline void storeFrames(int16_t* dst, __m256i l, __m256i r)
+    {
+        const __m256i lo = _mm256_unpacklo_epi32(l, r);
+        const __m256i hi = _mm256_unpackhi_epi32(l, r);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_packs_epi32(lo, hi));
+    }
+
+    // int32 frames 0-3 (a) and 4-7 (b), already interleaved -> 8 int16
+    // frames. packs interleaves the 128-bit lanes, permute puts them back.
+    inline void storeInterleaved(int16_t* dst, __m256i a, __m256i b)
+    {
+        const __m256i packed = _mm256_packs_epi32(a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+}
+
+namespace EngineKernels { namespace avx2 {
+
+float convertInputClamped(const float* inL, const float* inR, float trim,
+                          int16_t* frames, int numFrames, int blockSize)
+{
+    const __m256 vTrim = _mm256_set1_ps(trim);
+    const __m256 vOne = _mm256_set1_ps(1.0f);
+    const __m256 vMinusOne = _mm256_set1_ps(-1.0f);
+    const __m256 vScale = _mm256_set1_ps(32767.0f);
+    __m256 vPeak = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        __m256 l = _mm256_mul_ps(_mm256_loadu_ps(inL + i), vTrim);
+        __m256 r = _mm256_mul_ps(_mm256_loadu_ps(inR + i), vTrim);
+        l = _mm256_max_ps(vMinusOne, _mm256_min_ps(vOne, l));
+        r = _mm256_max_ps(vMinusOne, _mm256_min_ps(vOne, r));
+
+        vPeak = _mm256_max_ps(vPeak, framePeak(l, r));
+        storeFrames(frames + 2 * i,
+                    _mm256_cvttps_epi32(_mm256_mul_ps(l, vScale)),
+                    _mm256_cvttps_epi32(_mm256_mul_ps(r, vScale)));
+    }
+
+    // The tail also zero-pads up to blockSize.
+    return maxOf(horizontalMax(vPeak),
+                 scalar::convertInputClamped(inL + i, inR + i, trim, frames + 2 * i,
+                                             numFrames - i, blockSize - i));
+}
+
+float convertOutput(const int16_t* frames, float gain,
+                    float* outL, float* outR, int numFrames)
+{
+    const __m256 vInvScale = _mm256_set1_ps(1.0f / 32768.0f);
+    const __m256 vGain = _mm256_set1_ps(gain);
+    __m256 vPeak = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const __m128i raw0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frames + 2 * i));
+        const __m128i raw1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frames + 2 * i + 8));
+
+        // x / 32768 is exact, so multiplying by the reciprocal matches the scalar path.
+        const __m256 a = _mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw0)), vInvScale), vGain);
+        const __m256 b = _mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw1)), vInvScale), vGain);
+
+        // a = l0 r0 l1 r1 | l2 r2 l3 r3, b = l4 r4 l5 r5 | l6 r6 l7 r7
+        const __m256 lShuf = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 rShuf = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m256 l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(lShuf), _MM_SHUFFLE(3, 1, 2, 0)));
+        const __m256 r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(rShuf), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        _mm256_storeu_ps(outL + i, l);
+        _mm256_storeu_ps(outR + i, r);
+        vPeak = _mm256_max_ps(vPeak, framePeak(l, r));
+    }
+
+    return maxOf(horizontalMax(vPeak),
+                 scalar::convertOutput(frames + 2 * i, gain, outL + i, outR + i, numFrames - i));
+}
+
+float convertInputClampedInterleaved(const float* in, float trim,
+                                     int16_t* frames, int numFrames, int blockSize)
+{
+    const __m256 vTrim = _mm256_set1_ps(trim);
+    const __m256 vOne = _mm256_set1_ps(1.0f);
+    const __m256 vMinusOne = _mm256_set1_ps(-1.0f);
+    const __m256 vScale = _mm256_set1_ps(32767.0f);
+    __m256 vPeak = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(in + 2 * i), vTrim);       // frames 0-3
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(in + 2 * i + 8), vTrim);   // frames 4-7
+        a = _mm256_max_ps(vMinusOne, _mm256_min_ps(vOne, a));
+        b = _mm256_max_ps(vMinusOne, _mm256_min_ps(vOne, b));
+
+        vPeak = _mm256_max_ps(vPeak, framePeak(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                                               _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+        storeInterleaved(frames + 2 * i,
+                         _mm256_cvttps_epi32(_mm256_mul_ps(a, vScale)),
+                         _mm256_cvttps_epi32(_mm256_mul_ps(b, vScale)));
+    }
+
+    return maxOf(horizontalMax(vPeak),
+                 scalar::convertInputClampedInterleaved(in + 2 * i, trim, frames + 2 * i,
+                                                        numFrames - i, blockSize - i));
+}
+
+float convertOutputInterleaved(const int16_t* frames, float gain, float* out, int numFrames)
+{
+    const __m256 vInvScale = _mm256_set1_ps(1.0f / 32768.0f);
+    const __m256 vGain = _mm256_set1_ps(gain);
+    __m256 vPeak = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const __m128i raw0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frames + 2 * i));
+        const __m128i raw1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frames + 2 * i + 8));
+
+        const __m256 a = _mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw0)), vInvScale), vGain);
+        const __m256 b = _mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw1)), vInvScale), vGain);
+
+        _mm256_storeu_ps(out + 2 * i, a);
+        _mm256_storeu_ps(out + 2 * i + 8, b);
+        vPeak = _mm256_max_ps(vPeak, framePeak(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                                               _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+    }
+
+    return maxOf(horizontalMax(vPeak),
+                 scalar::convertOutputInterleaved(frames + 2 * i, gain, out + 2 * i, numFrames - i));
+}
+
+FrameStats measureFrames(const int16_t* frames, int numFrames)
+{
+    // Squares and rail hits as in the SSE2 version, 16 samples at a time.
+    const __m256i vHigh = _mm256_set1_epi16(32766);
+    const __m256i vLow = _mm256_set1_epi16(-32766);
+    const __m256i vOnes = _mm256_set1_epi16(1);
+    const __m256i vZero = _mm256_setzero_si256();
+    __m256i vSum = _mm256_setzero_si256();
+    __m256i vClips = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(frames + 2 * i));
+        const __m256i squares = _mm256_madd_epi16(x, x);
+
+        vSum = _mm256_add_epi64(vSum, _mm256_unpacklo_epi32(squares, vZero));
+        vSum = _mm256_add_epi64(vSum, _mm256_unpackhi_epi32(squares, vZero));
+
+        const __m256i hits = _mm256_or_si256(_mm256_cmpgt_epi16(x, vHigh), _mm256_cmpgt_epi16(vLow, x));
+        vClips = _mm256_sub_epi32(vClips, _mm256_madd_epi16(hits, vOnes));
+    }
+
+    FrameStats stats = scalar::measureFrames(frames + 2 * i, numFrames - i);
+    stats.sumOfSquares += horizontalSum64(vSum);
+    stats.clips += horizontalSum32(vClips);
+    return stats;
+}
+
+}} // namespace EngineKernels::avx2
+
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// One record per engine block (BlockSize frames of CloudsEngineT), written by
+// process().
+// Levels are linear (1.0 = full scale); peak is max((|l| + |r|) / 2) as in
+// EngineKernels, RMS is over both channels. Clip counts are int16 samples at
+// the rails (|x| >= 32767) on either side of the GranularProcessor.
+struct alignas(64) TelemetryRecord
+{
+    enum Flags : uint8_t
+    {
+        kIdle           = 1 << 0,   // Prepare()/Process() were skipped
+        kFrozen         = 1 << 1,
+        kPrepareWorker  = 1 << 2,   // prepareMicros includes the worker's Prepare()
+        kPrepareOverrun = 1 << 3,   // the worker had not finished it in time
+        kPrepareDropped = 1 << 4,   // ... and was still running it: block output silent
+    };
+
+    uint64_t blockIndex = 0;
+
+    float inputPeak = 0.0f;
+    float outputPeak = 0.0f;
+    float inputRms = 0.0f;
+    float outputRms = 0.0f;
+
+    float prepareMicros = 0.0f;
+    float processMicros = 0.0f;
+
+    uint16_t inputClips = 0;
+    uint16_t outputClips = 0;
+
+    uint8_t playbackMode = 0;
+    uint8_t quality = 0;
+    uint8_t flags = 0;
+};
+
+//==============================================================================
+// Wait-free single-producer / single-consumer ring of TelemetryRecords.
+//
+// The audio thread pushes; a GUI timer, logger or test drains at its own pace.
+// When the reader falls behind by kCapacity records new records are dropped
+// (and counted) rather than overwriting ones the reader may be copying, so a
+// push is a slot write plus one release store and never waits.
+class TelemetryRing
+{
+public:
+    static constexpr uint32_t kCapacity = 512;   // ~0.5 s of engine blocks
+
+    // --- Producer ---
+    bool push(const TelemetryRecord& record) noexcept
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+
+        if (head - tail_.load(std::memory_order_acquire) == kCapacity)
+        {
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        records_[head & kMask] = record;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // --- Consumer ---
+    // Copies up to maxRecords of the oldest records into dest and returns how many.
+    int drain(TelemetryRecord* dest, int maxRecords) noexcept
+    {
+        int count = 0;
+        forEach([&](const TelemetryRecord& r) { dest[count++] = r; }, maxRecords);
+        return count;
+    }
+
+    // Calls handler(record) for up to maxRecords of the oldest records.
+    template <typename Handler>
+    int forEach(Handler&& handler, int maxRecords = static_cast<int>(kCapacity)) noexcept
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const uint32_t available = head_.load(std::memory_order_acquire) - tail;
+        const uint32_t count = std::min(available, static_cast<uint32_t>(maxRecords > 0 ? maxRecords : 0));
+
+        for (uint32_t i = 0; i < count; ++i)
+            handler(records_[(tail + i) & kMask]);
+
+        tail_.store(tail + count, std::memory_order_release);
+        return static_cast<int>(count);
+    }
+
+    int getNumReady() const noexcept
+    {
+        return static_cast<int>(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed));
+    }
+
+    uint32_t getDroppedCount() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    // Not thread-safe: only while neither side is running.
+    void reset() noexcept
+    {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t kMask = kCapacity - 1;
+    static_assert((kCapacity & kMask) == 0, "kCapacity must be a power of two");
+
+    TelemetryRecord records_[kCapacity];
+
+    alignas(64) std::atomic<uint32_t> head_ { 0 };
+    std::atomic<uint32_t> dropped_ { 0 };
+    alignas(64) std::atomic<uint32_t> tail_ { 0 };
+};
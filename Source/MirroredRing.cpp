@@ -0,0 +1,165 @@
+#include "MirroredRing.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__) || defined(__APPLE__)
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <unistd.h>
+ #define CLOUDS_RING_CAN_MAP 1
+#endif
+
+#if defined(__APPLE__)
+ #include <atomic>
+ #include <cstdio>
+#endif
+
+namespace
+{
+#if CLOUDS_RING_CAN_MAP
+    // A file descriptor for `bytes` of shared memory with no name left
+    // behind in the file system, or -1.
+    int createSharedMemory(size_t bytes)
+    {
+       #if defined(__linux__)
+        const int fd = memfd_create("clouds-ring", MFD_CLOEXEC);
+       #else
+        static std::atomic<int> counter { 0 };
+        char name[64];
+        std::snprintf(name, sizeof(name), "/clouds-ring-%d-%d", static_cast<int>(getpid()), counter++);
+        const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0)
+            shm_unlink(name);
+       #endif
+
+        if (fd < 0)
+            return -1;
+
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Reserves 2 x bytes of address space and maps the same pages into both
+    // halves. Returns nullptr on failure.
+    void* mapMirrored(size_t bytes)
+    {
+        const int fd = createSharedMemory(bytes);
+        if (fd < 0)
+            return nullptr;
+
+        void* reserved = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        auto* base = static_cast<char*>(reserved);
+        void* first = mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        void* second = mmap(base + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        close(fd);
+
+        if (first != base || second != base + bytes)
+        {
+            munmap(reserved, 2 * bytes);
+            return nullptr;
+        }
+        return base;
+    }
+#endif
+}
+
+MirroredRing::~MirroredRing()
+{
+    release();
+}
+
+bool MirroredRing::allocate(int minCapacity, bool allowMapping)
+{
+    release();
+
+    int pageFrames = 1024;
+#if CLOUDS_RING_CAN_MAP
+    pageFrames = std::max(pageFrames, static_cast<int>(sysconf(_SC_PAGESIZE) / static_cast<long>(sizeof(float))));
+#endif
+
+    int capacity = pageFrames;
+    while (capacity < minCapacity)
+        capacity *= 2;
+
+    const size_t bytes = sizeof(float) * static_cast<size_t>(capacity);
+
+#if CLOUDS_RING_CAN_MAP
+    if (allowMapping)
+    {
+        if (void* base = mapMirrored(bytes))
+        {
+            base_ = static_cast<float*>(base);
+            mapped_ = true;
+            mappedBytes_ = 2 * bytes;
+        }
+    }
+#else
+    (void) allowMapping;
+#endif
+
+    if (base_ == nullptr)
+    {
+        base_ = static_cast<float*>(std::calloc(2 * static_cast<size_t>(capacity), sizeof(float)));
+        if (base_ == nullptr)
+            return false;
+    }
+
+    capacity_ = capacity;
+    mask_ = capacity - 1;
+    clear();
+    return true;
+}
+
+void MirroredRing::release()
+{
+    if (base_ == nullptr)
+        return;
+
+#if CLOUDS_RING_CAN_MAP
+    if (mapped_)
+        munmap(base_, mappedBytes_);
+    else
+#endif
+        std::free(base_);
+
+    base_ = nullptr;
+    capacity_ = 0;
+    mask_ = 0;
+    mapped_ = false;
+    mappedBytes_ = 0;
+}
+
+void MirroredRing::publish(int64_t position, int numFrames)
+{
+    if (mapped_ || numFrames <= 0)
+        return;
+
+    // The writer filled [start, start + numFrames) of the 2 x capacity
+    // buffer; copy what landed in the first half to the second and the
+    // other way round.
+    const auto start = static_cast<int>(position & mask_);
+    const int inFirst = std::min(numFrames, capacity_ - start);
+
+    if (inFirst > 0)
+        std::memcpy(base_ + start + capacity_, base_ + start, sizeof(float) * static_cast<size_t>(inFirst));
+    if (numFrames > inFirst)
+        std::memcpy(base_, base_ + capacity_, sizeof(float) * static_cast<size_t>(numFrames - inFirst));
+}
+
+void MirroredRing::clear()
+{
+    if (base_ != nullptr)
+        std::memset(base_, 0, sizeof(float) * static_cast<size_t>(mapped_ ? capacity_ : 2 * capacity_));
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Single-channel float ring whose storage is mapped twice, back to back, so
+// that any window of up to getCapacity() frames starting anywhere in the
+// ring is contiguous in memory: at(p)[0 .. capacity) is valid for every p.
+// Readers and writers work on plain pointers with no wrap handling.
+//
+// Positions are absolute frame counters; at() masks them. On Linux the
+// pages come from memfd_create, on macOS from an unlinked shm_open object.
+// Elsewhere, or if mapping fails, the ring falls back to a 2 x capacity
+// heap buffer and publish() copies each write into the other half, which
+// keeps the same contract at the cost of one extra copy per write.
+class MirroredRing
+{
+public:
+    MirroredRing() = default;
+    ~MirroredRing();
+
+    // Not realtime-safe. Capacity is rounded up to a power of two and a
+    // whole number of pages. Contents are zeroed. allowMapping = false
+    // forces the copying fallback (for tests).
+    bool allocate(int minCapacity, bool allowMapping = true);
+    void release();
+
+    int getCapacity() const { return capacity_; }
+    bool isMirroredByMapping() const { return mapped_; }
+
+    // Start of a window of up to getCapacity() frames at position.
+    float* at(int64_t position) const { return base_ + (position & mask_); }
+
+    // Call after writing numFrames through at(position). No-op when the
+    // ring is mapped.
+    void publish(int64_t position, int numFrames);
+
+    // Zeroes the whole ring.
+    void clear();
+
+private:
+    float* base_ = nullptr;
+    int capacity_ = 0;
+    int64_t mask_ = 0;
+    bool mapped_ = false;
+    size_t mappedBytes_ = 0;
+
+    MirroredRing(const MirroredRing&) = delete;
+    MirroredRing& operator=(const MirroredRing&) = delete;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+
+// Every value CloudsEngine takes from the outside world, published as one
+// coherent set. Freeze and trigger are edges and travel separately through
+// ControlEventQueue so that none is lost between two engine blocks.
+struct EngineParameters
+{
+    float position = 0.5f;
+    float size = 0.5f;
+    float pitch = 0.0f;
+    float density = 0.5f;
+    float texture = 0.5f;
+    float dryWet = 0.5f;
+    float stereoSpread = 0.0f;
+    float feedback = 0.0f;
+    float reverb = 0.0f;
+
+    float inputTrim = 0.5f;
+    float outputGain = 1.6f;
+
+    int playbackMode = 0;
+    int quality = 0;
+};
+
+//==============================================================================
+// Wait-free single-producer / single-consumer triple buffer.
+//
+// The producer fills getWriteBuffer() and calls publish(); the consumer calls
+// update() and then reads read(). Each side owns one of the three slots and
+// the third is swapped through a single atomic, so neither side ever sees a
+// half-written value and neither side ever waits.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    explicit TripleBuffer(const T& initial)
+    {
+        for (auto& b : buffers_)
+            b = initial;
+    }
+
+    // --- Producer ---
+    T& getWriteBuffer() noexcept { return buffers_[writeIndex_]; }
+
+    void publish() noexcept
+    {
+        const int previous = shared_.exchange(writeIndex_ | kDirtyBit, std::memory_order_acq_rel);
+        writeIndex_ = previous & kIndexMask;
+    }
+
+    // --- Consumer ---
+    // Returns true when a newer value was published since the last call.
+    bool update() noexcept
+    {
+        if ((shared_.load(std::memory_order_relaxed) & kDirtyBit) == 0)
+            return false;
+
+        const int previous = shared_.exchange(readIndex_, std::memory_order_acq_rel);
+        readIndex_ = previous & kIndexMask;
+        return true;
+    }
+
+    const T& read() const noexcept { return buffers_[readIndex_]; }
+
+private:
+    static constexpr int kIndexMask = 0x3;
+    static constexpr int kDirtyBit = 0x4;
+
+    T buffers_[3] {};
+    int writeIndex_ = 0;
+    int readIndex_ = 1;
+    alignas(64) std::atomic<int> shared_ { 2 };
+};
+
+//==============================================================================
+// Single-producer / single-consumer queue of freeze and trigger edges.
+class ControlEventQueue
+{
+public:
+    struct Event
+    {
+        enum class Type : uint8_t { Freeze, Trigger };
+
+        Type type;
+        bool value;
+    };
+
+    // Producer. Returns false if the queue is full (the consumer has not run
+    // for kCapacity events), in which case the event is dropped.
+    bool push(Event event) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo_.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 + size2 == 0)
+            return false;
+
+        events_[size1 > 0 ? start1 : start2] = event;
+        fifo_.finishedWrite(1);
+        return true;
+    }
+
+    // Consumer. Calls handler(event) for every queued event, oldest first.
+    template <typename Handler>
+    void drain(Handler&& handler) noexcept
+    {
+        const int numReady = fifo_.getNumReady();
+        if (numReady == 0)
+            return;
+
+        int start1, size1, start2, size2;
+        fifo_.prepareToRead(numReady, start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            handler(events_[start1 + i]);
+        for (int i = 0; i < size2; ++i)
+            handler(events_[start2 + i]);
+
+        fifo_.finishedRead(size1 + size2);
+    }
+
+    bool hasPending() const noexcept { return fifo_.getNumReady() > 0; }
+
+    // Not thread-safe: only while neither side is running.
+    void reset() noexcept { fifo_.reset(); }
+
+    static constexpr int kCapacity = 64;
+
+private:
+    juce::AbstractFifo fifo_ { kCapacity };
+    Event events_[kCapacity] {};
+};
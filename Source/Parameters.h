@@ -54,6 +54,10 @@ inline juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout
     params.push_back(std::make_unique<juce::AudioParameterBool>(
         juce::ParameterID{"trigger", 1}, "Trigger", false));
 
+    // Host bypass: fades to the dry input, then the Clouds chain stops running
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        juce::ParameterID{"bypass", 1}, "Bypass", false));
+
     params.push_back(std::make_unique<juce::AudioParameterChoice>(
         juce::ParameterID{"playback_mode", 1}, "Mode",
         juce::StringArray{"Granular", "Stretch", "Looping Delay", "Spectral"}, 0));
@@ -40,6 +40,19 @@ void MT2Plugin::releaseResources()
     mToneStack.reset();
 }
 
+bool MT2Plugin::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+    // Mono -> mono, mono -> stereo or stereo -> stereo. A mono input runs
+    // the chain once and is copied to the other output channel.
+    const auto in  = layouts.getMainInputChannelSet();
+    const auto out = layouts.getMainOutputChannelSet();
+
+    if (out != juce::AudioChannelSet::mono() && out != juce::AudioChannelSet::stereo())
+        return false;
+
+    return in == juce::AudioChannelSet::mono() || in == out;
+}
+
 void MT2Plugin::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
 {
     juce::ScopedNoDenormals noDenormals;
@@ -47,6 +60,9 @@ void MT2Plugin::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&
     const int numChannels = buffer.getNumChannels();
     const int numSamples  = buffer.getNumSamples();
 
+    // Only as many lanes as the input bus carries; the rest are copies.
+    const int numLanes = juce::jmin(numChannels, getTotalNumInputChannels());
+
     // --- Read parameters ---
     const float dist       = distParam->load();
     const float level      = levelParam->load();
@@ -77,8 +93,8 @@ void MT2Plugin::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&
     const double outputLevel = static_cast<double>(level);
 
     // --- Convert float → double ---
-    mDoubleBuffer.setSize(numChannels, numSamples, false, false, true);
-    for (int ch = 0; ch < numChannels; ++ch)
+    mDoubleBuffer.setSize(numLanes, numSamples, false, false, true);
+    for (int ch = 0; ch < numLanes; ++ch)
         for (int i = 0; i < numSamples; ++i)
             mDoubleBuffer.setSample(ch, i,
                 static_cast<double>(buffer.getSample(ch, i)));
@@ -98,7 +114,7 @@ void MT2Plugin::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&
     mOversampling.processSamplesDown(block);
 
     // --- EQ + output level (at base sample rate) ---
-    for (int ch = 0; ch < numChannels; ++ch) {
+    for (int ch = 0; ch < numLanes; ++ch) {
         for (int i = 0; i < numSamples; ++i) {
             double sample = mDoubleBuffer.getSample(ch, i);
             sample = mToneStack.processSample(sample);
@@ -106,6 +122,10 @@ void MT2Plugin::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&
             buffer.setSample(ch, i, static_cast<float>(sample));
         }
     }
+
+    // --- Mono input to a stereo output ---
+    for (int ch = juce::jmax(1, numLanes); ch < numChannels; ++ch)
+        buffer.copyFrom(ch, 0, buffer, 0, 0, numSamples);
 }
 
 juce::AudioProcessorEditor* MT2Plugin::createEditor()
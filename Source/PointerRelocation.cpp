@@ -0,0 +1,113 @@
+#include "PointerRelocation.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace PointerRelocation
+{
+    namespace
+    {
+        uintptr_t readWord(const void* object, size_t offset)
+        {
+            uintptr_t word;
+            std::memcpy(&word, static_cast<const uint8_t*>(object) + offset, sizeof(word));
+            return word;
+        }
+
+        bool pointsInto(uintptr_t word, const Block& block)
+        {
+            return word >= block.base && word - block.base <= block.size;
+        }
+
+        // Index of the block `word` points into, -1 if none. A pointer
+        // strictly inside a block wins over one past the end of another
+        // block that happens to sit right before it.
+        int findBlock(uintptr_t word, const Block* blocks, size_t numBlocks)
+        {
+            int onePastEnd = -1;
+
+            for (size_t i = 0; i < numBlocks; ++i)
+            {
+                if (!pointsInto(word, blocks[i]))
+                    continue;
+
+                if (word - blocks[i].base < blocks[i].size)
+                    return static_cast<int>(i);
+
+                onePastEnd = static_cast<int>(i);
+            }
+
+            return onePastEnd;
+        }
+    }
+
+    std::vector<uint32_t> findPointers(const void* a, const Block* blocksA,
+                                       const void* b, const Block* blocksB,
+                                       size_t objectSize, size_t numBlocks)
+    {
+        std::vector<uint32_t> offsets;
+
+        for (size_t offset = 0; offset + sizeof(uintptr_t) <= objectSize; offset += alignof(void*))
+        {
+            const uintptr_t wordA = readWord(a, offset);
+            const uintptr_t wordB = readWord(b, offset);
+            if (wordA == wordB)
+                continue;
+
+            for (size_t i = 0; i < numBlocks; ++i)
+            {
+                if (pointsInto(wordA, blocksA[i]) && pointsInto(wordB, blocksB[i])
+                    && wordA - blocksA[i].base == wordB - blocksB[i].base)
+                {
+                    offsets.push_back(static_cast<uint32_t>(offset));
+                    break;
+                }
+            }
+        }
+
+        return offsets;
+    }
+
+    void merge(std::vector<uint32_t>& offsets, const std::vector<uint32_t>& more)
+    {
+        std::vector<uint32_t> merged;
+        std::set_union(offsets.begin(), offsets.end(), more.begin(), more.end(), std::back_inserter(merged));
+        offsets.swap(merged);
+    }
+
+    bool validate(const void* object, size_t objectSize,
+                  const uint32_t* offsets, size_t numOffsets,
+                  const Block* blocks, size_t numBlocks)
+    {
+        for (size_t i = 0; i < numOffsets; ++i)
+        {
+            const size_t offset = offsets[i];
+            if (offset % alignof(void*) != 0 || offset + sizeof(uintptr_t) > objectSize)
+                return false;
+
+            const uintptr_t word = readWord(object, offset);
+            if (word != 0 && findBlock(word, blocks, numBlocks) < 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    void relocate(void* object, const uint32_t* offsets, size_t numOffsets,
+                  const Block* from, const Block* to, size_t numBlocks)
+    {
+        auto* bytes = static_cast<uint8_t*>(object);
+
+        for (size_t i = 0; i < numOffsets; ++i)
+        {
+            uintptr_t word = readWord(object, offsets[i]);
+            const int block = word != 0 ? findBlock(word, from, numBlocks) : -1;
+            if (block < 0)
+                continue;
+
+            word = word - from[block].base + to[block].base;
+            std::memcpy(bytes + offsets[i], &word, sizeof(word));
+        }
+    }
+}
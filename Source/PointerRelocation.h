@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Moving an object that holds absolute pointers into a few memory blocks
+// (itself among them) to new copies of those blocks.
+//
+// A word's value says nothing about whether it is a pointer: a counter, a
+// seed or two packed floats can equal an address as easily as not. So the
+// pointer members are located up front, by offset, and only those are ever
+// rebased. findPointers() compares two copies of the object built the same
+// way over different blocks: a word that differs between them by exactly the
+// distance between the two copies of one block is a pointer into it, and
+// every other word is data.
+namespace PointerRelocation
+{
+    struct Block
+    {
+        uintptr_t base = 0;
+        size_t size = 0;
+    };
+
+    // Byte offsets of the pointer members, pointer-aligned and ascending.
+    // blocksA[i] and blocksB[i] are the two copies of block i. A pointer may
+    // point one past the end of its block.
+    std::vector<uint32_t> findPointers(const void* a, const Block* blocksA,
+                                       const void* b, const Block* blocksB,
+                                       size_t objectSize, size_t numBlocks);
+
+    // Adds the offsets in `more` that `offsets` does not hold yet.
+    void merge(std::vector<uint32_t>& offsets, const std::vector<uint32_t>& more);
+
+    // True when every offset lies inside an object of objectSize bytes and
+    // holds either nullptr or a pointer into (or one past the end of) one of
+    // the blocks.
+    bool validate(const void* object, size_t objectSize,
+                  const uint32_t* offsets, size_t numOffsets,
+                  const Block* blocks, size_t numBlocks);
+
+    // Rebases the pointer at each offset from its block in `from` to the
+    // same block in `to`, leaving nullptr alone. No other word is touched.
+    // Call validate() on the object first.
+    void relocate(void* object, const uint32_t* offsets, size_t numOffsets,
+                  const Block* from, const Block* to, size_t numBlocks);
+}
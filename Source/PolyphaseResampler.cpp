@@ -0,0 +1,932 @@
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <utility>
+
+#if defined(__AVX2__)
+ #include <immintrin.h>
+ #define CLOUDS_RESAMPLER_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define CLOUDS_RESAMPLER_SSE2 1
+#endif
+
+namespace
+{
+    constexpr double kPi = 3.14159265358979323846;
+
+    struct QualitySpec
+    {
+        int zeroCrossings;
+        int attenuationDb;
+    };
+
+    constexpr QualitySpec getSpec(PolyphaseResampler::Quality quality)
+    {
+        switch (quality)
+        {
+            case PolyphaseResampler::Quality::Short: return { 8, 60 };
+            case PolyphaseResampler::Quality::Long:  return { 32, 110 };
+            case PolyphaseResampler::Quality::Medium:
+            default:                                 return { 16, 90 };
+        }
+    }
+
+    // Taps per phase for num / den: zeroCrossings either side of the centre
+    // at the lower rate, rounded up to a whole number of 8-lane vectors.
+    constexpr int getNumTapsFor(int zeroCrossings, int64_t num, int64_t den)
+    {
+        const auto halfTaps = num > den ? (zeroCrossings * num + den - 1) / den : zeroCrossings;
+        return static_cast<int>((2 * halfTaps + 7) / 8 * 8);
+    }
+
+    // Zeroth-order modified Bessel function, by its power series.
+    constexpr double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        const double q = x * x * 0.25;
+        for (int k = 1; k < 64 && term > 1.0e-12 * sum; ++k)
+        {
+            term *= q / (static_cast<double>(k) * static_cast<double>(k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double constexprSqrt(double x)
+    {
+        if (x <= 0.0)
+            return 0.0;
+
+        double r = x > 1.0 ? x : 1.0;
+        for (int i = 0; i < 64; ++i)
+            r = 0.5 * (r + x / r);
+        return r;
+    }
+
+    //==============================================================================
+    // Halfband low-pass with 4M - 1 taps: h[0] = 1/2, h[even] = 0, and the M
+    // odd taps either side stored as g[j] = h[+-(2j + 1)]. sinc(n / 2) at odd
+    // n is exactly +-2 / (pi n), so the design needs no sine and the table is
+    // built by the compiler.
+    template <int M>
+    struct HalfbandTable
+    {
+        float g[M];
+    };
+
+    template <int M, int Attenuation>
+    constexpr HalfbandTable<M> designHalfband()
+    {
+        const double beta = 0.1102 * (Attenuation - 8.7);
+        const double windowNorm = 1.0 / besselI0(beta);
+
+        double raw[M] {};
+        double sum = 0.0;
+        for (int j = 0; j < M; ++j)
+        {
+            const double n = 2.0 * j + 1.0;
+            const double w = n / (2.0 * M);
+            const double sinc = (j % 2 == 0 ? 2.0 : -2.0) / (kPi * n);
+            raw[j] = 0.5 * sinc * besselI0(beta * constexprSqrt(1.0 - w * w)) * windowNorm;
+            sum += raw[j];
+        }
+
+        // Unity DC gain: 1/2 + 2 * sum(g) = 1.
+        HalfbandTable<M> table {};
+        for (int j = 0; j < M; ++j)
+            table.g[j] = static_cast<float>(raw[j] * 0.25 / sum);
+        return table;
+    }
+
+    template <int M, int Attenuation>
+    constexpr HalfbandTable<M> kHalfband = designHalfband<M, Attenuation>();
+
+    // Half-length M and attenuation per quality. The relaxed designs are for
+    // the 128 kHz side of a cascade, which only has to keep images out of
+    // 0-16 kHz and so can have a transition band a quarter of its rate wide.
+    struct HalfbandSpec
+    {
+        int m;
+        int attenuationDb;
+    };
+
+    constexpr HalfbandSpec getHalfbandSpec(PolyphaseResampler::Quality quality, bool relaxed)
+    {
+        if (!relaxed)
+            return { getSpec(quality).zeroCrossings, getSpec(quality).attenuationDb };
+
+        switch (quality)
+        {
+            case PolyphaseResampler::Quality::Short: return { 4, 60 };
+            case PolyphaseResampler::Quality::Long:  return { 8, 110 };
+            case PolyphaseResampler::Quality::Medium:
+            default:                                 return { 6, 90 };
+        }
+    }
+
+    //==============================================================================
+    // Kaiser-windowed sinc rows for the Generic path (kNumPhases rows,
+    // interpolated) or the FixedRatio path (one row per phase of the ratio).
+    std::shared_ptr<const PolyphaseResampler::Table> buildTable(PolyphaseResampler::Quality quality,
+                                                                int64_t numerator, int64_t denominator,
+                                                                bool exactPhases)
+    {
+        const double ratio = static_cast<double>(numerator) / static_cast<double>(denominator);
+        const auto spec = getSpec(quality);
+
+        // Kaiser design: beta from the attenuation, transition width from
+        // beta and the kernel length (both in cycles per sample of the lower
+        // rate). The cutoff sits half a transition below Nyquist so the stop
+        // band starts at the lower rate's Nyquist frequency.
+        const double a = spec.attenuationDb;
+        const double beta = a > 50.0 ? 0.1102 * (a - 8.7) : 0.5842 * std::pow(a - 21.0, 0.4) + 0.07886 * (a - 21.0);
+        const double transition = (a - 7.95) / (14.36 * 2.0 * spec.zeroCrossings);
+        const double cutoffLow = 0.5 - 0.5 * transition;
+
+        // Convert to input samples. Downsampling stretches the kernel.
+        const double cutoff = cutoffLow / std::max(1.0, ratio);
+        const int numTaps = getNumTapsFor(spec.zeroCrossings, numerator, denominator);
+        const double halfWidth = 0.5 * numTaps;
+        const int numPhases = exactPhases ? static_cast<int>(denominator) : PolyphaseResampler::kNumPhases;
+
+        auto table = std::make_shared<PolyphaseResampler::Table>();
+        table->quality = quality;
+        table->ratioNumerator = numerator;
+        table->ratioDenominator = denominator;
+        table->numPhases = numPhases;
+        table->numTaps = numTaps;
+        table->coefficients.assign(static_cast<size_t>((numPhases + 1) * numTaps), 0.0f);
+
+        const double windowNorm = 1.0 / besselI0(beta);
+        std::vector<double> row(static_cast<size_t>(numTaps));
+
+        for (int phase = 0; phase <= numPhases; ++phase)
+        {
+            const double offset = static_cast<double>(phase) / numPhases;
+            double sum = 0.0;
+
+            for (int k = 0; k < numTaps; ++k)
+            {
+                // Tap k reads input frame (centre - numTaps / 2 + 1 + k).
+                const double t = static_cast<double>(k - numTaps / 2 + 1) - offset;
+                const double x = 2.0 * cutoff * t;
+                const double sinc = std::abs(x) < 1.0e-12 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+                const double w = t / halfWidth;
+                const double window = std::abs(w) >= 1.0 ? 0.0 : besselI0(beta * std::sqrt(1.0 - w * w)) * windowNorm;
+
+                row[static_cast<size_t>(k)] = 2.0 * cutoff * sinc * window;
+                sum += row[static_cast<size_t>(k)];
+            }
+
+            // Unity DC gain for every phase, so a constant input stays constant.
+            auto* dest = table->coefficients.data() + static_cast<size_t>(phase * numTaps);
+            for (int k = 0; k < numTaps; ++k)
+                dest[k] = static_cast<float>(row[static_cast<size_t>(k)] / sum);
+        }
+
+        return table;
+    }
+
+    std::mutex tableLock;
+    std::vector<std::shared_ptr<const PolyphaseResampler::Table>> tableCache;
+
+    //==============================================================================
+    // Stereo frames: l and r in the two low lanes of one register, so every
+    // multiply-add serves both channels.
+#if CLOUDS_RESAMPLER_AVX2 || CLOUDS_RESAMPLER_SSE2
+    using Frame = __m128;
+
+    inline Frame loadFrame(const float* p)   { return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p))); }
+    inline Frame frameAdd(Frame a, Frame b)  { return _mm_add_ps(a, b); }
+    inline Frame frameScale(Frame a, float g) { return _mm_mul_ps(a, _mm_set1_ps(g)); }
+    inline Frame zeroFrame()                 { return _mm_setzero_ps(); }
+
+    inline void storeFrame(Frame v, float* l, float* r)
+    {
+        *l = _mm_cvtss_f32(v);
+        *r = _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    }
+
+    // [l, r, l, r] -> [l + l, r + r, ...]
+    inline Frame foldFrames(__m128 v) { return _mm_add_ps(v, _mm_movehl_ps(v, v)); }
+#else
+    struct Frame { float l, r; };
+
+    inline Frame loadFrame(const float* p)   { return { p[0], p[1] }; }
+    inline Frame frameAdd(Frame a, Frame b)  { return { a.l + b.l, a.r + b.r }; }
+    inline Frame frameScale(Frame a, float g) { return { a.l * g, a.r * g }; }
+    inline Frame zeroFrame()                 { return { 0.0f, 0.0f }; }
+
+    inline void storeFrame(Frame v, float* l, float* r)
+    {
+        *l = v.l;
+        *r = v.r;
+    }
+#endif
+
+    // Inner products over interleaved frames. Coefficients are duplicated
+    // into (c, c) pairs in registers, never in memory.
+#if CLOUDS_RESAMPLER_AVX2
+    // 8 taps: c0 c0 c1 c1 c2 c2 c3 c3 against frames 0-3, c4 .. c7 against 4-7.
+    inline void multiplyAdd8(__m256& sum0, __m256& sum1, __m256 c, const float* x)
+    {
+        const __m256i lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+        const __m256i hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_permutevar8x32_ps(c, lo), _mm256_loadu_ps(x)));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_permutevar8x32_ps(c, hi), _mm256_loadu_ps(x + 8)));
+    }
+
+    inline Frame reduce(__m256 sum0, __m256 sum1)
+    {
+        const __m256 sum = _mm256_add_ps(sum0, sum1);
+        return foldFrames(_mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1)));
+    }
+#elif CLOUDS_RESAMPLER_SSE2
+    // 4 taps: c0 c0 c1 c1 against frames 0-1, c2 c2 c3 c3 against 2-3.
+    inline void multiplyAdd4(__m128& sum0, __m128& sum1, __m128 c, const float* x)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_unpacklo_ps(c, c), _mm_loadu_ps(x)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_unpackhi_ps(c, c), _mm_loadu_ps(x + 4)));
+    }
+
+    inline Frame reduce(__m128 sum0, __m128 sum1)
+    {
+        return foldFrames(_mm_add_ps(sum0, sum1));
+    }
+#endif
+
+    // Inner product over a compile-time number of taps; the fold expands to
+    // straight-line code with no loop.
+    template <size_t... I>
+    inline Frame fixedDot(const float* c, const float* x, std::index_sequence<I...>)
+    {
+#if CLOUDS_RESAMPLER_AVX2
+        __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+        (multiplyAdd8(sum0, sum1, _mm256_loadu_ps(c + 8 * I), x + 16 * I), ...);
+        return reduce(sum0, sum1);
+#elif CLOUDS_RESAMPLER_SSE2
+        __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+        (multiplyAdd4(sum0, sum1, _mm_loadu_ps(c + 4 * I), x + 8 * I), ...);
+        return reduce(sum0, sum1);
+#else
+        Frame sum = zeroFrame();
+        ((sum = frameAdd(sum, frameScale(loadFrame(x + 2 * I), c[I]))), ...);
+        return sum;
+#endif
+    }
+
+    template <int Taps>
+    inline Frame fixedDot(const float* c, const float* x)
+    {
+#if CLOUDS_RESAMPLER_AVX2
+        return fixedDot(c, x, std::make_index_sequence<Taps / 8>());
+#elif CLOUDS_RESAMPLER_SSE2
+        return fixedDot(c, x, std::make_index_sequence<Taps / 4>());
+#else
+        return fixedDot(c, x, std::make_index_sequence<Taps>());
+#endif
+    }
+
+    // Mono: coefficients and samples line up lane for lane.
+#if CLOUDS_RESAMPLER_AVX2 || CLOUDS_RESAMPLER_SSE2
+    inline float horizontalSum(__m128 v)
+    {
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+    }
+#endif
+#if CLOUDS_RESAMPLER_AVX2
+    inline float horizontalSum(__m256 v)
+    {
+        return horizontalSum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+    }
+#endif
+
+    template <size_t... I>
+    inline float fixedDotMono(const float* c, const float* x, std::index_sequence<I...>)
+    {
+#if CLOUDS_RESAMPLER_AVX2
+        __m256 sum = _mm256_setzero_ps();
+        ((sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(c + 8 * I), _mm256_loadu_ps(x + 8 * I)))), ...);
+        return horizontalSum(sum);
+#elif CLOUDS_RESAMPLER_SSE2
+        __m128 sum = _mm_setzero_ps();
+        ((sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(c + 4 * I), _mm_loadu_ps(x + 4 * I)))), ...);
+        return horizontalSum(sum);
+#else
+        float sum = 0.0f;
+        ((sum += c[I] * x[I]), ...);
+        return sum;
+#endif
+    }
+
+    template <int Taps>
+    inline float fixedDotMono(const float* c, const float* x)
+    {
+#if CLOUDS_RESAMPLER_AVX2
+        return fixedDotMono(c, x, std::make_index_sequence<Taps / 8>());
+#elif CLOUDS_RESAMPLER_SSE2
+        return fixedDotMono(c, x, std::make_index_sequence<Taps / 4>());
+#else
+        return fixedDotMono(c, x, std::make_index_sequence<Taps>());
+#endif
+    }
+
+    // What the kernels below need per channel count, so each is written once.
+    template <int Channels>
+    struct Lanes;
+
+    template <>
+    struct Lanes<2>
+    {
+        using Value = Frame;
+        static Value load(const float* p)          { return loadFrame(p); }
+        static Value add(Value a, Value b)         { return frameAdd(a, b); }
+        static Value scale(Value a, float g)       { return frameScale(a, g); }
+        static Value zero()                        { return zeroFrame(); }
+        static void store(Value v, float* l, float* r) { storeFrame(v, l, r); }
+
+        template <int Taps>
+        static Value dot(const float* c, const float* x) { return fixedDot<Taps>(c, x); }
+
+        static void interpolatedDot(const float* c0, const float* c1, float mix, const float* x, int numTaps,
+                                    float* l, float* r)
+        {
+            ResamplerKernels::interpolatedDot(c0, c1, mix, x, numTaps, *l, *r);
+        }
+    };
+
+    template <>
+    struct Lanes<1>
+    {
+        using Value = float;
+        static Value load(const float* p)          { return *p; }
+        static Value add(Value a, Value b)         { return a + b; }
+        static Value scale(Value a, float g)       { return a * g; }
+        static Value zero()                        { return 0.0f; }
+        static void store(Value v, float* l, float* r) { *l = v; *r = v; }
+
+        template <int Taps>
+        static Value dot(const float* c, const float* x) { return fixedDotMono<Taps>(c, x); }
+
+        static void interpolatedDot(const float* c0, const float* c1, float mix, const float* x, int numTaps,
+                                    float* l, float* r)
+        {
+            store(ResamplerKernels::interpolatedDotMono(c0, c1, mix, x, numTaps), l, r);
+        }
+    };
+}
+
+//==============================================================================
+PolyphaseResampler::PolyphaseResampler() = default;
+PolyphaseResampler::~PolyphaseResampler() = default;
+
+void PolyphaseResampler::getRatio(double inputRate, double outputRate, int64_t& numerator, int64_t& denominator)
+{
+    numerator = std::max<int64_t>(1, std::llround(inputRate * 1000.0));
+    denominator = std::max<int64_t>(1, std::llround(outputRate * 1000.0));
+
+    const auto divisor = std::gcd(numerator, denominator);
+    numerator /= divisor;
+    denominator /= divisor;
+}
+
+std::shared_ptr<const PolyphaseResampler::Table> PolyphaseResampler::getSharedTable(Quality quality, int64_t numerator,
+                                                                                    int64_t denominator, bool exactPhases)
+{
+    const std::lock_guard<std::mutex> lock(tableLock);
+    const int numPhases = exactPhases ? static_cast<int>(denominator) : kNumPhases;
+
+    for (const auto& table : tableCache)
+        if (table->quality == quality && table->ratioNumerator == numerator && table->ratioDenominator == denominator
+            && table->numPhases == numPhases)
+            return table;
+
+    tableCache.push_back(buildTable(quality, numerator, denominator, exactPhases));
+    return tableCache.back();
+}
+
+void PolyphaseResampler::prepare(double inputRate, double outputRate, Quality quality, int maxInputBlock,
+                                 bool allowSpecialisedPaths)
+{
+    getRatio(inputRate, outputRate, overallNumerator_, overallDenominator_);
+    next_.reset();
+
+    // 128 kHz runs as two halfband stages through 64 kHz. The 128 kHz side
+    // of the cascade gets the relaxed design.
+    const bool down4 = overallNumerator_ == 4 && overallDenominator_ == 1;
+    const bool up4 = overallNumerator_ == 1 && overallDenominator_ == 4;
+
+    if (allowSpecialisedPaths && (down4 || up4))
+    {
+        const int64_t num = down4 ? 2 : 1;
+        const int64_t den = down4 ? 1 : 2;
+        const int secondStageBlock = down4 ? maxInputBlock / 2 + 64 : 2 * maxInputBlock + 64;
+
+        prepareStage(num, den, quality, maxInputBlock, true, down4);
+        next_ = std::make_unique<PolyphaseResampler>();
+        next_->numChannels_ = numChannels_;
+        next_->prepareStage(num, den, quality, secondStageBlock, true, up4);
+        next_->overallNumerator_ = num;
+        next_->overallDenominator_ = den;
+    }
+    else
+    {
+        prepareStage(overallNumerator_, overallDenominator_, quality, maxInputBlock, allowSpecialisedPaths, false);
+    }
+
+    reset();
+}
+
+template <int Num, int Den>
+PolyphaseResampler::Kernels PolyphaseResampler::selectFixed(Quality quality)
+{
+    constexpr int shortTaps = getNumTapsFor(getSpec(Quality::Short).zeroCrossings, Num, Den);
+    constexpr int mediumTaps = getNumTapsFor(getSpec(Quality::Medium).zeroCrossings, Num, Den);
+    constexpr int longTaps = getNumTapsFor(getSpec(Quality::Long).zeroCrossings, Num, Den);
+
+    switch (quality)
+    {
+        case Quality::Short: return { &processFixed<Num, Den, shortTaps, 1>, &processFixed<Num, Den, shortTaps, 2> };
+        case Quality::Long:  return { &processFixed<Num, Den, longTaps, 1>, &processFixed<Num, Den, longTaps, 2> };
+        case Quality::Medium:
+        default:             return { &processFixed<Num, Den, mediumTaps, 1>, &processFixed<Num, Den, mediumTaps, 2> };
+    }
+}
+
+template <int M, int Attenuation>
+PolyphaseResampler::Kernels PolyphaseResampler::selectHalfband(bool down)
+{
+    if (down)
+        return { &processHalfbandDown<M, Attenuation, 1>, &processHalfbandDown<M, Attenuation, 2> };
+
+    return { &processHalfbandUp<M, Attenuation, 1>, &processHalfbandUp<M, Attenuation, 2> };
+}
+
+void PolyphaseResampler::prepareStage(int64_t numerator, int64_t denominator, Quality quality, int maxInputBlock,
+                                      bool allowSpecialisedPaths, bool relaxed)
+{
+    numerator_ = numerator;
+    denominator_ = denominator;
+    stepInt_ = static_cast<int>(numerator_ / denominator_);
+    stepRem_ = numerator_ % denominator_;
+
+    path_ = Path::Generic;
+    kernels_ = { &processGeneric<1>, &processGeneric<2> };
+    table_.reset();
+
+    const auto is = [&](int64_t num, int64_t den)
+    {
+        return allowSpecialisedPaths && numerator == num && denominator == den;
+    };
+
+    if (is(2, 1) || is(1, 2))
+    {
+        const bool down = numerator == 2;
+        const auto spec = getHalfbandSpec(quality, relaxed);
+        path_ = Path::Halfband;
+
+        // Kernel span: down reads c +- (2M - 1), up reads c - M + 1 .. c + M.
+        numTaps_ = down ? 4 * spec.m : 2 * spec.m;
+
+        if (spec.m == 4)
+            kernels_ = selectHalfband<4, 60>(down);
+        else if (spec.m == 6)
+            kernels_ = selectHalfband<6, 90>(down);
+        else if (spec.m == 8 && spec.attenuationDb == 60)
+            kernels_ = selectHalfband<8, 60>(down);
+        else if (spec.m == 8)
+            kernels_ = selectHalfband<8, 110>(down);
+        else if (spec.m == 16)
+            kernels_ = selectHalfband<16, 90>(down);
+        else
+            kernels_ = selectHalfband<32, 110>(down);
+    }
+    else
+    {
+        Kernels fixed;
+        if (is(441, 320))      fixed = selectFixed<441, 320>(quality);     // 44.1 kHz
+        else if (is(320, 441)) fixed = selectFixed<320, 441>(quality);
+        else if (is(3, 2))     fixed = selectFixed<3, 2>(quality);         // 48 kHz
+        else if (is(2, 3))     fixed = selectFixed<2, 3>(quality);
+        else if (is(441, 160)) fixed = selectFixed<441, 160>(quality);     // 88.2 kHz
+        else if (is(160, 441)) fixed = selectFixed<160, 441>(quality);
+        else if (is(3, 1))     fixed = selectFixed<3, 1>(quality);         // 96 kHz
+        else if (is(1, 3))     fixed = selectFixed<1, 3>(quality);
+
+        if (fixed.stereo != nullptr)
+        {
+            path_ = Path::FixedRatio;
+            kernels_ = fixed;
+        }
+
+        table_ = getSharedTable(quality, numerator, denominator, fixed.stereo != nullptr);
+        numTaps_ = table_->numTaps;
+    }
+
+    process_ = numChannels_ == 1 ? kernels_.mono : kernels_.stereo;
+
+    // Sized in stereo frames whatever the channel count, so setNumChannels()
+    // never runs out of room.
+    const int capacity = 2 * numTaps_ + std::max(0, maxInputBlock) + stepInt_ + 8;
+    ring_.allocate(2 * capacity);
+    conversionScratch_.assign(static_cast<size_t>(ring_.getCapacity()), 0.0f);
+}
+
+void PolyphaseResampler::reset()
+{
+    ring_.clear();
+
+    // Half a kernel of silent history; the first output is centred on the
+    // first frame written.
+    writePosition_ = numTaps_ / 2;
+    readIndex_ = writePosition_;
+    readRem_ = 0;
+
+    if (next_ != nullptr)
+        next_->reset();
+}
+
+bool PolyphaseResampler::setRatio(double ratio)
+{
+    if (path_ != Path::Generic || next_ != nullptr || !(ratio > 0.0))
+        return false;
+
+    // Carry the read phase over to the fine grid.
+    if (denominator_ != kVarispeedDenominator)
+    {
+        readRem_ = readRem_ * kVarispeedDenominator / denominator_;
+        denominator_ = kVarispeedDenominator;
+    }
+
+    numerator_ = std::max<int64_t>(1, std::llround(ratio * static_cast<double>(kVarispeedDenominator)));
+    stepInt_ = static_cast<int>(numerator_ / denominator_);
+    stepRem_ = numerator_ % denominator_;
+    overallNumerator_ = numerator_;
+    overallDenominator_ = denominator_;
+    return true;
+}
+
+void PolyphaseResampler::setNumChannels(int numChannels)
+{
+    numChannels = numChannels == 1 ? 1 : 2;
+
+    if (numChannels != numChannels_ && process_ != nullptr && writePosition_ > readIndex_ - numTaps_ / 2 + 1)
+    {
+        // Everything from the oldest frame the next output reads up to the
+        // write position, through the scratch buffer since the two layouts
+        // overlap in the ring.
+        const int64_t first = readIndex_ - numTaps_ / 2 + 1;
+        const int count = static_cast<int>(writePosition_ - first);
+        const float* source = ring_.at(numChannels_ * first);
+        float* scratch = conversionScratch_.data();
+
+        if (numChannels == 1)
+            for (int i = 0; i < count; ++i)
+                scratch[i] = 0.5f * (source[2 * i] + source[2 * i + 1]);
+        else
+            for (int i = 0; i < count; ++i)
+                scratch[2 * i] = scratch[2 * i + 1] = source[i];
+
+        std::memcpy(ring_.at(numChannels * first), scratch, sizeof(float) * static_cast<size_t>(numChannels * count));
+        ring_.publish(numChannels * first, numChannels * count);
+    }
+
+    numChannels_ = numChannels;
+    process_ = numChannels_ == 1 ? kernels_.mono : kernels_.stereo;
+
+    if (next_ != nullptr)
+        next_->setNumChannels(numChannels);
+}
+
+void PolyphaseResampler::offsetReadPosition(int64_t units)
+{
+    // A cascade's first stage counts in its own denominator.
+    readRem_ += next_ != nullptr ? units * denominator_ / overallDenominator_ : units;
+    readIndex_ += readRem_ / denominator_;
+    readRem_ %= denominator_;
+}
+
+int PolyphaseResampler::getWriteSpace() const
+{
+    // Frames before the first one the next output reads can be overwritten.
+    const int64_t oldestNeeded = readIndex_ - numTaps_ / 2 + 1;
+    const int64_t used = std::max<int64_t>(0, writePosition_ - oldestNeeded);
+    return static_cast<int>(std::max<int64_t>(0, ring_.getCapacity() / 2 - used));
+}
+
+void PolyphaseResampler::commitWrite(int numFrames)
+{
+    ring_.publish(numChannels_ * writePosition_, numChannels_ * numFrames);
+    writePosition_ += numFrames;
+}
+
+int PolyphaseResampler::write(const float* l, const float* r, int numFrames)
+{
+    const int n = std::min(numFrames, getWriteSpace());
+    if (n <= 0)
+        return 0;
+
+    float* dest = getWritePointer();
+    if (numChannels_ == 2)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            dest[2 * i] = l[i];
+            dest[2 * i + 1] = r[i];
+        }
+    }
+    else if (r == l)
+    {
+        std::memcpy(dest, l, sizeof(float) * static_cast<size_t>(n));
+    }
+    else
+    {
+        for (int i = 0; i < n; ++i)
+            dest[i] = 0.5f * (l[i] + r[i]);
+    }
+    commitWrite(n);
+    return n;
+}
+
+int PolyphaseResampler::getNumAvailable(int extraInputFrames) const
+{
+    const int available = getStageAvailable(extraInputFrames);
+    return next_ != nullptr ? next_->getNumAvailable(available) : available;
+}
+
+int PolyphaseResampler::getInputFramesNeeded(int numOutputFrames) const
+{
+    return getStageInputFramesNeeded(next_ != nullptr ? next_->getInputFramesNeeded(numOutputFrames)
+                                                      : numOutputFrames);
+}
+
+int PolyphaseResampler::getStageAvailable(int extraInputFrames) const
+{
+    // Output k is centred on readIndex_ + floor((readRem_ + k * num) / den)
+    // and needs half a kernel after its centre. Count the k for which
+    // that centre is at most `span` frames ahead.
+    const int64_t span = writePosition_ + extraInputFrames - numTaps_ / 2 - 1 - readIndex_;
+    if (span < 0)
+        return 0;
+
+    // floor((readRem_ + k * num) / den) <= span  <=>  k * num < (span + 1) * den - readRem_
+    const int64_t limit = (span + 1) * denominator_ - readRem_;
+    return static_cast<int>((limit + numerator_ - 1) / numerator_);
+}
+
+int PolyphaseResampler::getStageInputFramesNeeded(int numOutputFrames) const
+{
+    if (numOutputFrames <= 0)
+        return 0;
+
+    const int64_t lastCentre = readIndex_ + (readRem_ + static_cast<int64_t>(numOutputFrames - 1) * numerator_) / denominator_;
+    return static_cast<int>(std::max<int64_t>(0, lastCentre + numTaps_ / 2 + 1 - writePosition_));
+}
+
+int PolyphaseResampler::process(float* outL, float* outR, int numFrames)
+{
+    return processStages(outL, outR, 1, numFrames);
+}
+
+int PolyphaseResampler::processInterleaved(float* out, int numFrames)
+{
+    return processStages(out, out + 1, 2, numFrames);
+}
+
+int PolyphaseResampler::processStages(float* outL, float* outR, int stride, int numFrames)
+{
+    if (process_ == nullptr)
+        return 0;
+
+    if (next_ == nullptr)
+        return process_(*this, outL, outR, stride, numFrames);
+
+    // Cascade: the first stage writes everything it can straight into the
+    // second stage's history.
+    const int n = std::min(getStageAvailable(0), next_->getWriteSpace());
+    if (n > 0)
+    {
+        float* dest = next_->getWritePointer();
+        next_->commitWrite(process_(*this, dest, dest + numChannels_ - 1, numChannels_, n));
+    }
+
+    return next_->processStages(outL, outR, stride, numFrames);
+}
+
+//==============================================================================
+template <int Channels>
+int PolyphaseResampler::processGeneric(PolyphaseResampler& s, float* outL, float* outR, int stride, int numFrames)
+{
+    using L = Lanes<Channels>;
+    const int numTaps = s.numTaps_;
+    const int half = numTaps / 2;
+    const float* coefficients = s.table_->coefficients.data();
+    int produced = 0;
+
+    while (produced < numFrames && s.readIndex_ + half < s.writePosition_)
+    {
+        const int64_t position = s.readRem_ * kNumPhases;
+        const int phase = static_cast<int>(position / s.denominator_);
+        const float mix = static_cast<float>(position % s.denominator_) / static_cast<float>(s.denominator_);
+        const float* c0 = coefficients + static_cast<size_t>(phase * numTaps);
+        const float* x = s.ring_.at(Channels * (s.readIndex_ - half + 1));
+
+        L::interpolatedDot(c0, c0 + numTaps, mix, x, numTaps, outL + produced * stride, outR + produced * stride);
+        ++produced;
+        s.advance();
+    }
+
+    return produced;
+}
+
+template <int Num, int Den, int Taps, int Channels>
+int PolyphaseResampler::processFixed(PolyphaseResampler& s, float* outL, float* outR, int stride, int numFrames)
+{
+    using L = Lanes<Channels>;
+
+    // Output phases are exactly readRem_ / Den, so row readRem_ of the exact
+    // table is used as it is, and the step is a compile-time constant.
+    constexpr int half = Taps / 2;
+    const float* coefficients = s.table_->coefficients.data();
+    int produced = 0;
+
+    while (produced < numFrames && s.readIndex_ + half < s.writePosition_)
+    {
+        const float* c = coefficients + static_cast<size_t>(s.readRem_) * Taps;
+        const float* x = s.ring_.at(Channels * (s.readIndex_ - half + 1));
+
+        L::store(L::template dot<Taps>(c, x), outL + produced * stride, outR + produced * stride);
+        ++produced;
+
+        s.readIndex_ += Num / Den;
+        s.readRem_ += Num % Den;
+        if (s.readRem_ >= Den)
+        {
+            s.readRem_ -= Den;
+            ++s.readIndex_;
+        }
+    }
+
+    return produced;
+}
+
+template <int M, int Attenuation, int Channels>
+int PolyphaseResampler::processHalfbandDown(PolyphaseResampler& s, float* outL, float* outR, int stride, int numFrames)
+{
+    using L = Lanes<Channels>;
+    constexpr int C = Channels;
+
+    // y[k] = x[c] / 2 + sum_j g[j] * (x[c - 2j - 1] + x[c + 2j + 1]),  c = 2k
+    constexpr auto& g = kHalfband<M, Attenuation>.g;
+    constexpr int half = 2 * M;
+    int produced = 0;
+
+    while (produced < numFrames && s.readIndex_ + half < s.writePosition_)
+    {
+        // Frame c, with the kernel span either side of it contiguous.
+        const float* x = s.ring_.at(C * (s.readIndex_ - half + 1)) + C * (half - 1);
+        auto sum = L::scale(L::load(x), 0.5f);
+
+        for (int j = 0; j < M; ++j)
+            sum = L::add(sum, L::scale(L::add(L::load(x - C * (2 * j + 1)), L::load(x + C * (2 * j + 1))), g[j]));
+
+        L::store(sum, outL + produced * stride, outR + produced * stride);
+        ++produced;
+        s.readIndex_ += 2;
+    }
+
+    return produced;
+}
+
+template <int M, int Attenuation, int Channels>
+int PolyphaseResampler::processHalfbandUp(PolyphaseResampler& s, float* outL, float* outR, int stride, int numFrames)
+{
+    using L = Lanes<Channels>;
+    constexpr int C = Channels;
+
+    // Even outputs are the input frames themselves (2 h[0] = 1). Odd outputs
+    // sit half way between c and c + 1: 2 * sum_j g[j] * (x[c - j] + x[c + 1 + j]).
+    constexpr auto& g = kHalfband<M, Attenuation>.g;
+    constexpr int half = M;
+    int produced = 0;
+
+    while (produced < numFrames && s.readIndex_ + half < s.writePosition_)
+    {
+        const float* x = s.ring_.at(C * (s.readIndex_ - half + 1)) + C * (half - 1);
+
+        if (s.readRem_ == 0)
+        {
+            L::store(L::load(x), outL + produced * stride, outR + produced * stride);
+            s.readRem_ = 1;
+        }
+        else
+        {
+            auto sum = L::zero();
+            for (int j = 0; j < M; ++j)
+                sum = L::add(sum, L::scale(L::add(L::load(x - C * j), L::load(x + C * (1 + j))), g[j]));
+
+            L::store(L::scale(sum, 2.0f), outL + produced * stride, outR + produced * stride);
+            s.readRem_ = 0;
+            ++s.readIndex_;
+        }
+        ++produced;
+    }
+
+    return produced;
+}
+
+//==============================================================================
+void ResamplerKernels::scalar::interpolatedDot(const float* c0, const float* c1, float mix,
+                                               const float* frames, int numTaps,
+                                               float& outL, float& outR)
+{
+    float sumL = 0.0f, sumR = 0.0f;
+    for (int k = 0; k < numTaps; ++k)
+    {
+        const float c = c0[k] + mix * (c1[k] - c0[k]);
+        sumL += c * frames[2 * k];
+        sumR += c * frames[2 * k + 1];
+    }
+    outL = sumL;
+    outR = sumR;
+}
+
+float ResamplerKernels::scalar::interpolatedDotMono(const float* c0, const float* c1, float mix,
+                                                    const float* samples, int numTaps)
+{
+    float sum = 0.0f;
+    for (int k = 0; k < numTaps; ++k)
+        sum += (c0[k] + mix * (c1[k] - c0[k])) * samples[k];
+    return sum;
+}
+
+float ResamplerKernels::interpolatedDotMono(const float* c0, const float* c1, float mix,
+                                           const float* samples, int numTaps)
+{
+#if CLOUDS_RESAMPLER_AVX2
+    const __m256 m = _mm256_set1_ps(mix);
+    __m256 sum = _mm256_setzero_ps();
+
+    for (int k = 0; k < numTaps; k += 8)
+    {
+        const __m256 a = _mm256_loadu_ps(c0 + k);
+        const __m256 c = _mm256_add_ps(a, _mm256_mul_ps(m, _mm256_sub_ps(_mm256_loadu_ps(c1 + k), a)));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(c, _mm256_loadu_ps(samples + k)));
+    }
+
+    return horizontalSum(sum);
+#elif CLOUDS_RESAMPLER_SSE2
+    const __m128 m = _mm_set1_ps(mix);
+    __m128 sum = _mm_setzero_ps();
+
+    for (int k = 0; k < numTaps; k += 4)
+    {
+        const __m128 a = _mm_loadu_ps(c0 + k);
+        const __m128 c = _mm_add_ps(a, _mm_mul_ps(m, _mm_sub_ps(_mm_loadu_ps(c1 + k), a)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c, _mm_loadu_ps(samples + k)));
+    }
+
+    return horizontalSum(sum);
+#else
+    return scalar::interpolatedDotMono(c0, c1, mix, samples, numTaps);
+#endif
+}
+
+void ResamplerKernels::interpolatedDot(const float* c0, const float* c1, float mix,
+                                       const float* frames, int numTaps,
+                                       float& outL, float& outR)
+{
+#if CLOUDS_RESAMPLER_AVX2
+    const __m256 m = _mm256_set1_ps(mix);
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+
+    for (int k = 0; k < numTaps; k += 8)
+    {
+        const __m256 a = _mm256_loadu_ps(c0 + k);
+        multiplyAdd8(sum0, sum1, _mm256_add_ps(a, _mm256_mul_ps(m, _mm256_sub_ps(_mm256_loadu_ps(c1 + k), a))),
+                     frames + 2 * k);
+    }
+
+    storeFrame(reduce(sum0, sum1), &outL, &outR);
+#elif CLOUDS_RESAMPLER_SSE2
+    const __m128 m = _mm_set1_ps(mix);
+    __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+
+    for (int k = 0; k < numTaps; k += 4)
+    {
+        const __m128 a = _mm_loadu_ps(c0 + k);
+        multiplyAdd4(sum0, sum1, _mm_add_ps(a, _mm_mul_ps(m, _mm_sub_ps(_mm_loadu_ps(c1 + k), a))),
+                     frames + 2 * k);
+    }
+
+    storeFrame(reduce(sum0, sum1), &outL, &outR);
+#else
+    scalar::interpolatedDot(c0, c1, mix, frames, numTaps, outL, outR);
+#endif
+}
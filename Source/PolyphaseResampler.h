@@ -0,0 +1,247 @@
+#pragma once
+
+#include "MirroredRing.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Stereo (or mono) windowed-sinc resampler for SampleRateAdapter's
+// host <-> engine rate paths.
+//
+// The prototype low-pass is a Kaiser-windowed sinc cut off just below the
+// lower of the two Nyquist frequencies, tabulated at kNumPhases fractional
+// offsets. Each output sample linearly interpolates the two neighbouring
+// phases and takes one inner product per channel over a contiguous span of
+// the input history, so there is no per-sample ring indexing. Tables depend
+// only on (quality, ratio) and are shared by every resampler in the process.
+//
+// Input history is one MirroredRing of interleaved (l, r) frames, so the
+// kernel span of every output is contiguous wherever it falls in the ring,
+// producers can write straight into it (getWritePointer / commitWrite), and
+// each coefficient is applied to both channels in one SIMD multiply. In
+// mono the ring holds one lane and the kernels take twice the taps per
+// multiply.
+//
+// The rate ratio is held as a reduced integer fraction (441/320 for
+// 44.1 kHz -> 32 kHz) and the read position as an integer frame index plus
+// a remainder in units of 1/denominator. Stepping is exact, so the phase
+// never drifts and the number of outputs any amount of input yields is
+// known in advance (getNumAvailable).
+//
+// prepare() picks the processing path once:
+//   FixedRatio : 44.1, 48, 88.2 and 96 kHz. A kernel instantiated for the
+//                ratio and tap count, with one exact coefficient row per
+//                phase (no interpolation between rows) and unrolled loops.
+//   Halfband   : 64 kHz (one stage) and 128 kHz (two cascaded stages).
+//                Symmetric halfband FIRs from constexpr tables; only the
+//                odd taps are non-zero, so each output costs half the MACs.
+//   Generic    : any other rate.
+// All paths centre output k on input k * ratio, so they have the same
+// timing; they differ only in coefficients and cost.
+class PolyphaseResampler
+{
+public:
+    // Kernel length in zero crossings of the lower rate, and stop-band
+    // attenuation of the window.
+    //   Short  :  8 zero crossings, ~60 dB
+    //   Medium : 16 zero crossings, ~90 dB
+    //   Long   : 32 zero crossings, ~110 dB
+    enum class Quality
+    {
+        Short,
+        Medium,
+        Long
+    };
+
+    enum class Path
+    {
+        Generic,
+        FixedRatio,
+        Halfband
+    };
+
+    static constexpr int kNumPhases = 256;
+
+    struct Table
+    {
+        Quality quality;
+        int64_t ratioNumerator;    // input rate / output rate, reduced
+        int64_t ratioDenominator;
+        int numPhases;         // kNumPhases (interpolated) or ratioDenominator (exact)
+        int numTaps;           // per phase, a multiple of 8
+        std::vector<float> coefficients;   // (numPhases + 1) rows of numTaps
+    };
+
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    // Not realtime-safe (may build a table, allocates the rings).
+    // maxInputBlock is the most input that will be queued between two
+    // process() calls; writes beyond the free space are truncated.
+    // allowSpecialisedPaths = false forces the Generic path (for tests).
+    void prepare(double inputRate, double outputRate, Quality quality, int maxInputBlock,
+                 bool allowSpecialisedPaths = true);
+
+    // Clears the history; the table is kept.
+    void reset();
+
+    // Varispeed: moves the ratio (input frames per output frame) to any
+    // value, effective from the next output, without touching the history
+    // or the read phase. The ratio is then held in units of
+    // 1 / kVarispeedDenominator and the table stays the one prepare() built,
+    // so keep it within a few percent of the prepared ratio. Generic path
+    // only (prepare with allowSpecialisedPaths = false); returns false and
+    // does nothing otherwise. Realtime-safe.
+    bool setRatio(double ratio);
+
+    static constexpr int64_t kVarispeedDenominator = int64_t(1) << 24;
+
+    // Moves the read position units / getRatioDenominator() input frames
+    // forward, which takes the same amount off the delay from input to
+    // output. Call after reset(), before any output is read. In a cascade
+    // the offset is rounded down to the first stage's phase grid.
+    void offsetReadPosition(int64_t units);
+
+    // 2 (interleaved l, r) or 1. Mono is for signals that are the same on
+    // both channels: write() takes (l + r) / 2, or l alone when r is l, and
+    // process() writes the one lane to both outputs. Realtime-safe; the
+    // history still to be read is converted in place (to mono as (l + r) / 2),
+    // so the output carries on without a gap. Kept across prepare().
+    void setNumChannels(int numChannels);
+    int getNumChannels() const { return numChannels_; }
+
+    // Appends input frames; returns how many were taken.
+    int write(const float* l, const float* r, int numFrames);
+
+    // Zero-copy alternative to write(): fill up to getWriteSpace() frames of
+    // getNumChannels() floats through getWritePointer(), then commitWrite() them.
+    int getWriteSpace() const;
+    float* getWritePointer() const { return ring_.at(numChannels_ * writePosition_); }
+    void commitWrite(int numFrames);
+
+    // Output frames that can be produced from the input written so far plus
+    // extraInputFrames more. Exact; does not depend on how the input is split.
+    int getNumAvailable(int extraInputFrames = 0) const;
+
+    // Input frames still to be written before numOutputFrames outputs are
+    // available (0 if they already are).
+    int getInputFramesNeeded(int numOutputFrames) const;
+
+    // Produces up to numFrames output frames, returns how many it produced.
+    int process(float* outL, float* outR, int numFrames);
+    int processInterleaved(float* out, int numFrames);
+
+    Path getPath() const { return path_; }
+    int getNumStages() const { return next_ != nullptr ? 2 : 1; }
+
+    // Kernel span of the first stage, in its input frames.
+    int getNumTaps() const { return numTaps_; }
+    const Table* getTable() const { return table_.get(); }
+
+    // Overall ratio, across both stages of a cascade.
+    int64_t getRatioNumerator() const { return overallNumerator_; }
+    int64_t getRatioDenominator() const { return overallDenominator_; }
+
+    // Rates are taken to the nearest millihertz, so 44100 / 32000 becomes
+    // 441 / 320 and 44099.5 / 32000 becomes 88199 / 64000.
+    static void getRatio(double inputRate, double outputRate, int64_t& numerator, int64_t& denominator);
+
+    // The process-wide table for (quality, ratio), built on first use.
+    // exactPhases selects one row per phase of the ratio instead of
+    // kNumPhases interpolated rows.
+    static std::shared_ptr<const Table> getSharedTable(Quality quality, int64_t numerator, int64_t denominator,
+                                                       bool exactPhases = false);
+
+private:
+    // Output frame i goes to outL[i * stride] and outR[i * stride].
+    using ProcessFunction = int (*)(PolyphaseResampler&, float* outL, float* outR, int stride, int numFrames);
+
+    // Each path's kernel, one instantiation per channel count.
+    struct Kernels
+    {
+        ProcessFunction mono = nullptr;
+        ProcessFunction stereo = nullptr;
+    };
+
+    void prepareStage(int64_t numerator, int64_t denominator, Quality quality, int maxInputBlock,
+                      bool allowSpecialisedPaths, bool relaxed);
+    int getStageAvailable(int extraInputFrames) const;
+    int getStageInputFramesNeeded(int numOutputFrames) const;
+    int processStages(float* outL, float* outR, int stride, int numFrames);
+
+    void advance()
+    {
+        readIndex_ += stepInt_;
+        readRem_ += stepRem_;
+        if (readRem_ >= denominator_)
+        {
+            readRem_ -= denominator_;
+            ++readIndex_;
+        }
+    }
+
+    template <int Channels>
+    static int processGeneric(PolyphaseResampler&, float* outL, float* outR, int stride, int numFrames);
+    template <int Num, int Den, int Taps, int Channels>
+    static int processFixed(PolyphaseResampler&, float* outL, float* outR, int stride, int numFrames);
+    template <int M, int Attenuation, int Channels>
+    static int processHalfbandDown(PolyphaseResampler&, float* outL, float* outR, int stride, int numFrames);
+    template <int M, int Attenuation, int Channels>
+    static int processHalfbandUp(PolyphaseResampler&, float* outL, float* outR, int stride, int numFrames);
+    template <int Num, int Den>
+    static Kernels selectFixed(Quality quality);
+    template <int M, int Attenuation>
+    static Kernels selectHalfband(bool down);
+
+    Path path_ = Path::Generic;
+    Kernels kernels_;
+    ProcessFunction process_ = nullptr;    // kernels_ for numChannels_
+    int numChannels_ = 2;
+    std::shared_ptr<const Table> table_;
+    int numTaps_ = 0;
+
+    // This stage's ratio
+    int64_t numerator_ = 1;
+    int64_t denominator_ = 1;
+    int stepInt_ = 1;          // numerator_ / denominator_
+    int64_t stepRem_ = 0;      // numerator_ % denominator_
+    int64_t overallNumerator_ = 1;
+    int64_t overallDenominator_ = 1;
+
+    // Next output is centred on input frame readIndex_ + readRem_ / denominator_.
+    // Both positions count frames since reset(), including the silent history.
+    int64_t readIndex_ = 0;
+    int64_t readRem_ = 0;
+    int64_t writePosition_ = 0;
+
+    MirroredRing ring_;    // interleaved l, r or one lane; positions above are in frames
+    std::vector<float> conversionScratch_;   // setNumChannels()
+
+    // Second stage of a 128 kHz cascade; this stage writes straight into it.
+    std::unique_ptr<PolyphaseResampler> next_;
+};
+
+// Inner-product kernels, exposed for the tests. Both interpolate the
+// coefficient rows c0 and c1 by `mix` and return the left/right inner
+// products over numTaps interleaved frames (numTaps a multiple of 8). The
+// SIMD version keeps l and r in neighbouring lanes of one register; it
+// differs from the scalar one only in summation order. The mono versions
+// take numTaps contiguous samples.
+namespace ResamplerKernels
+{
+    void interpolatedDot(const float* c0, const float* c1, float mix,
+                         const float* frames, int numTaps,
+                         float& outL, float& outR);
+    float interpolatedDotMono(const float* c0, const float* c1, float mix,
+                              const float* samples, int numTaps);
+
+    namespace scalar
+    {
+        void interpolatedDot(const float* c0, const float* c1, float mix,
+                             const float* frames, int numTaps,
+                             float& outL, float& outR);
+        float interpolatedDotMono(const float* c0, const float* c1, float mix,
+                                  const float* samples, int numTaps);
+    }
+}
@@ -1,117 +1,593 @@
 #include "SampleRateAdapter.h"
 #include <algorithm>
 
-void SampleRateAdapter::prepare(double hostSampleRate, int /*maxBlockSize*/)
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::prepare(double hostSampleRate, int /*maxBlockSize*/, int engineLatency,
+                                double engineSampleRate)
 {
     hostSampleRate_ = hostSampleRate;
-    ratio_ = hostSampleRate / kInternalSampleRate;
+    engineSampleRate_ = engineSampleRate;
+    ratio_ = hostSampleRate / engineSampleRate;
 
-    inputPhase_ = 0.0;
-    inputWritePos_ = 4;
-    inputSamplesAvailable_ = 0;
-    std::memset(inputRingL_, 0, sizeof(inputRingL_));
-    std::memset(inputRingR_, 0, sizeof(inputRingR_));
+    bypassStep_ = 1000.0f / (kBypassFadeMs * static_cast<float>(hostSampleRate));
+    bypassGain_ = bypassTarget_ ? 1.0f : 0.0f;
+    idle_ = false;
+    freshlyPrepared_ = true;
 
-    outputPhase_ = 0.0;
-    outputWritePos_ = 0;
-    outputReadPos_ = 0;
-    outputSamplesAvailable_ = 0;
-    std::memset(outputRingL_, 0, sizeof(outputRingL_));
-    std::memset(outputRingR_, 0, sizeof(outputRingR_));
+    // One lane per bus channel, decided here rather than per callback. The
+    // engine sees the same input either way; a mono downsampler does half
+    // the work. Not for a mono quality with a stereo input: the processor
+    // mixes its dry signal and STEREO SPREAD from the unfolded input.
+    // Every engine block produced from one chunk is queued in the
+    // upsampler before the host output is read, behind the prefill.
+    downsampler_.setNumChannels(numInputChannels_);
+    upsampler_.setNumChannels(numOutputChannels_);
+    downsampler_.prepare(hostSampleRate, engineSampleRate_, resamplerQuality_, kMaxChunkSize, !varispeed_);
+    scheduleSampleValue_ = downsampler_.getRatioDenominator();
+    scheduleBlockCost_ = kBlockSize * downsampler_.getRatioNumerator();
 
-    std::memset(engineInL_, 0, sizeof(engineInL_));
-    std::memset(engineInR_, 0, sizeof(engineInR_));
-    std::memset(engineOutL_, 0, sizeof(engineOutL_));
-    std::memset(engineOutR_, 0, sizeof(engineOutR_));
+    // The prefill is about one block plus both kernel half-spans; the
+    // upsampler's span in engine frames is the downsampler's over the ratio.
+    const int maxPrefill = 4 * kBlockSize + static_cast<int>(std::ceil(2 * downsampler_.getNumTaps() / ratio_));
+    const int maxEngineFrames = static_cast<int>(std::ceil(kMaxChunkSize / ratio_)) + 2 * kBlockSize + maxPrefill;
+    upsampler_.prepare(engineSampleRate_, hostSampleRate, resamplerQuality_, maxEngineFrames, !varispeed_);
+
+    // Varispeed resamplers count phase on the fine grid from the start, so
+    // the alignment below is on the grid setHostRateEstimate() moves on.
+    varispeedTarget_ = hostSampleRate;
+    varispeedRate_ = hostSampleRate;
+    if (varispeed_)
+    {
+        downsampler_.setRatio(hostSampleRate / engineSampleRate_);
+        upsampler_.setRatio(engineSampleRate_ / hostSampleRate);
+    }
+
+    prefill_ = 0;
+    alignmentOffset_ = 0;
+
+    if (!isDirect())
+    {
+        // Engine frames are at most firstBlockInput / ratio behind the host
+        // input (see resetBuffers()); the upsampler needs
+        // getInputFramesNeeded(1) more to reach the output it is asked for,
+        // plus one for rounding in the cascaded paths, whatever the
+        // alignment offset skips, and a few frames for a moving varispeed
+        // ratio.
+        const int64_t upNum = upsampler_.getRatioNumerator();     // engine rate / host rate
+        const int64_t upDen = upsampler_.getRatioDenominator();
+        const int64_t firstBlockInput = downsampler_.getInputFramesNeeded(kBlockSize);
+
+        prefill_ = static_cast<int>((firstBlockInput * upNum + upDen - 1) / upDen
+                                    + upsampler_.getInputFramesNeeded(1) + 1
+                                    + (upNum + upDen - 1) / upDen
+                                    + (varispeed_ ? 4 : 0));
+        jassert(prefill_ <= maxPrefill);
+
+        // Host output k reads engine frame (k * upNum + offset) / upDen - prefill_,
+        // which came from host input k - ((prefill_ + engineLatency) * upDen - offset) / upNum.
+        alignmentOffset_ = ((prefill_ + engineLatency) * upDen) % upNum;
+    }
+
+    // Host-rate dry/wet: the dry signal waits as long as the wet one, and
+    // DRY/WET moves at the engine's 2% per 1 ms block. The delay line holds
+    // the longest latency the engine can report, so that processMix() can
+    // follow a change of playback mode or Prepare() schedule in place.
+    dryDelayEngineLatency_ = engineLatency;
+    dryDelaySamples_ = computeLatencySamples(engineLatency);
+    const int maxDryDelay = std::max(dryDelaySamples_,
+                                     computeLatencySamples(Engine::kBlockSize + Engine::kMaxModeLatencySamples));
+    const auto dryDelaySize = static_cast<size_t>(juce::nextPowerOfTwo(maxDryDelay + kDryChunkSize));
+    dryDelayL_.assign(dryDelaySize, 0.0f);
+    dryDelayR_.assign(dryDelaySize, 0.0f);
+    dryDelayMask_ = static_cast<uint32_t>(dryDelaySize - 1);
+
+    // Host bypass: the same length, for the same latencies.
+    bypassDelayL_.assign(dryDelaySize, 0.0f);
+    bypassDelayR_.assign(dryDelaySize, 0.0f);
+    bypassDelayWrite_ = 0;
+    wetDecay_ = static_cast<float>(std::pow(1.0 - 0.02, 1000.0 / hostSampleRate));
+    wetPrimed_ = false;
+    wetSuspended_ = false;
+
+    resetBuffers();
+    resetDryDelay();
+}
+
+template <int BlockSize>
+int SampleRateAdapterT<BlockSize>::getLatencySamples(const Engine& engine) const
+{
+    return computeLatencySamples(engine.getLatencySamples());
+}
+
+template <int BlockSize>
+int SampleRateAdapterT<BlockSize>::getPublishedLatencySamples(Engine& engine) const
+{
+    // getLatencySamples() on the audio thread, without the control thread's state.
+    return computeLatencySamples(engine.getLatencySamplesForMode(engine.peekParameters().playbackMode));
+}
+
+template <int BlockSize>
+int SampleRateAdapterT<BlockSize>::computeLatencySamples(int engineLatency) const
+{
+    if (isDirect())
+        return kBlockSize + engineLatency;
+
+    const int64_t upNum = upsampler_.getRatioNumerator();
+    const int64_t upDen = upsampler_.getRatioDenominator();
+    const int64_t delay = (prefill_ + engineLatency) * upDen - alignmentOffset_;
+    return static_cast<int>((2 * delay + upNum) / (2 * upNum));
+}
+
+template <int BlockSize>
+int SampleRateAdapterT<BlockSize>::getEngineBlocksForCallback(int numSamples) const
+{
+    if (numSamples <= 0)
+        return 0;
+
+    if (isDirect())
+        return (directFill_ + numSamples) / kBlockSize;
+
+    if (isConstantSchedule())
+    {
+        const int64_t credit = scheduleCredit_ + numSamples * scheduleSampleValue_;
+        return credit > 0 ? static_cast<int>(credit / scheduleBlockCost_) : 0;
+    }
+
+    return downsampler_.getNumAvailable(numSamples) / kBlockSize;
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::resetBuffers()
+{
+    downsampler_.reset();
+    upsampler_.reset();
+
+    std::memset(engineIn_, 0, sizeof(engineIn_));
+    std::memset(directIn_, 0, sizeof(directIn_));
+    std::memset(directOut_, 0, sizeof(directOut_));
+    directFill_ = 0;
+
+    lastOutputL_ = 0.0f;
+    lastOutputR_ = 0.0f;
+
+    scheduleCredit_ = 0;
+
+    if (isDirect())
+        return;
+
+    std::memset(upsampler_.getWritePointer(), 0, sizeof(float) * static_cast<size_t>(numOutputChannels_ * prefill_));
+    upsampler_.commitWrite(prefill_);
+    upsampler_.offsetReadPosition(alignmentOffset_);
+
+    if (isConstantSchedule())
+    {
+        // Block j is due once 1 + firstBlockInput + j * kBlockSize * ratio
+        // host samples are in. Rounding puts the input block j needs at most
+        // one sample past firstBlockInput + j * kBlockSize * ratio, so it is
+        // always there.
+        const int64_t firstBlockInput = downsampler_.getInputFramesNeeded(kBlockSize);
+        scheduleCredit_ = scheduleBlockCost_ - (firstBlockInput + 1) * scheduleSampleValue_;
+    }
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::resetDryDelay()
+{
+    std::fill(dryDelayL_.begin(), dryDelayL_.end(), 0.0f);
+    std::fill(dryDelayR_.begin(), dryDelayR_.end(), 0.0f);
+    dryDelayWrite_ = 0;
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::writeBypassDelay(const float* inL, const float* inR, int numSamples)
+{
+    const uint32_t mask = dryDelayMask_;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const uint32_t index = (bypassDelayWrite_ + static_cast<uint32_t>(i)) & mask;
+        bypassDelayL_[index] = inL[i];
+        bypassDelayR_[index] = inR[i];
+    }
+    bypassDelayWrite_ = (bypassDelayWrite_ + static_cast<uint32_t>(numSamples)) & mask;
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::readBypassDelay(float* outL, float* outR, int numSamples, int delay) const
+{
+    // The last numSamples written, delay samples back.
+    const uint32_t mask = dryDelayMask_;
+    jassert(delay + numSamples <= static_cast<int>(mask + 1));
+    const uint32_t read = bypassDelayWrite_ - static_cast<uint32_t>(numSamples + delay);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const uint32_t index = (read + static_cast<uint32_t>(i)) & mask;
+        outL[i] = bypassDelayL_[index];
+        if (outR != outL)
+            outR[i] = bypassDelayR_[index];
+    }
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::setBusLayout(int numInputChannels, int numOutputChannels)
+{
+    // No stereo -> mono; a stereo output is used instead.
+    jassert(numOutputChannels != 1 || numInputChannels == 1);
+    numInputChannels_ = numInputChannels == 1 ? 1 : 2;
+    numOutputChannels_ = numOutputChannels == 1 && numInputChannels_ == 1 ? 1 : 2;
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::setHostRateEstimate(double actualRate)
+{
+    varispeedTarget_ = juce::jlimit(hostSampleRate_ * (1.0 - kMaxVarispeedDeviation),
+                                    hostSampleRate_ * (1.0 + kMaxVarispeedDeviation),
+                                    actualRate);
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::updateVarispeed(int numSamples)
+{
+    if (varispeedRate_ == varispeedTarget_)
+        return;
+
+    // One-pole glide, advanced by the callback's length. Both resamplers
+    // change together, so the engine frames one produces are the ones the
+    // other consumes and the queue between them stays level.
+    const double glide = std::min(1.0, numSamples / (kVarispeedGlideSeconds * hostSampleRate_));
+    varispeedRate_ += (varispeedTarget_ - varispeedRate_) * glide;
+    if (std::abs(varispeedTarget_ - varispeedRate_) < 1.0e-6)
+        varispeedRate_ = varispeedTarget_;
+
+    downsampler_.setRatio(varispeedRate_ / engineSampleRate_);
+    upsampler_.setRatio(engineSampleRate_ / varispeedRate_);
+}
+
+template <int BlockSize>
+int SampleRateAdapterT<BlockSize>::takeScheduledBlocks(int numSamples)
+{
+    scheduleCredit_ += numSamples * scheduleSampleValue_;
+    if (scheduleCredit_ < scheduleBlockCost_)
+        return 0;
+
+    const int64_t numBlocks = scheduleCredit_ / scheduleBlockCost_;
+    scheduleCredit_ -= numBlocks * scheduleBlockCost_;
+    return static_cast<int>(numBlocks);
 }
 
-void SampleRateAdapter::process(const float* inL, const float* inR,
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::process(const float* inL, const float* inR,
                                  float* outL, float* outR,
                                  int numSamples,
-                                 CloudsEngine& engine)
+                                 Engine& engine)
 {
     if (numSamples <= 0)
         return;
 
-    if (std::abs(hostSampleRate_ - kInternalSampleRate) < 1.0)
+    processCallback(inL, inR, outL, outR, numSamples, engine);
+    freshlyPrepared_ = false;
+
+    // Once per callback, whichever path it took: hands the Prepare() still
+    // owed to the worker, or runs it if no block completed.
+    engine.endCallback();
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::processCallback(const float* inL, const float* inR,
+                                         float* outL, float* outR,
+                                         int numSamples,
+                                         Engine& engine)
+{
+
+    if (numInputChannels_ == 1)
+        inR = inL;
+
+    if constexpr (BlockSize == CloudsEngine::kBlockSize)
+        if (traceRecorder_ != nullptr)
+            traceRecorder_->recordCallback(engine, bypassTarget_, varispeedTarget_, inL, inR, numSamples);
+
+    idle_ = false;
+
+    // Fully bypassed: the input, delayed by the latency the host
+    // compensates for, so that bypassing lines up with the processed
+    // signal; nothing else runs.
+    if (bypassTarget_ && bypassGain_ >= 1.0f)
     {
-        engine.process(inL, inR, outL, outR, numSamples);
+        const int delay = getPublishedLatencySamples(engine);
+        for (int offset = 0; offset < numSamples; offset += kDryChunkSize)
+        {
+            const int n = std::min(kDryChunkSize, numSamples - offset);
+            writeBypassDelay(inL + offset, inR + offset, n);
+            readBypassDelay(outL + offset, outR + offset, n, delay);
+        }
         return;
     }
 
-    // Step 1: Write host input into input ring buffer
-    for (int i = 0; i < numSamples; ++i)
+    // Not bypassed: the delay keeps the input for when bypass starts.
+    if (!bypassTarget_ && bypassGain_ <= 0.0f)
+        writeBypassDelay(inL, inR, numSamples);
+
+    // Leaving full bypass: the rings hold audio from before the bypass.
+    if (bypassGain_ >= 1.0f)
+    {
+        resetBuffers();
+        resetDryDelay();
+    }
+
+    // Idle engine and silent input: the chain would only move silence around.
+    if (bypassGain_ <= 0.0f && !bypassTarget_ && engine.isIdle())
     {
-        inputRingL_[inputWritePos_] = inL[i];
-        inputRingR_[inputWritePos_] = inR[i];
-        inputWritePos_ = (inputWritePos_ + 1) % kInputRingSize;
+        float peak = 0.0f;
+        for (int i = 0; i < numSamples; ++i)
+            peak = std::max(peak, std::max(std::abs(inL[i]), std::abs(inR[i])));
+
+        if (peak <= Engine::kIdleThreshold)
+        {
+            std::memset(outL, 0, sizeof(float) * static_cast<size_t>(numSamples));
+            std::memset(outR, 0, sizeof(float) * static_cast<size_t>(numSamples));
+            idle_ = true;
+            return;
+        }
+    }
+
+    if (bypassGain_ <= 0.0f && !bypassTarget_)
+    {
+        processMix(inL, inR, outL, outR, numSamples, engine);
+        return;
     }
-    inputSamplesAvailable_ += numSamples;
 
-    // Step 2: Downsample → engine → output ring
-    while (inputSamplesAvailable_ >= static_cast<int>(ratio_ * kBlockSize) + 4)
+    // Bypass crossfade, in chunks so the dry copy fits the fixed scratch
+    // buffers. The dry side is delayed like the fully bypassed signal.
+    const float target = bypassTarget_ ? 1.0f : 0.0f;
+    const int delay = getPublishedLatencySamples(engine);
+
+    for (int offset = 0; offset < numSamples; offset += kDryChunkSize)
     {
-        int readBase = (inputWritePos_ - inputSamplesAvailable_ + kInputRingSize) % kInputRingSize;
+        const int n = std::min(kDryChunkSize, numSamples - offset);
+        writeBypassDelay(inL + offset, inR + offset, n);
+        readBypassDelay(dryL_, dryR_, n, delay);
 
-        for (int i = 0; i < kBlockSize; ++i)
+        processMix(inL + offset, inR + offset, outL + offset, outR + offset, n, engine);
+
+        for (int i = 0; i < n; ++i)
         {
-            double hostPos = inputPhase_ + i * ratio_;
-            int intPos = static_cast<int>(hostPos);
-            float frac = static_cast<float>(hostPos - intPos);
-            int ringPos = (readBase + intPos) % kInputRingSize;
+            bypassGain_ = target > bypassGain_ ? std::min(target, bypassGain_ + bypassStep_)
+                                               : std::max(target, bypassGain_ - bypassStep_);
 
-            engineInL_[i] = readInputRing(inputRingL_, ringPos, frac);
-            engineInR_[i] = readInputRing(inputRingR_, ringPos, frac);
+            outL[offset + i] += (dryL_[i] - outL[offset + i]) * bypassGain_;
+            if (outR != outL)
+                outR[offset + i] += (dryR_[i] - outR[offset + i]) * bypassGain_;
         }
+    }
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::processMix(const float* inL, const float* inR,
+                                   float* outL, float* outR,
+                                   int numSamples,
+                                   Engine& engine)
+{
+    if (engine.getHostDryWet() != hostDryWet_)
+    {
+        // Switched without a prepare(): the dry delay starts from silence,
+        // and a suspended chain from its reset state.
+        hostDryWet_ = engine.getHostDryWet();
+        resetDryDelay();
+        if (wetSuspended_)
+            resetBuffers();
+        wetSuspended_ = false;
+        wetPrimed_ = false;
+    }
+
+    if (!hostDryWet_)
+    {
+        processChain(inL, inR, outL, outR, numSamples, engine);
+        return;
+    }
+
+    // The wet signal's latency moves with the engine's playback mode and
+    // Prepare() schedule; the dry signal moves with it. The mode comes
+    // from the published parameters, which the engine also follows while
+    // it is not running.
+    const auto& params = engine.peekParameters();
+    const int engineLatency = engine.getLatencySamplesForMode(params.playbackMode);
+    if (engineLatency != dryDelayEngineLatency_)
+    {
+        dryDelayEngineLatency_ = engineLatency;
+        dryDelaySamples_ = computeLatencySamples(engineLatency);
+    }
+
+    // The processor's own dry level: input trim on the way in, output gain
+    // on the way out.
+    const float target = juce::jlimit(0.0f, 1.0f, params.dryWet);
+    const float dryGain = params.inputTrim * params.outputGain;
+
+    // A session that starts parked at 0% never starts the chain.
+    if (!wetPrimed_)
+    {
+        wet_ = target;
+        wetSuspended_ = target <= 0.0f;
+        wetPrimed_ = true;
+    }
 
-        double consumed = kBlockSize * ratio_;
-        int consumedInt = static_cast<int>(consumed);
-        inputPhase_ = (inputPhase_ + consumed) - consumedInt;
-        inputPhase_ -= static_cast<int>(inputPhase_);
-        inputSamplesAvailable_ -= consumedInt;
+    constexpr float halfPi = juce::MathConstants<float>::halfPi;
+    const uint32_t mask = dryDelayMask_;
 
-        engine.process(engineInL_, engineInR_, engineOutL_, engineOutR_, kBlockSize);
+    for (int offset = 0; offset < numSamples; offset += kDryChunkSize)
+    {
+        const int n = std::min(kDryChunkSize, numSamples - offset);
 
-        for (int i = 0; i < kBlockSize; ++i)
+        // Into the delay before the chain runs: the host may process in place.
+        const uint32_t write = dryDelayWrite_;
+        for (int i = 0; i < n; ++i)
         {
-            outputRingL_[outputWritePos_] = engineOutL_[i];
-            outputRingR_[outputWritePos_] = engineOutR_[i];
-            outputWritePos_ = (outputWritePos_ + 1) % kOutputRingSize;
+            dryDelayL_[(write + static_cast<uint32_t>(i)) & mask] = inL[offset + i];
+            dryDelayR_[(write + static_cast<uint32_t>(i)) & mask] = inR[offset + i];
         }
-        outputSamplesAvailable_ += kBlockSize;
+        dryDelayWrite_ = (write + static_cast<uint32_t>(n)) & mask;
+        const uint32_t read = write - static_cast<uint32_t>(dryDelaySamples_);
+
+        // Smoothed DRY/WET at both ends of the chunk; the gains are
+        // interpolated in between.
+        const float wetStart = wet_;
+        wet_ = target + (wet_ - target) * std::pow(wetDecay_, static_cast<float>(n));
+        if (target <= 0.0f && wet_ < kWetSuspendThreshold)
+            wet_ = 0.0f;
+
+        // Back from 0%: the resamplers hold audio from before, and the wet
+        // gain starts from zero anyway.
+        if (wetSuspended_ && wet_ > 0.0f)
+        {
+            resetBuffers();
+            wetSuspended_ = false;
+        }
+
+        if (wetSuspended_)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                const uint32_t index = (read + static_cast<uint32_t>(i)) & mask;
+                outL[offset + i] = dryDelayL_[index] * dryGain;
+                if (outR != outL)
+                    outR[offset + i] = dryDelayR_[index] * dryGain;
+            }
+            continue;
+        }
+
+        processChain(inL + offset, inR + offset, outL + offset, outR + offset, n, engine);
+
+        const float wetGainStart = std::sin(wetStart * halfPi);
+        const float dryGainStart = std::cos(wetStart * halfPi) * dryGain;
+        const float wetGainStep = (std::sin(wet_ * halfPi) - wetGainStart) / static_cast<float>(n);
+        const float dryGainStep = (std::cos(wet_ * halfPi) * dryGain - dryGainStart) / static_cast<float>(n);
+
+        for (int i = 0; i < n; ++i)
+        {
+            const uint32_t index = (read + static_cast<uint32_t>(i)) & mask;
+            const float wetGain = wetGainStart + wetGainStep * static_cast<float>(i + 1);
+            const float dryMix = dryGainStart + dryGainStep * static_cast<float>(i + 1);
+
+            outL[offset + i] = outL[offset + i] * wetGain + dryDelayL_[index] * dryMix;
+            if (outR != outL)
+                outR[offset + i] = outR[offset + i] * wetGain + dryDelayR_[index] * dryMix;
+        }
+
+        if (wet_ <= 0.0f)
+            wetSuspended_ = true;
+    }
+}
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::processChain(const float* inL, const float* inR,
+                                     float* outL, float* outR,
+                                     int numSamples,
+                                     Engine& engine)
+{
+    if (isDirect())
+    {
+        processDirect(inL, inR, outL, outR, numSamples, engine);
+        return;
     }
 
-    // Step 3: Upsample from output ring → host output
-    double invRatio = 1.0 / ratio_;
+    if (varispeed_)
+        updateVarispeed(numSamples);
 
-    for (int i = 0; i < numSamples; ++i)
+    for (int offset = 0; offset < numSamples; offset += kMaxChunkSize)
     {
-        if (outputSamplesAvailable_ > 4)
+        const int n = std::min(kMaxChunkSize, numSamples - offset);
+
+        // Host input -> engine-rate blocks -> upsampler. The downsampler's
+        // lane count is the input bus's, set in prepare().
+        downsampler_.write(inL + offset, inR + offset, n);
+
+        int numBlocks = isConstantSchedule() ? takeScheduledBlocks(n)
+                                             : downsampler_.getNumAvailable() / kBlockSize;
+
+        for (; numBlocks > 0; --numBlocks)
         {
-            int intPos = static_cast<int>(outputPhase_);
-            float frac = static_cast<float>(outputPhase_ - intPos);
-            int ringPos = (outputReadPos_ + intPos) % kOutputRingSize;
-
-            outL[i] = readOutputRing(outputRingL_, ringPos, frac);
-            outR[i] = readOutputRing(outputRingR_, ringPos, frac);
-
-            outputPhase_ += invRatio;
-            int advance = static_cast<int>(outputPhase_);
-            outputPhase_ -= advance;
-            outputReadPos_ = (outputReadPos_ + advance) % kOutputRingSize;
-            outputSamplesAvailable_ -= advance;
+            // The schedule is built so that this cannot happen; if it does,
+            // the block stays due.
+            if (downsampler_.getNumAvailable() < kBlockSize)
+            {
+                jassertfalse;
+                scheduleCredit_ += numBlocks * scheduleBlockCost_;
+                break;
+            }
+
+            downsampler_.processInterleaved(engineIn_, kBlockSize);
+
+            // The engine writes straight into the upsampler's history, all
+            // in interleaved frames, or through engineOut_ for a mono output.
+            jassert(upsampler_.getWriteSpace() >= kBlockSize);
+            if (numOutputChannels_ == 1)
+            {
+                engine.processInterleaved(engineIn_, engineOut_, kBlockSize);
+                float* dest = upsampler_.getWritePointer();
+                for (int i = 0; i < kBlockSize; ++i)
+                    dest[i] = 0.5f * (engineOut_[2 * i] + engineOut_[2 * i + 1]);
+            }
+            else
+            {
+                engine.processInterleaved(engineIn_, upsampler_.getWritePointer(), kBlockSize);
+            }
+            upsampler_.commitWrite(kBlockSize);
         }
-        else
+
+        // Until the first engine blocks have arrived, hold the last output.
+        const int produced = upsampler_.process(outL + offset, outR + offset, n);
+
+        if (produced > 0)
         {
-            outL[i] = lastOutputL_;
-            outR[i] = lastOutputR_;
+            lastOutputL_ = outL[offset + produced - 1];
+            lastOutputR_ = outR[offset + produced - 1];
         }
 
-        // Update held values
-        if (outputSamplesAvailable_ > 4)
+        if (produced < n)
+            underruns_.fetch_add(static_cast<uint32_t>(n - produced), std::memory_order_relaxed);
+
+        for (int i = produced; i < n; ++i)
         {
-            lastOutputL_ = outL[i];
-            lastOutputR_ = outR[i];
+            outL[offset + i] = lastOutputL_;
+            outR[offset + i] = lastOutputR_;
         }
     }
 }
+
+template <int BlockSize>
+void SampleRateAdapterT<BlockSize>::processDirect(const float* inL, const float* inR,
+                                      float* outL, float* outR,
+                                      int numSamples,
+                                      Engine& engine)
+{
+    for (int offset = 0; offset < numSamples;)
+    {
+        const int n = std::min(kBlockSize - directFill_, numSamples - offset);
+
+        // Input is read before output is written: the host may process in place.
+        for (int i = 0; i < n; ++i)
+        {
+            const int frame = 2 * (directFill_ + i);
+            directIn_[frame] = inL[offset + i];
+            directIn_[frame + 1] = inR[offset + i];
+            outL[offset + i] = directOut_[frame];
+            outR[offset + i] = directOut_[frame + 1];
+        }
+
+        directFill_ += n;
+        offset += n;
+
+        if (directFill_ == kBlockSize)
+        {
+            engine.processInterleaved(directIn_, directOut_, kBlockSize);
+            if (numOutputChannels_ == 1)
+                for (int i = 0; i < kBlockSize; ++i)
+                    directOut_[2 * i] = directOut_[2 * i + 1] = 0.5f * (directOut_[2 * i] + directOut_[2 * i + 1]);
+            directFill_ = 0;
+        }
+    }
+}
+
+template class SampleRateAdapterT<16>;
+template class SampleRateAdapterT<32>;
+template class SampleRateAdapterT<64>;
+template class SampleRateAdapterT<128>;
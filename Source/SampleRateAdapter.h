@@ -2,81 +2,255 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include "CloudsEngine.h"
+#include "PolyphaseResampler.h"
+#include "TraceRecorder.h"
+#include <atomic>
 #include <cmath>
 #include <cstring>
+#include <vector>
 
-class SampleRateAdapter
+// Runs a CloudsEngineT<BlockSize> at the host rate, in whole engine blocks.
+// SampleRateAdapter drives the 32-frame CloudsEngine.
+template <int BlockSize>
+class SampleRateAdapterT
 {
 public:
-    SampleRateAdapter() = default;
-    ~SampleRateAdapter() = default;
+    using Engine = CloudsEngineT<BlockSize>;
 
-    void prepare(double hostSampleRate, int maxBlockSize);
+    SampleRateAdapterT() = default;
+    ~SampleRateAdapterT() = default;
+
+    // engineLatency is the engine's getLatencySamples(). The upsampler phase
+    // is set for it so that the total latency is a whole number of host
+    // samples. engineSampleRate is the engine's getSampleRate(); a host at
+    // that rate takes the direct path, with no resampling.
+    void prepare(double hostSampleRate, int maxBlockSize, int engineLatency = 0,
+                 double engineSampleRate = kInternalSampleRate);
+    double getEngineSampleRate() const { return engineSampleRate_; }
 
     void process(const float* inL, const float* inR,
                  float* outL, float* outR,
                  int numSamples,
-                 CloudsEngine& engine);
+                 Engine& engine);
+
+    // Host bypass. Crossfades to the unprocessed input over kBypassFadeMs,
+    // then stops running the resamplers and the engine altogether. The
+    // input is delayed by getLatencySamples() throughout, so a host that
+    // compensates the reported latency hears no comb filtering against
+    // other tracks, nor a jump in time when bypass is switched.
+    void setBypass(bool shouldBypass) { bypassTarget_ = shouldBypass; }
+    bool isFullyBypassed() const { return bypassTarget_ && bypassGain_ >= 1.0f; }
+
+    // True when the last callback skipped all work because the engine was
+    // idle and the host input was silent.
+    bool isIdle() const { return idle_; }
+
+    static constexpr float kBypassFadeMs = 10.0f;
+
+    // Host-rate dry/wet, while the engine's setHostDryWet() is on. The input
+    // is delayed by getLatencySamples(), following the engine's latency as
+    // its playback mode or Prepare() schedule changes, and crossfaded with the
+    // fully wet engine output in float (equal power), with DRY/WET smoothed
+    // per host sample at the engine's own rate. Once DRY/WET is at 0% and
+    // the smoothed amount has followed it below kWetSuspendThreshold, the
+    // resamplers and the engine stop running until DRY/WET moves again.
+    bool isWetSuspended() const { return wetSuspended_; }
+
+    static constexpr float kWetSuspendThreshold = 1.0e-4f;
+
+    // Kernel length of the host <-> engine rate resamplers. Takes effect at the
+    // next prepare().
+    void setResamplerQuality(PolyphaseResampler::Quality quality) { resamplerQuality_ = quality; }
+    PolyphaseResampler::Quality getResamplerQuality() const { return resamplerQuality_; }
+
+    // Host bus layout: mono -> mono, mono -> stereo or stereo -> stereo.
+    // Takes effect at the next prepare(). A mono input is read from inL
+    // alone; a mono output is (l + r) / 2 of the engine output, written to
+    // outL and to outR as well when that is a different buffer. The
+    // downsampler runs a single lane for a mono input bus, fixed at
+    // prepare(); a stereo bus stays on two lanes even when inL == inR. A
+    // mono quality is not enough, since the processor still mixes its dry
+    // signal from both channels. The upsampler runs a single lane for a
+    // mono output bus.
+    void setBusLayout(int numInputChannels, int numOutputChannels);
+    int getNumInputChannels() const { return numInputChannels_; }
+    int getNumOutputChannels() const { return numOutputChannels_; }
+
+    // How engine blocks are spread over host callbacks on the resampled
+    // paths. Takes effect at the next prepare().
+    //  OnDemand : a block runs as soon as the downsampler has its input.
+    //  Constant : blocks follow a fixed schedule derived from the host
+    //             sample count alone, so a callback of n samples runs
+    //             floor or ceil of n / (kBlockSize * hostRate / engine rate)
+    //             blocks.
+    // Either way the upsampler starts with enough silence that it is never
+    // left short, and that silence is part of getLatencySamples().
+    enum class Scheduling { OnDemand, Constant };
+
+    void setScheduling(Scheduling scheduling) { scheduling_ = scheduling; }
+    Scheduling getScheduling() const { return scheduling_; }
+
+    // Varispeed (asynchronous rate conversion), for hosts whose clock drifts
+    // against the one the engine should follow. Takes effect at the next
+    // prepare(): both resamplers then use the Generic path, a host at the engine
+    // rate included, and scheduling is OnDemand. setHostRateEstimate() moves
+    // the conversion ratio while running, with no re-prepare and no reset;
+    // the ratio glides to a new estimate over kVarispeedGlideSeconds.
+    // getLatencySamples() stays the nominal one.
+    void setVarispeed(bool enabled) { varispeed_ = enabled; }
+    bool isVarispeed() const { return varispeed_; }
+
+    // The host's actual sample rate on the engine's clock, e.g. from a
+    // DriftEstimator. Clamped to kMaxVarispeedDeviation around the prepared
+    // rate. Call from the audio thread, before process().
+    void setHostRateEstimate(double actualRate);
+    double getCurrentHostRate() const { return varispeedRate_; }
+
+    static constexpr double kVarispeedGlideSeconds = 0.05;
+    static constexpr double kMaxVarispeedDeviation = 0.02;
+
+    // Host samples filled by holding the last output because the engine had
+    // not produced them yet. The prefill keeps this at zero.
+    uint32_t getUnderruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+    // Every callback is passed to the recorder (if it is recording) before
+    // anything else happens. Non-owning; null detaches. Traces replay
+    // through a CloudsEngine, so only SampleRateAdapter records.
+    void setTraceRecorder(TraceRecorder* recorder) { traceRecorder_ = recorder; }
 
-    static constexpr double kInternalSampleRate = 32000.0;
-    static constexpr int kBlockSize = 32;
+    // True from prepare() until the first process() call. TraceRecorder
+    // only starts recording from here.
+    bool isFreshlyPrepared() const { return freshlyPrepared_; }
+
+    // Host input to host output, in host samples: the engine's latency plus
+    // the block FIFO of the direct path or the upsampler prefill. Exact when
+    // the engine latency is the one passed to prepare(), otherwise rounded.
+    // The processor reports this to the host via setLatencySamples().
+    int getLatencySamples(const Engine& engine) const;
+
+    // Engine blocks the next process() call of numSamples will run, before
+    // idle/bypass/0% wet short-cuts. Exact: the resampler phase is rational.
+    int getEngineBlocksForCallback(int numSamples) const;
+
+    static constexpr double kInternalSampleRate = Engine::kSampleRate;
+    static constexpr int kBlockSize = Engine::kBlockSize;
 
 private:
+    // Host already at the engine rate: no resampling, only the block FIFO.
+    bool isDirect() const { return !varispeed_ && std::abs(hostSampleRate_ - engineSampleRate_) < 1.0; }
+    bool isConstantSchedule() const { return scheduling_ == Scheduling::Constant && !varispeed_; }
+    void updateVarispeed(int numSamples);
+
+    int computeLatencySamples(int engineLatency) const;
+    int getPublishedLatencySamples(Engine& engine) const;
+    void resetBuffers();
+    void resetDryDelay();
+    void writeBypassDelay(const float* inL, const float* inR, int numSamples);
+    void readBypassDelay(float* outL, float* outR, int numSamples, int delay) const;
+    int takeScheduledBlocks(int numSamples);
+    void processCallback(const float* inL, const float* inR,
+                         float* outL, float* outR,
+                         int numSamples,
+                         Engine& engine);
+    void processDirect(const float* inL, const float* inR,
+                       float* outL, float* outR,
+                       int numSamples,
+                       Engine& engine);
+    void processMix(const float* inL, const float* inR,
+                    float* outL, float* outR,
+                    int numSamples,
+                    Engine& engine);
+    void processChain(const float* inL, const float* inR,
+                      float* outL, float* outR,
+                      int numSamples,
+                      Engine& engine);
+
     double hostSampleRate_ = 44100.0;
+    double engineSampleRate_ = kInternalSampleRate;
     double ratio_ = 1.0;
 
-    double inputPhase_ = 0.0;
+    // processChain() feeds the resamplers at most this many host samples at a time.
+    static constexpr int kMaxChunkSize = 4096;
+
+    PolyphaseResampler::Quality resamplerQuality_ = PolyphaseResampler::Quality::Medium;
+    PolyphaseResampler downsampler_;   // host -> engine rate
+    PolyphaseResampler upsampler_;     // engine rate -> host
+
+    // Constant scheduling. Each host sample earns scheduleSampleValue_ and an
+    // engine block costs scheduleBlockCost_ (den and kBlockSize * num of the
+    // host / engine rate ratio), so the schedule is exact.
+    Scheduling scheduling_ = Scheduling::OnDemand;
+    int64_t scheduleCredit_ = 0;
+    int64_t scheduleSampleValue_ = 1;
+    int64_t scheduleBlockCost_ = 1;
+
+    // Resampled paths: silent engine frames queued in the upsampler at reset,
+    // and the upsampler read offset (in 1 / its ratio denominator) that
+    // makes prefill_ plus the engine latency a whole number of host samples.
+    int prefill_ = 0;
+    int64_t alignmentOffset_ = 0;
 
-    static constexpr int kInputRingSize = 16384;
-    float inputRingL_[kInputRingSize] = {};
-    float inputRingR_[kInputRingSize] = {};
-    int inputWritePos_ = 0;
-    int inputSamplesAvailable_ = 0;
+    std::atomic<uint32_t> underruns_ { 0 };
 
-    double outputPhase_ = 0.0;
+    int numInputChannels_ = 2;
+    int numOutputChannels_ = 2;
 
-    static constexpr int kOutputRingSize = 16384;
-    float outputRingL_[kOutputRingSize] = {};
-    float outputRingR_[kOutputRingSize] = {};
-    int outputWritePos_ = 0;
-    int outputReadPos_ = 0;
-    int outputSamplesAvailable_ = 0;
+    bool varispeed_ = false;
+    double varispeedTarget_ = 44100.0;
+    double varispeedRate_ = 44100.0;
 
-    float engineInL_[kBlockSize] = {};
-    float engineInR_[kBlockSize] = {};
-    float engineOutL_[kBlockSize] = {};
-    float engineOutR_[kBlockSize] = {};
+    // One engine block of interleaved (l, r) frames from the downsampler,
+    // and the engine output of one block on its way to a mono upsampler.
+    float engineIn_[2 * kBlockSize] = {};
+    float engineOut_[2 * kBlockSize] = {};
+
+    // Direct path: the engine only ever runs whole blocks. Host input fills
+    // directIn_ while the previous block's output is read from directOut_
+    // at the same index, so the delay is exactly kBlockSize samples for any
+    // host block size.
+    float directIn_[2 * kBlockSize] = {};
+    float directOut_[2 * kBlockSize] = {};
+    int directFill_ = 0;
 
     float lastOutputL_ = 0.0f;
     float lastOutputR_ = 0.0f;
 
-    static inline float hermite(float xm1, float x0, float x1, float x2, float t)
-    {
-        float c = (x1 - xm1) * 0.5f;
-        float v = x0 - x1;
-        float w = c + v;
-        float a = w + v + (x2 - x0) * 0.5f;
-        float b_neg = w + a;
-        return ((a * t - b_neg) * t + c) * t + x0;
-    }
-
-    inline float readInputRing(const float* ring, int basePos, float frac) const
-    {
-        int im1 = (basePos - 1 + kInputRingSize) % kInputRingSize;
-        int i0  = basePos % kInputRingSize;
-        int i1  = (basePos + 1) % kInputRingSize;
-        int i2  = (basePos + 2) % kInputRingSize;
-        return hermite(ring[im1], ring[i0], ring[i1], ring[i2], frac);
-    }
-
-    inline float readOutputRing(const float* ring, int basePos, float frac) const
-    {
-        int im1 = (basePos - 1 + kOutputRingSize) % kOutputRingSize;
-        int i0  = basePos % kOutputRingSize;
-        int i1  = (basePos + 1) % kOutputRingSize;
-        int i2  = (basePos + 2) % kOutputRingSize;
-        return hermite(ring[im1], ring[i0], ring[i1], ring[i2], frac);
-    }
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleRateAdapter)
+    // Bypass crossfade: 0 = processed, 1 = dry input
+    bool bypassTarget_ = false;
+    float bypassGain_ = 0.0f;
+    float bypassStep_ = 0.0f;
+    bool idle_ = false;
+
+    // Host-rate dry/wet. The dry delay is a power of two that holds the
+    // engine's longest latency plus one kDryChunkSize chunk, read
+    // getLatencySamples() behind for the engine latency last seen; wet_ is
+    // the smoothed DRY/WET, primed to the first value seen after prepare().
+    std::vector<float> dryDelayL_, dryDelayR_;
+    uint32_t dryDelayMask_ = 0;
+    uint32_t dryDelayWrite_ = 0;
+    int dryDelaySamples_ = 0;
+    int dryDelayEngineLatency_ = 0;
+    bool hostDryWet_ = false;
+    bool wetPrimed_ = false;
+    bool wetSuspended_ = false;
+    float wet_ = 0.0f;
+    float wetDecay_ = 1.0f;       // per host sample
+
+    TraceRecorder* traceRecorder_ = nullptr;
+    bool freshlyPrepared_ = false;
+
+    // Host input delayed by getLatencySamples() for bypass, so the dry
+    // signal lines up with the processed one; same size and mask as the
+    // host dry/wet delay. Written on every callback.
+    std::vector<float> bypassDelayL_, bypassDelayR_;
+    uint32_t bypassDelayWrite_ = 0;
+
+    // Delayed host input for the bypass crossfade (the host may process in place)
+    static constexpr int kDryChunkSize = 256;
+    float dryL_[kDryChunkSize] = {};
+    float dryR_[kDryChunkSize] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleRateAdapterT)
 };
+
+using SampleRateAdapter = SampleRateAdapterT<32>;
@@ -0,0 +1,105 @@
+#include "Semaphore.h"
+
+#include <climits>
+
+#if defined(__linux__)
+ #include <cerrno>
+ #include <semaphore.h>
+#elif defined(__APPLE__)
+ #include <dispatch/dispatch.h>
+#elif defined(_WIN32)
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <condition_variable>
+ #include <mutex>
+#endif
+
+#if defined(__linux__)
+struct Semaphore::Native
+{
+    Native() { sem_init(&semaphore, 0, 0); }
+    ~Native() { sem_destroy(&semaphore); }
+
+    void post() { sem_post(&semaphore); }
+
+    void wait()
+    {
+        while (sem_wait(&semaphore) != 0 && errno == EINTR) {}
+    }
+
+    sem_t semaphore;
+};
+#elif defined(__APPLE__)
+struct Semaphore::Native
+{
+    Native() : semaphore(dispatch_semaphore_create(0)) {}
+    ~Native() { dispatch_release(semaphore); }
+
+    void post() { dispatch_semaphore_signal(semaphore); }
+    void wait() { dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER); }
+
+    dispatch_semaphore_t semaphore;
+};
+#elif defined(_WIN32)
+struct Semaphore::Native
+{
+    Native() : semaphore(CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr)) {}
+    ~Native() { CloseHandle(semaphore); }
+
+    void post() { ReleaseSemaphore(semaphore, 1, nullptr); }
+    void wait() { WaitForSingleObject(semaphore, INFINITE); }
+
+    HANDLE semaphore;
+};
+#else
+struct Semaphore::Native
+{
+    void post()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++count;
+        condition.notify_one();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return count > 0; });
+        --count;
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    int count = 0;
+};
+#endif
+
+Semaphore::Semaphore() : native_(std::make_unique<Native>()) {}
+Semaphore::~Semaphore() = default;
+
+void Semaphore::post()
+{
+    // Only a sleeping waiter needs the OS semaphore.
+    if (count_.fetch_add(1, std::memory_order_release) < 0)
+        native_->post();
+}
+
+void Semaphore::wait()
+{
+    if (count_.fetch_sub(1, std::memory_order_acquire) < 1)
+        native_->wait();
+}
+
+bool Semaphore::tryWait()
+{
+    int count = count_.load(std::memory_order_relaxed);
+    while (count > 0)
+    {
+        if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
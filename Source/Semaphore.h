@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+// Counting semaphore for waking a worker thread from the audio thread.
+//
+// The count lives in an atomic, and the OS semaphore underneath is only
+// touched when a thread is asleep in wait() (or about to be): post() is
+// then a single non-blocking system call, otherwise one atomic add. It
+// never takes a lock, so it is realtime-safe. Linux uses a POSIX sem_t,
+// macOS a dispatch semaphore and Windows a kernel semaphore; elsewhere a
+// mutex and condition variable stand in, and post() may then lock.
+class Semaphore
+{
+public:
+    Semaphore();
+    ~Semaphore();
+
+    // Realtime-safe.
+    void post();
+
+    // Blocks until a post() is there to take. Not realtime-safe.
+    void wait();
+
+    // Takes a post() if one is there, without blocking. Realtime-safe.
+    bool tryWait();
+
+    Semaphore(const Semaphore&) = delete;
+    Semaphore& operator=(const Semaphore&) = delete;
+
+private:
+    // > 0: posts nobody has taken yet. < 0: threads asleep in wait().
+    std::atomic<int> count_ { 0 };
+
+    struct Native;
+    std::unique_ptr<Native> native_;
+};
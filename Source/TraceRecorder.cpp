@@ -0,0 +1,383 @@
+#include "TraceRecorder.h"
+#include "SampleRateAdapter.h"
+#include "stmlib/utils/random.h"
+
+#include <cstring>
+
+using namespace TraceFormat;
+
+//==============================================================================
+// Drains the FIFO into the trace file.
+class TraceRecorder::Writer : public juce::Thread
+{
+public:
+    Writer(TraceRecorder& owner, std::unique_ptr<juce::FileOutputStream> stream)
+        : juce::Thread("Clouds Trace Writer"), owner_(owner), stream_(std::move(stream)) {}
+
+    ~Writer() override { stopThread(2000); }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            drain();
+            wait(10);
+        }
+        drain();
+    }
+
+    // After the thread has stopped: terminates the file.
+    void finish()
+    {
+        const uint8_t end = kEnd;
+        stream_->write(&end, 1);
+        stream_->flush();
+    }
+
+private:
+    void drain()
+    {
+        auto& fifo = owner_.fifo_;
+        const int numReady = fifo.getNumReady();
+        if (numReady == 0)
+            return;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+        if (size1 > 0)
+            stream_->write(owner_.fifoBuffer_.data() + start1, static_cast<size_t>(size1));
+        if (size2 > 0)
+            stream_->write(owner_.fifoBuffer_.data() + start2, static_cast<size_t>(size2));
+
+        fifo.finishedRead(size1 + size2);
+    }
+
+    TraceRecorder& owner_;
+    std::unique_ptr<juce::FileOutputStream> stream_;
+};
+
+//==============================================================================
+TraceRecorder::TraceRecorder(size_t fifoBytes)
+    : fifoBuffer_(fifoBytes), fifo_(static_cast<int>(fifoBytes)) {}
+
+TraceRecorder::~TraceRecorder()
+{
+    stop();
+}
+
+bool TraceRecorder::start(const juce::File& file, const CloudsEngine& engine, const SampleRateAdapter& adapter,
+                          double sampleRate, int maxBlockSize)
+{
+    stop();
+
+    // Anything processed since init() / prepare() would be missing from
+    // the replay.
+    if (!engine.isFreshlyInitialised() || !adapter.isFreshlyPrepared())
+        return false;
+
+    file.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(file, 1 << 20);
+    if (stream->failedToOpen())
+        return false;
+
+    TraceHeader header;
+    header.sampleRate = sampleRate;
+    header.maxBlockSize = maxBlockSize;
+    header.rngState = stmlib::Random::state();
+    header.bypass = adapter.isFullyBypassed() ? 1 : 0;
+    header.prepareMode = static_cast<int32_t>(engine.getPrepareMode());
+    header.latencyCompensation = engine.getLatencyCompensation() ? 1 : 0;
+    header.hostDryWet = engine.getHostDryWet() ? 1 : 0;
+    header.idleDetection = engine.getIdleDetectionEnabled() ? 1 : 0;
+    header.resamplerQuality = static_cast<int32_t>(adapter.getResamplerQuality());
+    header.scheduling = static_cast<int32_t>(adapter.getScheduling());
+    header.varispeed = adapter.isVarispeed() ? 1 : 0;
+    header.numInputChannels = adapter.getNumInputChannels();
+    header.numOutputChannels = adapter.getNumOutputChannels();
+
+    if (!stream->write(&header, sizeof(header)))
+        return false;
+
+    fifo_.reset();
+    firstCallback_ = true;
+    lastTriggerCount_ = engine.getTriggerCount();
+    overflowed_.store(false, std::memory_order_relaxed);
+
+    writer_ = std::make_unique<Writer>(*this, std::move(stream));
+    writer_->startThread(juce::Thread::Priority::background);
+
+    recording_.store(true, std::memory_order_release);
+    return true;
+}
+
+void TraceRecorder::stop()
+{
+    if (writer_ == nullptr)
+        return;
+
+    recording_.store(false, std::memory_order_release);
+
+    writer_->stopThread(2000);
+    writer_->finish();
+    writer_.reset();
+}
+
+bool TraceRecorder::push(const uint8_t* const* pieces, const size_t* sizes, int numPieces)
+{
+    size_t total = 0;
+    for (int i = 0; i < numPieces; ++i)
+        total += sizes[i];
+
+    int start1, size1, start2, size2;
+    fifo_.prepareToWrite(static_cast<int>(total), start1, size1, start2, size2);
+
+    if (static_cast<size_t>(size1 + size2) < total)
+        return false;
+
+    // Copy the pieces across the (possibly wrapped) free region, then
+    // publish the whole record at once so the writer never sees half of it.
+    uint8_t* regions[] = { fifoBuffer_.data() + start1, fifoBuffer_.data() + start2 };
+    size_t regionLeft[] = { static_cast<size_t>(size1), static_cast<size_t>(size2) };
+    int region = 0;
+
+    for (int i = 0; i < numPieces; ++i)
+    {
+        const uint8_t* src = pieces[i];
+        size_t remaining = sizes[i];
+
+        while (remaining > 0)
+        {
+            if (regionLeft[region] == 0)
+                ++region;
+
+            const size_t n = std::min(remaining, regionLeft[region]);
+            std::memcpy(regions[region], src, n);
+            regions[region] += n;
+            regionLeft[region] -= n;
+            src += n;
+            remaining -= n;
+        }
+    }
+
+    fifo_.finishedWrite(static_cast<int>(total));
+    return true;
+}
+
+void TraceRecorder::recordCallback(const CloudsEngine& engine, bool bypass, double hostRate,
+                                   const float* inL, const float* inR, int numSamples)
+{
+    if (!recording_.load(std::memory_order_acquire) || overflowed_.load(std::memory_order_relaxed))
+        return;
+
+    // Up to five state records (tag and payload) and one block record (tag,
+    // size and one or two channels), published as one unit.
+    constexpr int kMaxPieces = 14;
+    const uint8_t* pieces[kMaxPieces];
+    size_t sizes[kMaxPieces];
+    int numPieces = 0;
+
+    auto add = [&](const void* data, size_t size)
+    {
+        pieces[numPieces] = static_cast<const uint8_t*>(data);
+        sizes[numPieces] = size;
+        ++numPieces;
+    };
+
+    static constexpr uint8_t tagParameters = kParameters, tagFreeze = kFreeze, tagTrigger = kTrigger,
+                             tagBypass = kBypass, tagHostRate = kHostRate, tagBlock = kBlock,
+                             tagOverflow = kOverflow;
+
+    const auto& parameters = engine.getPendingParameters();
+    const bool freeze = engine.getPendingFreeze();
+    const uint32_t triggerCount = engine.getTriggerCount();
+    const uint8_t freezeByte = freeze ? 1 : 0;
+    const uint8_t bypassByte = bypass ? 1 : 0;
+    const uint32_t newTriggers = triggerCount - lastTriggerCount_;
+    const uint32_t blockSize = static_cast<uint32_t>(std::max(0, numSamples));
+    const bool monoBlock = inL == inR;
+    const uint32_t blockWord = monoBlock ? (blockSize | kMonoBlock) : blockSize;
+
+    if (firstCallback_ || std::memcmp(&parameters, &lastParameters_, sizeof(EngineParameters)) != 0)
+    {
+        add(&tagParameters, 1);
+        add(&parameters, sizeof(EngineParameters));
+    }
+    if (firstCallback_ || freeze != lastFreeze_)
+    {
+        add(&tagFreeze, 1);
+        add(&freezeByte, 1);
+    }
+    if (newTriggers > 0)
+    {
+        add(&tagTrigger, 1);
+        add(&newTriggers, sizeof(newTriggers));
+    }
+    if (firstCallback_ || bypass != lastBypass_)
+    {
+        add(&tagBypass, 1);
+        add(&bypassByte, 1);
+    }
+    if (firstCallback_ || hostRate != lastHostRate_)
+    {
+        add(&tagHostRate, 1);
+        add(&hostRate, sizeof(hostRate));
+    }
+
+    // One buffer for both channels (a mono bus) is stored once.
+    add(&tagBlock, 1);
+    add(&blockWord, sizeof(blockWord));
+    add(inL, sizeof(float) * blockSize);
+    if (!monoBlock)
+        add(inR, sizeof(float) * blockSize);
+
+    if (!push(pieces, sizes, numPieces))
+    {
+        overflowed_.store(true, std::memory_order_relaxed);
+        const uint8_t* overflow[] = { &tagOverflow };
+        const size_t overflowSize[] = { 1 };
+        push(overflow, overflowSize, 1);
+        return;
+    }
+
+    firstCallback_ = false;
+    lastParameters_ = parameters;
+    lastFreeze_ = freeze;
+    lastTriggerCount_ = triggerCount;
+    lastBypass_ = bypass;
+    lastHostRate_ = hostRate;
+}
+
+//==============================================================================
+bool TraceReader::open(const juce::File& file, juce::String& error)
+{
+    data_.reset();
+    if (!file.loadFileAsData(data_) || data_.getSize() < sizeof(TraceHeader))
+    {
+        error = "cannot read " + file.getFullPathName();
+        return false;
+    }
+
+    std::memcpy(&header_, data_.getData(), sizeof(header_));
+
+    const TraceHeader expected;
+    if (header_.magic != expected.magic || header_.version != expected.version)
+    {
+        error = file.getFileName() + " is not a Clouds trace";
+        return false;
+    }
+    if (header_.parametersSize != expected.parametersSize)
+    {
+        error = file.getFileName() + " was recorded by an incompatible build";
+        return false;
+    }
+
+    firstRecord_ = sizeof(TraceHeader);
+    if (header_.maxBlockSize <= 0)
+    {
+        error = file.getFileName() + " is truncated";
+        return false;
+    }
+
+    if (header_.resamplerQuality < static_cast<int32_t>(PolyphaseResampler::Quality::Short)
+        || header_.resamplerQuality > static_cast<int32_t>(PolyphaseResampler::Quality::Long)
+        || header_.scheduling < static_cast<int32_t>(SampleRateAdapter::Scheduling::OnDemand)
+        || header_.scheduling > static_cast<int32_t>(SampleRateAdapter::Scheduling::Constant)
+        || header_.numInputChannels < 1 || header_.numInputChannels > 2
+        || header_.numOutputChannels < 1 || header_.numOutputChannels > 2
+        || header_.prepareMode < static_cast<int32_t>(CloudsEngine::PrepareMode::Inline)
+        || header_.prepareMode > static_cast<int32_t>(CloudsEngine::PrepareMode::Deferred))
+    {
+        error = file.getFileName() + " has an unknown engine or adapter configuration";
+        return false;
+    }
+
+    position_ = firstRecord_;
+    left_.assign(static_cast<size_t>(header_.maxBlockSize), 0.0f);
+    right_.assign(static_cast<size_t>(header_.maxBlockSize), 0.0f);
+    return true;
+}
+
+bool TraceReader::restore(CloudsEngine& engine, SampleRateAdapter& adapter) const
+{
+    if (data_.getSize() < sizeof(TraceHeader))
+        return false;
+
+    engine.setPrepareMode(static_cast<CloudsEngine::PrepareMode>(header_.prepareMode));
+    engine.setLatencyCompensation(header_.latencyCompensation != 0);
+    engine.setHostDryWet(header_.hostDryWet != 0);
+    engine.setIdleDetectionEnabled(header_.idleDetection != 0);
+    engine.init();
+
+    adapter.setBusLayout(header_.numInputChannels, header_.numOutputChannels);
+    adapter.setResamplerQuality(static_cast<PolyphaseResampler::Quality>(header_.resamplerQuality));
+    adapter.setScheduling(static_cast<SampleRateAdapter::Scheduling>(header_.scheduling));
+    adapter.setVarispeed(header_.varispeed != 0);
+    adapter.setBypass(header_.bypass != 0);
+    adapter.prepare(header_.sampleRate, header_.maxBlockSize, engine.getLatencySamples(), engine.getSampleRate());
+    stmlib::Random::Seed(header_.rngState);
+    return true;
+}
+
+bool TraceReader::read(void* dest, size_t size)
+{
+    if (position_ + size > data_.getSize())
+        return false;
+
+    std::memcpy(dest, static_cast<const uint8_t*>(data_.getData()) + position_, size);
+    position_ += size;
+    return true;
+}
+
+bool TraceReader::next(Event& event)
+{
+    uint8_t tag = 0;
+    if (!read(&tag, 1))
+        return false;
+
+    event.tag = static_cast<Tag>(tag);
+
+    switch (tag)
+    {
+        case kParameters:
+            return read(&event.parameters, sizeof(EngineParameters));
+
+        case kFreeze:
+        case kBypass:
+        {
+            uint8_t state = 0;
+            if (!read(&state, 1))
+                return false;
+            event.state = state != 0;
+            return true;
+        }
+
+        case kTrigger:
+            return read(&event.triggers, sizeof(event.triggers));
+
+        case kHostRate:
+            return read(&event.hostRate, sizeof(event.hostRate));
+
+        case kBlock:
+        {
+            uint32_t word = 0;
+            if (!read(&word, sizeof(word)))
+                return false;
+
+            const bool monoBlock = (word & kMonoBlock) != 0;
+            const uint32_t n = word & ~kMonoBlock;
+            if (n > static_cast<uint32_t>(header_.maxBlockSize))
+                return false;
+
+            event.numSamples = static_cast<int>(n);
+            event.left = left_.data();
+            event.right = monoBlock ? left_.data() : right_.data();
+            return read(left_.data(), sizeof(float) * n) && (monoBlock || read(right_.data(), sizeof(float) * n));
+        }
+
+        case kOverflow:
+        case kEnd:
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "CloudsEngine.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+template <int BlockSize> class SampleRateAdapterT;
+using SampleRateAdapter = SampleRateAdapterT<32>;
+
+// Binary trace of everything that reaches SampleRateAdapter::process():
+// host input audio, the parameters, freeze/trigger edges, bypass state and
+// host rate estimate the chain had been given, and the host block
+// boundaries. Recording starts right after init() / prepare(), so the
+// header only needs the engine and adapter configuration they were run
+// with and the stmlib::Random state; replay re-runs init() and prepare()
+// with it, in this build or any other, and reproduces the original output
+// bit for bit.
+//
+// Layout (native endianness, no padding between records):
+//   TraceHeader
+//   records: uint8 tag followed by its payload
+//     Parameters : EngineParameters
+//     Freeze     : uint8 state
+//     Trigger    : uint32 number of setTrigger(true) calls since the last record
+//     Bypass     : uint8 state
+//     HostRate   : double setHostRateEstimate() value (clamped)
+//     Block      : uint32 numSamples, float left[n], float right[n]; with
+//                  kMonoBlock set in numSamples the input was one buffer
+//                  (inL == inR) and only left[n] follows
+//     Overflow   : the recorder fell behind; nothing after this is valid
+//     End        : written by stop()
+namespace TraceFormat
+{
+    enum Tag : uint8_t
+    {
+        kParameters = 1,
+        kFreeze,
+        kTrigger,
+        kBypass,
+        kBlock,
+        kOverflow,
+        kEnd,
+        kHostRate
+    };
+
+    constexpr uint32_t kMonoBlock = 0x80000000u;
+
+    struct TraceHeader
+    {
+        static constexpr uint32_t kMagic = 0x52544c43;   // "CLTR"
+        static constexpr uint32_t kVersion = 3;
+
+        uint32_t magic = kMagic;
+        uint32_t version = kVersion;
+        uint32_t parametersSize = sizeof(EngineParameters);
+        double sampleRate = 0.0;
+        int32_t maxBlockSize = 0;
+        uint32_t rngState = 0;           // stmlib::Random after init()
+        uint32_t bypass = 0;             // adapter bypass state at start()
+
+        // Engine configuration, as set at start().
+        int32_t prepareMode = 0;         // CloudsEngine::PrepareMode
+        uint32_t latencyCompensation = 0;
+        uint32_t hostDryWet = 0;
+        uint32_t idleDetection = 1;
+
+        // Configuration that takes effect at prepare(), as set at start().
+        int32_t resamplerQuality = 0;    // PolyphaseResampler::Quality
+        int32_t scheduling = 0;          // SampleRateAdapter::Scheduling
+        uint32_t varispeed = 0;
+        int32_t numInputChannels = 2;
+        int32_t numOutputChannels = 2;
+    };
+}
+
+//==============================================================================
+// Opt-in recorder. The audio thread serialises each callback into a lock-free
+// FIFO and a background thread writes it to disk. If the writer falls behind
+// by the whole FIFO, recording stops with an Overflow record rather than
+// leaving a gap that would make the replay diverge.
+class TraceRecorder
+{
+public:
+    explicit TraceRecorder(size_t fifoBytes = 8 << 20);
+    ~TraceRecorder();
+
+    // Not realtime-safe. Only valid right after engine.init() and
+    // adapter.prepare(), before either has processed anything (e.g. at the
+    // end of prepareToPlay); returns false otherwise. Records the engine's
+    // Prepare() schedule, latency compensation, host dry/wet and idle
+    // detection, the adapter's bus layout, resampler quality, scheduling
+    // and varispeed, which must be the ones it was prepared with, and the
+    // stmlib::Random state, so the replay's init() starts from the same
+    // place.
+    bool start(const juce::File& file, const CloudsEngine& engine, const SampleRateAdapter& adapter,
+               double sampleRate, int maxBlockSize);
+
+    // Not realtime-safe. Flushes everything recorded so far.
+    void stop();
+
+    bool isRecording() const { return recording_.load(std::memory_order_acquire); }
+    bool hasOverflowed() const { return overflowed_.load(std::memory_order_relaxed); }
+
+    // Audio thread, called by SampleRateAdapter::process() before it touches
+    // the buffers. Reads the engine's control-side state, so the setters
+    // must be called from the same thread (as a processBlock that reads its
+    // parameters at the top of the callback does).
+    void recordCallback(const CloudsEngine& engine, bool bypass, double hostRate,
+                        const float* inL, const float* inR, int numSamples);
+
+private:
+    class Writer;
+
+    bool push(const uint8_t* const* pieces, const size_t* sizes, int numPieces);
+
+    std::vector<uint8_t> fifoBuffer_;
+    juce::AbstractFifo fifo_;
+    std::unique_ptr<Writer> writer_;
+
+    std::atomic<bool> recording_ { false };
+    std::atomic<bool> overflowed_ { false };
+
+    // Audio thread: last state written, so only changes are recorded.
+    bool firstCallback_ = true;
+    EngineParameters lastParameters_;
+    bool lastFreeze_ = false;
+    uint32_t lastTriggerCount_ = 0;
+    bool lastBypass_ = false;
+    double lastHostRate_ = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE(TraceRecorder)
+};
+
+//==============================================================================
+// Reads a trace back for replay.
+class TraceReader
+{
+public:
+    struct Event
+    {
+        TraceFormat::Tag tag = TraceFormat::kEnd;
+        EngineParameters parameters;
+        bool state = false;              // Freeze, Bypass
+        uint32_t triggers = 0;           // Trigger
+        double hostRate = 0.0;           // HostRate
+        int numSamples = 0;              // Block
+        const float* left = nullptr;     // Block; valid until the next call
+        const float* right = nullptr;
+    };
+
+    bool open(const juce::File& file, juce::String& error);
+
+    const TraceFormat::TraceHeader& getHeader() const { return header_; }
+
+    // Configures and init()s the engine, configures and prepares the
+    // adapter and re-seeds stmlib::Random, which puts both into the state
+    // recording started from. Not realtime-safe.
+    bool restore(CloudsEngine& engine, SampleRateAdapter& adapter) const;
+
+    // Next record, or false at the end of the data; event.tag is then End
+    // or Overflow. A truncated trace (the host crashed before stop()) simply
+    // ends early.
+    bool next(Event& event);
+
+    // Back to the first record.
+    void rewind() { position_ = firstRecord_; }
+
+private:
+    bool read(void* dest, size_t size);
+
+    juce::MemoryBlock data_;
+    TraceFormat::TraceHeader header_;
+    size_t firstRecord_ = 0;
+    size_t position_ = 0;
+    std::vector<float> left_, right_;
+};
@@ -1,7 +1,9 @@
 #include <juce_audio_processors/juce_audio_processors.h>
-#include "PluginProcessor.h"
+#include "CloudsProcessor.h"
 #include "CloudsEngine.h"
 
+#include <vector>
+
 //==============================================================================
 class AudioProcessingTests : public juce::UnitTest
 {
@@ -127,6 +129,47 @@ public:
             }
         }
 
+        beginTest("Spectral mode delays the wet signal by kSpectralLatencySamples");
+        {
+            // Measured against the real phase vocoder: noise in, the lag
+            // of the cross-correlation peak out. Within a quarter frame,
+            // the STFT hop.
+            CloudsEngine engine;
+            engine.init();
+            engine.setPlaybackMode(3);   // spectral
+            engine.setDryWet(1.0f);
+            engine.setTexture(0.0f);
+
+            const int latency = engine.getLatencySamples();
+            const int maxLag = 2 * CloudsEngine::kSpectralLatencySamples;
+            const int length = 16 * CloudsEngine::kSpectralLatencySamples;
+
+            juce::Random random(0x5eed);
+            std::vector<float> in(static_cast<size_t>(length)), outL(static_cast<size_t>(length)), outR(static_cast<size_t>(length));
+            for (auto& x : in)
+                x = 0.25f * (2.0f * random.nextFloat() - 1.0f);
+
+            for (int offset = 0; offset < length; offset += 32)
+                engine.process(in.data() + offset, in.data() + offset, outL.data() + offset, outR.data() + offset, 32);
+
+            int bestLag = 0;
+            double best = 0.0;
+            for (int lag = 0; lag <= maxLag; ++lag)
+            {
+                double sum = 0.0;
+                for (int i = maxLag; i < length; ++i)
+                    sum += static_cast<double>(outL[static_cast<size_t>(i)]) * in[static_cast<size_t>(i - lag)];
+                if (std::abs(sum) > best)
+                {
+                    best = std::abs(sum);
+                    bestLag = lag;
+                }
+            }
+
+            expectWithinAbsoluteError(bestLag, latency, CloudsEngine::kSpectralLatencySamples / 4,
+                                      "Measured spectral latency " + juce::String(bestLag));
+        }
+
         beginTest("Freeze behaviour");
         {
             CloudsEngine engine;
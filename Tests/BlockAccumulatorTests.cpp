@@ -0,0 +1,146 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+#include "stmlib/utils/random.h"
+
+#include <vector>
+
+//==============================================================================
+// SampleRateAdapter's block FIFO on the 32 kHz path: whole engine blocks
+// only, a fixed kBlockSize delay, whatever the host block size.
+//==============================================================================
+class BlockAccumulatorTests : public juce::UnitTest
+{
+public:
+    BlockAccumulatorTests() : juce::UnitTest("Block Accumulator Tests") {}
+
+    void runTest() override
+    {
+        constexpr int kBlockSize = CloudsEngine::kBlockSize;
+        constexpr int kNumBlocks = 200;
+        constexpr int kTotal = kNumBlocks * kBlockSize;
+
+        std::vector<float> inL(kTotal), inR(kTotal);
+        for (int i = 0; i < kTotal; ++i)
+        {
+            const float t = static_cast<float>(i) / 32000.0f;
+            inL[static_cast<size_t>(i)] = 0.5f * std::sin(2.0f * 3.14159265f * 440.0f * t);
+            inR[static_cast<size_t>(i)] = 0.3f * std::sin(2.0f * 3.14159265f * 660.0f * t);
+        }
+
+        // The engine on its own, one whole block per call.
+        auto renderReference = [&](CloudsEngine::PrepareMode mode)
+        {
+            stmlib::Random::Seed(0x21);
+            CloudsEngine engine;
+            engine.setPrepareMode(mode);
+            engine.init();
+            engine.setDryWet(0.7f);
+
+            std::vector<float> out(2 * kTotal);
+            for (int block = 0; block < kNumBlocks; ++block)
+            {
+                const int offset = block * kBlockSize;
+                engine.process(inL.data() + offset, inR.data() + offset,
+                               out.data() + offset, out.data() + kTotal + offset, kBlockSize);
+            }
+            return out;
+        };
+
+        auto renderAdapter = [&](CloudsEngine::PrepareMode mode, int hostBlockSize)
+        {
+            stmlib::Random::Seed(0x21);
+            CloudsEngine engine;
+            engine.setPrepareMode(mode);
+            engine.init();
+            engine.setDryWet(0.7f);
+
+            SampleRateAdapter adapter;
+            adapter.prepare(32000.0, hostBlockSize);
+
+            std::vector<float> out(2 * kTotal);
+            for (int offset = 0; offset < kTotal; offset += hostBlockSize)
+            {
+                const int n = std::min(hostBlockSize, kTotal - offset);
+                adapter.process(inL.data() + offset, inR.data() + offset,
+                                out.data() + offset, out.data() + kTotal + offset, n, engine);
+            }
+            return out;
+        };
+
+        // out[i + kBlockSize] == reference[i], bit for bit.
+        auto matchesDelayed = [&](const std::vector<float>& out, const std::vector<float>& reference)
+        {
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                const size_t base = static_cast<size_t>(channel * kTotal);
+                for (int i = 0; i < kBlockSize; ++i)
+                    if (out[base + static_cast<size_t>(i)] != 0.0f)
+                        return false;
+
+                for (int i = 0; i + kBlockSize < kTotal; ++i)
+                    if (out[base + static_cast<size_t>(i + kBlockSize)] != reference[base + static_cast<size_t>(i)])
+                        return false;
+            }
+            return true;
+        };
+
+        beginTest("Any host block size gives the engine output delayed by one block");
+        {
+            const auto reference = renderReference(CloudsEngine::PrepareMode::Inline);
+
+            for (auto hostBlockSize : { 1, 16, 20, 32, 33, 100, 512 })
+                expect(matchesDelayed(renderAdapter(CloudsEngine::PrepareMode::Inline, hostBlockSize), reference),
+                       "host block size " + juce::String(hostBlockSize));
+        }
+
+        beginTest("In-place processing");
+        {
+            stmlib::Random::Seed(0x21);
+            CloudsEngine engine;
+            engine.init();
+            engine.setDryWet(0.7f);
+
+            SampleRateAdapter adapter;
+            adapter.prepare(32000.0, 20);
+
+            std::vector<float> buffer(2 * kTotal);
+            std::copy(inL.begin(), inL.end(), buffer.begin());
+            std::copy(inR.begin(), inR.end(), buffer.begin() + kTotal);
+
+            for (int offset = 0; offset < kTotal; offset += 20)
+            {
+                float* l = buffer.data() + offset;
+                float* r = buffer.data() + kTotal + offset;
+                adapter.process(l, r, l, r, std::min(20, kTotal - offset), engine);
+            }
+
+            expect(matchesDelayed(buffer, renderReference(CloudsEngine::PrepareMode::Inline)));
+        }
+
+        beginTest("The FIFO delay is reported as latency");
+        {
+            CloudsEngine engine;
+            engine.init();
+
+            SampleRateAdapter adapter;
+            adapter.prepare(32000.0, 20);
+            expectEquals(adapter.getLatencySamples(engine), kBlockSize);
+
+            engine.setPrepareMode(CloudsEngine::PrepareMode::Deferred);
+            expectEquals(engine.getLatencySamples(), kBlockSize);
+            expectEquals(adapter.getLatencySamples(engine), 2 * kBlockSize);
+        }
+
+        beginTest("Deferred prepare does not depend on the host block size");
+        {
+            const auto reference = renderReference(CloudsEngine::PrepareMode::Deferred);
+
+            for (auto hostBlockSize : { 1, 16, 20, 33 })
+                expect(matchesDelayed(renderAdapter(CloudsEngine::PrepareMode::Deferred, hostBlockSize), reference),
+                       "host block size " + juce::String(hostBlockSize));
+        }
+    }
+};
+
+static BlockAccumulatorTests blockAccumulatorTests;
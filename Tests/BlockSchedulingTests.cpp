@@ -0,0 +1,156 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+
+#include <vector>
+
+//==============================================================================
+// SampleRateAdapter::Scheduling::Constant: engine blocks per host callback.
+//==============================================================================
+class BlockSchedulingTests : public juce::UnitTest
+{
+public:
+    BlockSchedulingTests() : juce::UnitTest("Block Scheduling Tests") {}
+
+    void runTest() override
+    {
+        using Scheduling = SampleRateAdapter::Scheduling;
+
+        beginTest("Constant scheduling over a million callbacks");
+        {
+            struct Config { double rate; int hostBlockSize; int numCallbacks; };
+            const Config configs[] = {
+                { 44100.0,  64, 400000 },
+                { 48000.0,  32, 200000 },
+                { 88200.0, 100, 150000 },
+                { 96000.0,  20, 100000 },
+                { 128000.0, 48, 100000 },
+                { 22050.0, 256,  50000 },
+            };
+
+            int totalCallbacks = 0;
+
+            for (const auto& config : configs)
+            {
+                CloudsEngine engine;
+                engine.init();
+                engine.setDryWet(0.5f);
+
+                SampleRateAdapter adapter;
+                adapter.setScheduling(Scheduling::Constant);
+                adapter.prepare(config.rate, config.hostBlockSize);
+
+                const int n = config.hostBlockSize;
+                std::vector<float> in(static_cast<size_t>(n)), outL(static_cast<size_t>(n)), outR(static_cast<size_t>(n));
+                for (int i = 0; i < n; ++i)
+                    in[static_cast<size_t>(i)] = 0.25f * std::sin(0.05f * static_cast<float>(i));
+
+                // Host samples per engine block
+                const double samplesPerBlock = SampleRateAdapter::kBlockSize * config.rate / SampleRateAdapter::kInternalSampleRate;
+                const int lowest = static_cast<int>(std::floor(n / samplesPerBlock));
+                const int highest = static_cast<int>(std::ceil(n / samplesPerBlock));
+
+                auto& telemetry = engine.getTelemetry();
+                int minBlocks = 1 << 30, maxBlocks = 0, mispredicted = 0;
+                int64_t totalBlocks = 0;
+
+                for (int callback = 0; callback < config.numCallbacks; ++callback)
+                {
+                    const int predicted = adapter.getEngineBlocksForCallback(n);
+
+                    telemetry.reset();
+                    adapter.process(in.data(), in.data(), outL.data(), outR.data(), n, engine);
+                    const int blocks = telemetry.getNumReady();
+
+                    mispredicted += blocks != predicted ? 1 : 0;
+                    totalBlocks += blocks;
+
+                    // Skip the start, before the first block is due.
+                    if (callback * n > 4 * samplesPerBlock + 256)
+                    {
+                        minBlocks = std::min(minBlocks, blocks);
+                        maxBlocks = std::max(maxBlocks, blocks);
+                    }
+                }
+
+                const auto name = juce::String(config.rate) + " Hz, " + juce::String(n) + " samples";
+                logMessage(name + ": " + juce::String(minBlocks) + " to " + juce::String(maxBlocks)
+                           + " blocks per callback, latency " + juce::String(adapter.getLatencySamples(engine)));
+
+                expectEquals(mispredicted, 0, name);
+                expectGreaterOrEqual(minBlocks, lowest, name);
+                expectLessOrEqual(maxBlocks, highest, name);
+                expectLessOrEqual(maxBlocks - minBlocks, 1, name);
+                expectEquals(static_cast<int>(adapter.getUnderruns()), 0, name);
+
+                // No drift: the total is what the host samples paid for, less
+                // the blocks still due.
+                const double expected = static_cast<double>(config.numCallbacks) * n / samplesPerBlock;
+                expectWithinAbsoluteError(static_cast<double>(totalBlocks), expected, 4.0 + 256.0 / samplesPerBlock);
+
+                totalCallbacks += config.numCallbacks;
+            }
+
+            expectEquals(totalCallbacks, 1000000);
+        }
+
+        beginTest("Constant scheduling follows varying host block sizes");
+        {
+            for (auto rate : { 44100.0, 48000.0, 192000.0 })
+            {
+                CloudsEngine engine;
+                engine.init();
+
+                SampleRateAdapter adapter;
+                adapter.setScheduling(Scheduling::Constant);
+                adapter.prepare(rate, 1024);
+
+                std::vector<float> in(1024, 0.1f), outL(1024), outR(1024);
+                auto random = getRandom();
+                auto& telemetry = engine.getTelemetry();
+
+                const double samplesPerBlock = SampleRateAdapter::kBlockSize * rate / SampleRateAdapter::kInternalSampleRate;
+                int outOfRange = 0;
+
+                for (int callback = 0; callback < 5000; ++callback)
+                {
+                    const int n = 1 + random.nextInt(1024);
+
+                    telemetry.reset();
+                    adapter.process(in.data(), in.data(), outL.data(), outR.data(), n, engine);
+                    const int blocks = telemetry.getNumReady();
+
+                    if (callback > 0 && (blocks < static_cast<int>(std::floor(n / samplesPerBlock))
+                                         || blocks > static_cast<int>(std::ceil(n / samplesPerBlock))))
+                        ++outOfRange;
+                }
+
+                expectEquals(outOfRange, 0, juce::String(rate) + " Hz");
+                expectEquals(static_cast<int>(adapter.getUnderruns()), 0, juce::String(rate) + " Hz");
+            }
+        }
+
+        beginTest("Scheduling does not change the latency");
+        {
+            CloudsEngine engine;
+            engine.init();
+
+            SampleRateAdapter adapter;
+            adapter.prepare(48000.0, 512);
+            const int onDemand = adapter.getLatencySamples(engine);
+
+            adapter.setScheduling(Scheduling::Constant);
+            adapter.prepare(48000.0, 512);
+            const int latency = adapter.getLatencySamples(engine);
+            expectEquals(latency, onDemand);
+            expectGreaterThan(latency, SampleRateAdapter::kBlockSize);
+            expectLessThan(latency, 48 * 5);   // well under 5 ms
+
+            // The 32 kHz path is constant already; its FIFO is all it adds.
+            adapter.prepare(32000.0, 512);
+            expectEquals(adapter.getLatencySamples(engine), SampleRateAdapter::kBlockSize);
+        }
+    }
+};
+
+static BlockSchedulingTests blockSchedulingTests;
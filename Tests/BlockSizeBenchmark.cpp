@@ -0,0 +1,189 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+
+// Per-block overhead of CloudsEngineT / SampleRateAdapterT at 16, 32, 64 and
+// 128 frames per engine block.
+//
+//   BlockSizeBenchmark [--seconds s]
+//
+// Each playback mode renders `seconds` of audio (default 4) twice per block
+// size: straight into the engine at 32 kHz, and through the adapter from a
+// 48 kHz host in 512-sample callbacks. The GranularProcessor does the same
+// work at every size, so the difference is what the wrapper spends per
+// block (parameters, telemetry, conversion, idle checks, resampler hand-off).
+// A least-squares fit of ns/sample = perSample + perBlock / blockSize splits
+// the two; the last column is what each size saves against 32 frames.
+namespace
+{
+    const char* const kModeNames[] = { "granular", "stretch", "looping", "spectral" };
+
+    void fillStimulus(std::vector<float>& l, std::vector<float>& r, double sampleRate)
+    {
+        uint32_t seed = 0x2545f491;
+        for (size_t i = 0; i < l.size(); ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const float noise = static_cast<float>(seed >> 9) / 8388608.0f - 1.0f;
+            const double t = static_cast<double>(i) / sampleRate;
+            l[i] = 0.3f * static_cast<float>(std::sin(6.283185307179586 * 220.0 * t)) + 0.05f * noise;
+            r[i] = 0.3f * static_cast<float>(std::sin(6.283185307179586 * 331.0 * t)) - 0.05f * noise;
+        }
+    }
+
+    template <typename Engine>
+    void setUp(Engine& engine, int mode)
+    {
+        engine.init();
+        engine.setIdleDetectionEnabled(false);
+        engine.setPlaybackMode(mode);
+        engine.setDensity(0.7f);
+        engine.setDryWet(0.7f);
+        engine.setFeedback(0.3f);
+        engine.setReverb(0.3f);
+    }
+
+    // ns per engine sample, engine alone at 32 kHz in blocks of BlockSize.
+    template <int BlockSize>
+    double timeEngine(int mode, double seconds)
+    {
+        auto engine = std::make_unique<CloudsEngineT<BlockSize>>();
+        setUp(*engine, mode);
+
+        const auto length = static_cast<size_t>(32000);
+        std::vector<float> inL(length), inR(length), outL(BlockSize), outR(BlockSize);
+        fillStimulus(inL, inR, 32000.0);
+
+        const auto numBlocks = static_cast<int64_t>(seconds * 32000.0) / BlockSize;
+        size_t readPos = 0;
+        auto run = [&](int64_t blocks)
+        {
+            for (int64_t b = 0; b < blocks; ++b)
+            {
+                if (readPos + BlockSize > length)
+                    readPos = 0;
+                engine->process(inL.data() + readPos, inR.data() + readPos, outL.data(), outR.data(), BlockSize);
+                readPos += BlockSize;
+            }
+        };
+
+        run(numBlocks / 8);
+        const auto start = std::chrono::steady_clock::now();
+        run(numBlocks);
+        const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return wall * 1.0e9 / static_cast<double>(numBlocks * BlockSize);
+    }
+
+    // ns per host sample, 48 kHz host through SampleRateAdapterT<BlockSize>.
+    template <int BlockSize>
+    double timeChain(int mode, double seconds)
+    {
+        constexpr double kHostRate = 48000.0;
+        constexpr int kHostBlockSize = 512;
+
+        auto engine = std::make_unique<CloudsEngineT<BlockSize>>();
+        auto adapter = std::make_unique<SampleRateAdapterT<BlockSize>>();
+        setUp(*engine, mode);
+        adapter->prepare(kHostRate, kHostBlockSize, engine->getLatencySamples(), engine->getSampleRate());
+
+        const auto length = static_cast<size_t>(kHostRate);
+        std::vector<float> inL(length), inR(length), outL(kHostBlockSize), outR(kHostBlockSize);
+        fillStimulus(inL, inR, kHostRate);
+
+        const auto numCallbacks = static_cast<int64_t>(seconds * kHostRate) / kHostBlockSize;
+        size_t readPos = 0;
+        auto run = [&](int64_t callbacks)
+        {
+            for (int64_t c = 0; c < callbacks; ++c)
+            {
+                if (readPos + kHostBlockSize > length)
+                    readPos = 0;
+                adapter->process(inL.data() + readPos, inR.data() + readPos, outL.data(), outR.data(),
+                                 kHostBlockSize, *engine);
+                readPos += kHostBlockSize;
+            }
+        };
+
+        run(numCallbacks / 8);
+        const auto start = std::chrono::steady_clock::now();
+        run(numCallbacks);
+        const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return wall * 1.0e9 / static_cast<double>(numCallbacks * kHostBlockSize);
+    }
+
+    // ns/sample at 16, 32, 64, 128 -> perSample + perBlock / blockSize.
+    void report(const char* label, const double (&nsPerSample)[4])
+    {
+        constexpr int kSizes[] = { 16, 32, 64, 128 };
+
+        double meanX = 0.0, meanY = 0.0;
+        for (int i = 0; i < 4; ++i)
+        {
+            meanX += 1.0 / kSizes[i] / 4.0;
+            meanY += nsPerSample[i] / 4.0;
+        }
+
+        double covariance = 0.0, variance = 0.0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const double dx = 1.0 / kSizes[i] - meanX;
+            covariance += dx * (nsPerSample[i] - meanY);
+            variance += dx * dx;
+        }
+
+        const double perBlock = covariance / variance;
+        const double perSample = meanY - perBlock * meanX;
+
+        std::cout << "  " << std::setw(7) << label << std::fixed << std::setprecision(1);
+        for (int i = 0; i < 4; ++i)
+            std::cout << std::setw(9) << nsPerSample[i];
+        std::cout << "   per block " << std::setw(7) << perBlock << " ns, per sample " << std::setw(6) << perSample << " ns";
+        std::cout << "   saved vs 32:";
+        for (int i = 0; i < 4; ++i)
+            std::cout << std::setw(6) << std::setprecision(1) << 100.0 * (1.0 - nsPerSample[i] / nsPerSample[1]) << "%";
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = 4.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc)
+            seconds = std::max(0.05, std::atof(argv[++i]));
+        else
+        {
+            std::cerr << "usage: BlockSizeBenchmark [--seconds s]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "=== CloudsEngine block size benchmark (" << seconds << " s per case) ===" << std::endl;
+    std::cout << "  ns/sample at      16       32       64      128" << std::endl;
+
+    for (int mode = 0; mode < 4; ++mode)
+    {
+        std::cout << kModeNames[mode] << std::endl;
+
+        const double engine[4] = { timeEngine<16>(mode, seconds), timeEngine<32>(mode, seconds),
+                                   timeEngine<64>(mode, seconds), timeEngine<128>(mode, seconds) };
+        report("engine", engine);
+
+        const double chain[4] = { timeChain<16>(mode, seconds), timeChain<32>(mode, seconds),
+                                  timeChain<64>(mode, seconds), timeChain<128>(mode, seconds) };
+        report("chain", chain);
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+
+#include <vector>
+
+//==============================================================================
+// CloudsEngineT / SampleRateAdapterT at block sizes other than the
+// hardware's 32 frames, against CloudsEngine and SampleRateAdapter.
+//==============================================================================
+class BlockSizeTests : public juce::UnitTest
+{
+public:
+    BlockSizeTests() : juce::UnitTest("Block Size Tests") {}
+
+    void runTest() override
+    {
+        beginTest("Every block size sounds like the 32-frame engine");
+        {
+            const auto reference = renderEngine<32>();
+
+            // Whole 32-frame Process() calls with the same smoothing steps:
+            // bit for bit.
+            expectEquals(maxDifference(renderEngine<64>(), reference), 0.0f, "64");
+            expectEquals(maxDifference(renderEngine<128>(), reference), 0.0f, "128");
+
+            // Twice the smoothing steps at the same time constant.
+            expectLessThan(maxDifference(renderEngine<16>(), reference), 2.0e-3f, "16");
+        }
+
+        beginTest("The direct path delays by one engine block");
+        {
+            expectEquals(directLatency<16>(), 16);
+            expectEquals(directLatency<32>(), 32);
+            expectEquals(directLatency<64>(), 64);
+            expectEquals(directLatency<128>(), 128);
+        }
+
+        beginTest("Worker and Deferred defer one Process() call at any block size");
+        {
+            expectEquals(prepareLatency<16>(), 16);
+            expectEquals(prepareLatency<32>(), 32);
+            expectEquals(prepareLatency<64>(), 32);
+            expectEquals(prepareLatency<128>(), 32);
+
+            // The pieces of a block take turns with their Prepare() calls,
+            // so neither schedule changes the sound.
+            const auto reference = renderEngine<128>();
+            expectEquals(maxDifference(renderEngine<128>(CloudsEngineT<128>::PrepareMode::Worker), reference), 0.0f);
+            expectEquals(maxDifference(renderEngine<128>(CloudsEngineT<128>::PrepareMode::Deferred), reference), 0.0f);
+            expectEquals(maxDifference(renderEngine<64>(CloudsEngineT<64>::PrepareMode::Worker),
+                                       renderEngine<64>()), 0.0f);
+        }
+
+        beginTest("Resampled paths run whole blocks of any size and keep the signal");
+        {
+            for (auto rate : { 44100.0, 96000.0 })
+            {
+                const auto reference = renderAdapter<32>(rate);
+                checkAdapter<16>(rate, reference);
+                checkAdapter<64>(rate, reference);
+                checkAdapter<128>(rate, reference);
+            }
+        }
+    }
+
+private:
+    struct Rendered
+    {
+        std::vector<float> output;
+        int latency = 0;
+        int mispredicted = 0;
+        uint32_t underruns = 0;
+    };
+
+    // Three seconds of a two-tone input straight into the engine at 32 kHz,
+    // with DRY/WET, POSITION and TEXTURE moving every 128 frames (a whole
+    // number of blocks at every size).
+    template <int BlockSize>
+    std::vector<float> renderEngine(typename CloudsEngineT<BlockSize>::PrepareMode prepareMode
+                                        = CloudsEngineT<BlockSize>::PrepareMode::Inline)
+    {
+        CloudsEngineT<BlockSize> engine;
+        engine.setPrepareMode(prepareMode);
+        engine.init();
+        engine.setFeedback(0.4f);
+
+        constexpr int kChunk = 128;
+        constexpr int kLength = 96000;
+        std::vector<float> inL(kChunk), inR(kChunk), outL(kChunk), outR(kChunk), result;
+        result.reserve(kLength);
+
+        for (int offset = 0; offset < kLength; offset += kChunk)
+        {
+            const float t = static_cast<float>(offset) / 32000.0f;
+            engine.setDryWet(0.5f + 0.5f * std::sin(2.0f * t));
+            engine.setPosition(0.5f + 0.4f * std::sin(0.7f * t));
+            engine.setTexture(t < 1.5f ? 0.2f : 0.8f);
+
+            for (int i = 0; i < kChunk; ++i)
+            {
+                const double n = offset + i;
+                inL[static_cast<size_t>(i)] = 0.3f * static_cast<float>(std::sin(6.283185307179586 * 220.0 * n / 32000.0));
+                inR[static_cast<size_t>(i)] = 0.3f * static_cast<float>(std::sin(6.283185307179586 * 330.0 * n / 32000.0));
+            }
+
+            engine.process(inL.data(), inR.data(), outL.data(), outR.data(), kChunk);
+            result.insert(result.end(), outL.begin(), outL.end());
+            result.insert(result.end(), outR.begin(), outR.end());
+        }
+
+        return result;
+    }
+
+    template <int BlockSize>
+    int directLatency()
+    {
+        CloudsEngineT<BlockSize> engine;
+        engine.init();
+
+        SampleRateAdapterT<BlockSize> adapter;
+        adapter.prepare(32000.0, 256, engine.getLatencySamples());
+        return adapter.getLatencySamples(engine);
+    }
+
+    // What Worker mode adds to the engine's latency.
+    template <int BlockSize>
+    int prepareLatency()
+    {
+        CloudsEngineT<BlockSize> engine;
+        engine.init();
+        const int inlineLatency = engine.getLatencySamples();
+        engine.setPrepareMode(CloudsEngineT<BlockSize>::PrepareMode::Worker);
+        return engine.getLatencySamples() - inlineLatency;
+    }
+
+    // Two seconds of a 1 kHz sine through the dry path in 100-sample
+    // callbacks, checking each callback's block count against
+    // getEngineBlocksForCallback().
+    template <int BlockSize>
+    Rendered renderAdapter(double rate)
+    {
+        CloudsEngineT<BlockSize> engine;
+        engine.init();
+        engine.setDryWet(0.0f);
+
+        constexpr int kHostBlockSize = 100;
+        SampleRateAdapterT<BlockSize> adapter;
+        adapter.prepare(rate, kHostBlockSize, engine.getLatencySamples());
+
+        Rendered rendered;
+        rendered.latency = adapter.getLatencySamples(engine);
+
+        const int length = static_cast<int>(2.0 * rate) / kHostBlockSize * kHostBlockSize;
+        std::vector<float> in(static_cast<size_t>(length)), outR(in.size());
+        rendered.output.resize(in.size());
+        for (size_t i = 0; i < in.size(); ++i)
+            in[i] = 0.4f * static_cast<float>(std::sin(6.283185307179586 * 1000.0 * static_cast<double>(i) / rate));
+
+        auto& telemetry = engine.getTelemetry();
+        for (int offset = 0; offset < length; offset += kHostBlockSize)
+        {
+            const auto o = static_cast<size_t>(offset);
+            const int predicted = adapter.getEngineBlocksForCallback(kHostBlockSize);
+            telemetry.reset();
+            adapter.process(in.data() + o, in.data() + o, rendered.output.data() + o, outR.data() + o,
+                            kHostBlockSize, engine);
+            rendered.mispredicted += telemetry.getNumReady() != predicted ? 1 : 0;
+        }
+
+        rendered.underruns = adapter.getUnderruns();
+        return rendered;
+    }
+
+    // Same signal as the 32-frame chain once both latencies are taken out;
+    // the last second only, after the engine's own DRY/WET has settled.
+    template <int BlockSize>
+    void checkAdapter(double rate, const Rendered& reference)
+    {
+        const auto rendered = renderAdapter<BlockSize>(rate);
+        const auto name = juce::String(BlockSize) + " frames, " + juce::String(rate) + " Hz";
+
+        float maxError = 0.0f;
+        const auto start = static_cast<size_t>(rate);
+        const auto end = reference.output.size() - static_cast<size_t>(std::max(rendered.latency, reference.latency));
+        for (size_t i = start; i < end; ++i)
+            maxError = std::max(maxError, std::abs(rendered.output[i + static_cast<size_t>(rendered.latency)]
+                                                   - reference.output[i + static_cast<size_t>(reference.latency)]));
+
+        expectEquals(rendered.mispredicted, 0, name);
+        expectEquals(static_cast<int>(rendered.underruns), 0, name);
+        expectLessThan(maxError, 1.0e-3f, name);
+    }
+
+    static float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        float result = 0.0f;
+        for (size_t i = 0; i < a.size(); ++i)
+            result = std::max(result, std::abs(a[i] - b[i]));
+        return result;
+    }
+};
+
+static BlockSizeTests blockSizeTests;
@@ -0,0 +1,210 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "EngineKernels.h"
+
+#include <vector>
+
+//==============================================================================
+// Every kernel set the CPU runs must agree bit for bit with the scalar reference.
+//==============================================================================
+class EngineKernelTests : public juce::UnitTest
+{
+public:
+    EngineKernelTests() : juce::UnitTest("Engine Kernel Tests") {}
+
+    void runTest() override
+    {
+        logMessage(juce::String("Kernels dispatched to ") + EngineKernels::getInstructionSetName());
+
+        const int numSets = EngineKernels::getNumKernelSets();
+
+        auto random = getRandom();
+        constexpr int kBlockSize = 32;
+        constexpr int kMaxFrames = 100;
+
+        std::vector<float> inL(kMaxFrames), inR(kMaxFrames);
+        std::vector<int16_t> framesA(2 * kMaxFrames), framesB(2 * kMaxFrames);
+        std::vector<float> outLA(kMaxFrames), outRA(kMaxFrames), outLB(kMaxFrames), outRB(kMaxFrames);
+
+        auto fillInput = [&](float range)
+        {
+            for (int i = 0; i < kMaxFrames; ++i)
+            {
+                inL[static_cast<size_t>(i)] = (random.nextFloat() * 2.0f - 1.0f) * range;
+                inR[static_cast<size_t>(i)] = (random.nextFloat() * 2.0f - 1.0f) * range;
+            }
+            inL[0] = -0.0f;
+            inR[1] = 1.0f;
+            inL[2] = -1.0f;
+        };
+
+        auto sameBits = [](float a, float b) { return std::memcmp(&a, &b, sizeof(float)) == 0; };
+
+        beginTest("Dispatch picks the fastest set the CPU runs");
+        {
+            expect(numSets >= 1);
+            expectEquals(juce::String(EngineKernels::getInstructionSetName()),
+                         juce::String(EngineKernels::getKernelSet(0).name));
+            expectEquals(juce::String(EngineKernels::getKernelSet(numSets - 1).name), juce::String("scalar"));
+
+           #if CLOUDS_KERNELS_AVX2
+            expect(juce::SystemStats::hasAVX2() == (juce::String(EngineKernels::getKernelSet(0).name) == "AVX2"),
+                   "AVX2 kernels must be used exactly when the CPU has AVX2");
+           #endif
+        }
+
+        for (int set = 0; set < numSets; ++set)
+        {
+            const auto& k = EngineKernels::getKernelSet(set);
+            beginTest(juce::String(k.name) + ": convertInputClamped matches scalar");
+
+            for (int iteration = 0; iteration < 50; ++iteration)
+            {
+                fillInput(iteration % 2 == 0 ? 1.0f : 4.0f);
+                const float trim = 0.1f + random.nextFloat();
+
+                for (int n = 0; n <= kBlockSize; ++n)
+                {
+                    std::fill(framesA.begin(), framesA.end(), int16_t(0x5555));
+                    std::fill(framesB.begin(), framesB.end(), int16_t(0x5555));
+
+                    const float peakA = k.convertInputClamped(inL.data(), inR.data(), trim,
+                                                              framesA.data(), n, kBlockSize);
+                    const float peakB = EngineKernels::scalar::convertInputClamped(inL.data(), inR.data(), trim,
+                                                                                   framesB.data(), n, kBlockSize);
+
+                    expect(sameBits(peakA, peakB), "peak mismatch, n=" + juce::String(n));
+                    expect(framesA == framesB, "frame mismatch, n=" + juce::String(n));
+                }
+            }
+        }
+
+        for (int set = 0; set < numSets; ++set)
+        {
+            const auto& k = EngineKernels::getKernelSet(set);
+            beginTest(juce::String(k.name) + ": input kernels zero-pad to the block size");
+
+            fillInput(1.0f);
+            std::fill(framesA.begin(), framesA.end(), int16_t(0x5555));
+            k.convertInputClamped(inL.data(), inR.data(), 0.5f, framesA.data(), 5, kBlockSize);
+
+            bool padded = true;
+            for (int i = 2 * 5; i < 2 * kBlockSize; ++i)
+                padded = padded && framesA[static_cast<size_t>(i)] == 0;
+
+            expect(padded, "Frames past numFrames must be zero");
+            expectEquals(static_cast<int>(framesA[2 * kBlockSize]), 0x5555, "Kernel wrote past blockSize");
+        }
+
+        for (int set = 0; set < numSets; ++set)
+        {
+            const auto& k = EngineKernels::getKernelSet(set);
+            beginTest(juce::String(k.name) + ": convertOutput matches scalar");
+
+            for (int iteration = 0; iteration < 50; ++iteration)
+            {
+                for (auto& f : framesA)
+                    f = static_cast<int16_t>(random.nextInt(65536) - 32768);
+                framesA[0] = -32768;
+                framesA[1] = 32767;
+
+                const float gain = 0.5f + random.nextFloat() * 2.5f;
+
+                for (int n = 0; n <= kMaxFrames; ++n)
+                {
+                    const float peakA = k.convertOutput(framesA.data(), gain,
+                                                        outLA.data(), outRA.data(), n);
+                    const float peakB = EngineKernels::scalar::convertOutput(framesA.data(), gain,
+                                                                             outLB.data(), outRB.data(), n);
+
+                    bool same = sameBits(peakA, peakB);
+                    for (int i = 0; i < n; ++i)
+                    {
+                        const auto idx = static_cast<size_t>(i);
+                        same = same && sameBits(outLA[idx], outLB[idx]) && sameBits(outRA[idx], outRB[idx]);
+                    }
+
+                    expect(same, "output mismatch, n=" + juce::String(n));
+                }
+            }
+        }
+
+        for (int set = 0; set < numSets; ++set)
+        {
+            const auto& k = EngineKernels::getKernelSet(set);
+            beginTest(juce::String(k.name) + ": interleaved kernels match scalar and the planar kernels");
+
+            std::vector<float> interleaved(2 * kMaxFrames), outA(2 * kMaxFrames), outB(2 * kMaxFrames);
+            std::vector<int16_t> framesC(2 * kMaxFrames);
+
+            for (int iteration = 0; iteration < 50; ++iteration)
+            {
+                fillInput(iteration % 2 == 0 ? 1.0f : 4.0f);
+                for (size_t i = 0; i < kMaxFrames; ++i)
+                {
+                    interleaved[2 * i] = inL[i];
+                    interleaved[2 * i + 1] = inR[i];
+                }
+                const float trim = 0.1f + random.nextFloat();
+
+                for (int n = 0; n <= kBlockSize; ++n)
+                {
+                    std::fill(framesA.begin(), framesA.end(), int16_t(0x5555));
+                    std::fill(framesB.begin(), framesB.end(), int16_t(0x5555));
+                    std::fill(framesC.begin(), framesC.end(), int16_t(0x5555));
+
+                    const float peakA = k.convertInputClampedInterleaved(interleaved.data(), trim, framesA.data(), n, kBlockSize);
+                    const float peakB = EngineKernels::scalar::convertInputClampedInterleaved(interleaved.data(), trim, framesB.data(), n, kBlockSize);
+                    const float peakC = k.convertInputClamped(inL.data(), inR.data(), trim, framesC.data(), n, kBlockSize);
+
+                    expect(sameBits(peakA, peakB) && sameBits(peakA, peakC), "peak mismatch, n=" + juce::String(n));
+                    expect(framesA == framesB && framesA == framesC, "frame mismatch, n=" + juce::String(n));
+                }
+
+                const float gain = 0.5f + random.nextFloat() * 2.5f;
+                for (int n = 0; n <= kMaxFrames; ++n)
+                {
+                    const float peakA = k.convertOutputInterleaved(framesA.data(), gain, outA.data(), n);
+                    const float peakB = EngineKernels::scalar::convertOutputInterleaved(framesA.data(), gain, outB.data(), n);
+                    const float peakC = k.convertOutput(framesA.data(), gain, outLA.data(), outRA.data(), n);
+
+                    bool same = sameBits(peakA, peakB) && sameBits(peakA, peakC);
+                    for (size_t i = 0; i < static_cast<size_t>(n); ++i)
+                        same = same && sameBits(outA[2 * i], outB[2 * i]) && sameBits(outA[2 * i + 1], outB[2 * i + 1])
+                                    && sameBits(outA[2 * i], outLA[i]) && sameBits(outA[2 * i + 1], outRA[i]);
+
+                    expect(same, "output mismatch, n=" + juce::String(n));
+                }
+            }
+        }
+
+        for (int set = 0; set < numSets; ++set)
+        {
+            const auto& k = EngineKernels::getKernelSet(set);
+            beginTest(juce::String(k.name) + ": measureFrames matches scalar");
+
+            for (int iteration = 0; iteration < 50; ++iteration)
+            {
+                for (auto& f : framesA)
+                    f = static_cast<int16_t>(random.nextInt(65536) - 32768);
+                for (int i = 0; i < 8; ++i)
+                    framesA[static_cast<size_t>(random.nextInt(2 * kMaxFrames))] = (i & 1) ? -32768 : 32767;
+
+                for (int n = 0; n <= kMaxFrames; ++n)
+                {
+                    const auto a = k.measureFrames(framesA.data(), n);
+                    const auto b = EngineKernels::scalar::measureFrames(framesA.data(), n);
+
+                    expect(a.sumOfSquares == b.sumOfSquares, "sum of squares mismatch, n=" + juce::String(n));
+                    expectEquals(a.clips, b.clips, "clip count mismatch, n=" + juce::String(n));
+                }
+            }
+
+            std::fill(framesA.begin(), framesA.end(), int16_t(-32768));
+            const auto worst = k.measureFrames(framesA.data(), kMaxFrames);
+            expect(worst.sumOfSquares == uint64_t(2 * kMaxFrames) * 32768u * 32768u, "Full-scale squares must not wrap");
+            expectEquals(worst.clips, 2 * kMaxFrames);
+        }
+    }
+};
+
+static EngineKernelTests engineKernelTests;
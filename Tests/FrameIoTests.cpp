@@ -0,0 +1,166 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "stmlib/utils/random.h"
+
+#include <vector>
+
+//==============================================================================
+// CloudsEngine's I/O staging: host float in and out of the int16 ShortFrames
+// the GranularProcessor runs on, in callbacks of any length.
+//==============================================================================
+class FrameIoTests : public juce::UnitTest
+{
+public:
+    FrameIoTests() : juce::UnitTest("Frame I/O Tests") {}
+
+    void runTest() override
+    {
+        beginTest("Silence stays silent");
+        {
+            CloudsEngine engine;
+            engine.init();
+            engine.setDryWet(0.0f);
+
+            float inL[32] = {}, inR[32] = {}, outL[32], outR[32];
+            engine.process(inL, inR, outL, outR, 32);
+
+            float maxAbs = 0.0f;
+            for (int i = 0; i < 32; ++i)
+                maxAbs = std::max(maxAbs, std::max(std::abs(outL[i]), std::abs(outR[i])));
+
+            expect(maxAbs < 0.01f, "Silent input should stay silent, got max=" + juce::String(maxAbs));
+        }
+
+        beginTest("A partial block runs as a zero-padded full block");
+        {
+            // Callback sizes below, at and across kBlockSize. Each piece of
+            // a callback shorter than a block is processed as a whole block
+            // with zeros after the input, and only its first frames are
+            // returned.
+            const std::vector<int> sizes { 1, 7, 31, 32, 33, 100, 5 };
+
+            const auto ragged = renderPartial(sizes, false);
+            const auto padded = renderPartial(sizes, true);
+
+            expect(ragged == padded, "Partial block output differs from the zero-padded block");
+
+            float peak = 0.0f;
+            for (auto v : ragged)
+                peak = std::max(peak, std::abs(v));
+            expect(peak > 0.01f, "Partial blocks should produce audio");
+        }
+
+        beginTest("Interleaved I/O matches planar I/O");
+        {
+            // Ragged sizes so partial blocks and the kernel tails are covered.
+            const auto planar = renderIo(false);
+            const auto interleaved = renderIo(true);
+            expect(planar == interleaved, "Interleaved output differs from planar output");
+        }
+    }
+
+private:
+    // Renders a stereo tone through one callback per entry of sizes, and
+    // returns the output as l, r, l, r, ... With padBlocks, each callback is
+    // split into blocks instead, and a short one is given kBlockSize frames
+    // of input with zeros after the real ones.
+    static std::vector<float> renderPartial(const std::vector<int>& sizes, bool padBlocks)
+    {
+        stmlib::Random::Seed(0x29);
+
+        CloudsEngine engine;
+        engine.init();
+        engine.setDryWet(0.5f);
+
+        constexpr int kBlockSize = CloudsEngine::kBlockSize;
+        std::vector<float> result;
+        std::vector<float> inL(kBlockSize), inR(kBlockSize), outL(kBlockSize), outR(kBlockSize);
+        int position = 0;
+
+        for (auto size : sizes)
+        {
+            std::vector<float> callbackL(static_cast<size_t>(size)), callbackR(static_cast<size_t>(size));
+            for (size_t i = 0; i < callbackL.size(); ++i, ++position)
+            {
+                const float t = static_cast<float>(position) / 32000.0f;
+                callbackL[i] = 0.5f * std::sin(2.0f * 3.14159265f * 220.0f * t);
+                callbackR[i] = 0.5f * std::sin(2.0f * 3.14159265f * 331.0f * t);
+            }
+
+            if (!padBlocks)
+            {
+                std::vector<float> callbackOutL(callbackL.size()), callbackOutR(callbackR.size());
+                engine.process(callbackL.data(), callbackR.data(), callbackOutL.data(), callbackOutR.data(), size);
+                for (size_t i = 0; i < callbackOutL.size(); ++i)
+                {
+                    result.push_back(callbackOutL[i]);
+                    result.push_back(callbackOutR[i]);
+                }
+                continue;
+            }
+
+            for (int offset = 0; offset < size; offset += kBlockSize)
+            {
+                const int n = std::min(kBlockSize, size - offset);
+                std::fill(inL.begin(), inL.end(), 0.0f);
+                std::fill(inR.begin(), inR.end(), 0.0f);
+                std::copy(callbackL.begin() + offset, callbackL.begin() + offset + n, inL.begin());
+                std::copy(callbackR.begin() + offset, callbackR.begin() + offset + n, inR.begin());
+
+                engine.process(inL.data(), inR.data(), outL.data(), outR.data(), kBlockSize);
+                for (size_t i = 0; i < static_cast<size_t>(n); ++i)
+                {
+                    result.push_back(outL[i]);
+                    result.push_back(outR[i]);
+                }
+            }
+        }
+        return result;
+    }
+
+    // Renders a stereo tone in ragged callbacks through process() or
+    // processInterleaved() and returns the output as l, r, l, r, ...
+    static std::vector<float> renderIo(bool interleaved)
+    {
+        stmlib::Random::Seed(0x17);
+
+        CloudsEngine engine;
+        engine.init();
+        engine.setDryWet(0.7f);
+        engine.setDensity(0.6f);
+
+        const int sizes[] = { 32, 45, 7, 64, 19, 100 };
+        std::vector<float> result;
+        std::vector<float> inL(100), inR(100), outL(100), outR(100), inLR(200), outLR(200);
+        int position = 0;
+
+        for (int callback = 0; callback < 120; ++callback)
+        {
+            const int n = sizes[callback % 6];
+            for (int i = 0; i < n; ++i, ++position)
+            {
+                const float t = static_cast<float>(position) / 32000.0f;
+                inLR[static_cast<size_t>(2 * i)] = inL[static_cast<size_t>(i)] = 0.5f * std::sin(2.0f * 3.14159265f * 220.0f * t);
+                inLR[static_cast<size_t>(2 * i + 1)] = inR[static_cast<size_t>(i)] = 0.5f * std::sin(2.0f * 3.14159265f * 331.0f * t);
+            }
+
+            if (interleaved)
+            {
+                engine.processInterleaved(inLR.data(), outLR.data(), n);
+                result.insert(result.end(), outLR.begin(), outLR.begin() + 2 * n);
+            }
+            else
+            {
+                engine.process(inL.data(), inR.data(), outL.data(), outR.data(), n);
+                for (size_t i = 0; i < static_cast<size_t>(n); ++i)
+                {
+                    result.push_back(outL[i]);
+                    result.push_back(outR[i]);
+                }
+            }
+        }
+        return result;
+    }
+};
+
+static FrameIoTests frameIoTests;
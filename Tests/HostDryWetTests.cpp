@@ -0,0 +1,254 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+
+#include <vector>
+
+//==============================================================================
+// CloudsEngine::setHostDryWet(): the dry signal mixed in by SampleRateAdapter
+// at the host rate, and the chain suspended at 0% wet.
+//==============================================================================
+class HostDryWetTests : public juce::UnitTest
+{
+public:
+    HostDryWetTests() : juce::UnitTest("Host Dry/Wet Tests") {}
+
+    void runTest() override
+    {
+        beginTest("At 0% wet the output is the input, delayed, and the engine never runs");
+        {
+            for (auto rate : { 32000.0, 44100.0, 48000.0, 96000.0 })
+            {
+                const auto name = juce::String(rate) + " Hz";
+
+                CloudsEngine engine;
+                engine.init();
+                engine.setHostDryWet(true);
+                engine.setDryWet(0.0f);
+                engine.setInputTrim(1.0f);
+                engine.setOutputGain(1.0f);
+
+                constexpr int kHostBlockSize = 100;
+                SampleRateAdapter adapter;
+                adapter.prepare(rate, kHostBlockSize, engine.getLatencySamples());
+                const int latency = adapter.getLatencySamples(engine);
+
+                const int length = static_cast<int>(rate) / kHostBlockSize * kHostBlockSize;
+                std::vector<float> inL(static_cast<size_t>(length)), inR(inL.size()), outL(inL.size()), outR(inL.size());
+                auto random = getRandom();
+                for (size_t i = 0; i < inL.size(); ++i)
+                {
+                    inL[i] = random.nextFloat() - 0.5f;
+                    inR[i] = random.nextFloat() - 0.5f;
+                }
+
+                engine.getTelemetry().reset();
+                for (int offset = 0; offset < length; offset += kHostBlockSize)
+                {
+                    const auto o = static_cast<size_t>(offset);
+                    adapter.process(inL.data() + o, inR.data() + o, outL.data() + o, outR.data() + o,
+                                    kHostBlockSize, engine);
+                }
+
+                float maxError = 0.0f;
+                for (int i = 0; i < length; ++i)
+                {
+                    const float expectedL = i >= latency ? inL[static_cast<size_t>(i - latency)] : 0.0f;
+                    const float expectedR = i >= latency ? inR[static_cast<size_t>(i - latency)] : 0.0f;
+                    maxError = std::max(maxError, std::abs(outL[static_cast<size_t>(i)] - expectedL));
+                    maxError = std::max(maxError, std::abs(outR[static_cast<size_t>(i)] - expectedR));
+                }
+
+                expectEquals(maxError, 0.0f, name);
+                expect(adapter.isWetSuspended(), name);
+                expectEquals(engine.getTelemetry().getNumReady(), 0, name);
+            }
+        }
+
+        beginTest("At 100% wet the output is the engine's own wet signal");
+        {
+            for (auto rate : { 32000.0, 44100.0 })
+            {
+                const auto reference = render(rate, false);
+                const auto hostMix = render(rate, true);
+
+                // The first second is the engine's own DRY/WET settling.
+                float maxError = 0.0f, peak = 0.0f;
+                for (size_t i = static_cast<size_t>(rate); i < reference.size(); ++i)
+                {
+                    maxError = std::max(maxError, std::abs(hostMix[i] - reference[i]));
+                    peak = std::max(peak, std::abs(reference[i]));
+                }
+
+                expectGreaterThan(peak, 0.1f, juce::String(rate));
+                expectLessThan(maxError, 1.0e-4f, juce::String(rate));
+            }
+        }
+
+        beginTest("The dry delay follows the engine's latency");
+        {
+            for (auto rate : { 32000.0, 44100.0 })
+                checkLatencyChange(rate);
+        }
+
+                beginTest("Automation through 0% suspends and resumes the chain");
+        {
+            for (auto rate : { 32000.0, 44100.0 })
+                checkAutomation(rate);
+        }
+    }
+
+private:
+    // Two seconds of a 1 kHz sine at 100% wet, left channel.
+    std::vector<float> render(double rate, bool hostDryWet)
+    {
+        CloudsEngine engine;
+        engine.init();
+        engine.setHostDryWet(hostDryWet);
+        engine.setDryWet(1.0f);
+
+        constexpr int kHostBlockSize = 128;
+        SampleRateAdapter adapter;
+        adapter.prepare(rate, kHostBlockSize, engine.getLatencySamples());
+
+        const int length = static_cast<int>(2.0 * rate) / kHostBlockSize * kHostBlockSize;
+        std::vector<float> in(static_cast<size_t>(length)), outL(in.size()), outR(in.size());
+        for (size_t i = 0; i < in.size(); ++i)
+            in[i] = 0.4f * static_cast<float>(std::sin(6.283185307179586 * 1000.0 * static_cast<double>(i) / rate));
+
+        for (int offset = 0; offset < length; offset += kHostBlockSize)
+        {
+            const auto o = static_cast<size_t>(offset);
+            adapter.process(in.data() + o, in.data() + o, outL.data() + o, outR.data() + o, kHostBlockSize, engine);
+        }
+
+        return outL;
+    }
+
+    // Parked at 0% wet, so the output is the delayed input alone. Half a
+    // second in, spectral mode adds its STFT frame to the engine's latency;
+    // from then on the input comes out that much later.
+    void checkLatencyChange(double rate)
+    {
+        CloudsEngine engine;
+        engine.init();
+        engine.setHostDryWet(true);
+        engine.setDryWet(0.0f);
+        engine.setInputTrim(1.0f);
+        engine.setOutputGain(1.0f);
+
+        constexpr int kHostBlockSize = 100;
+        SampleRateAdapter adapter;
+        adapter.prepare(rate, kHostBlockSize, engine.getLatencySamples());
+        const int before = adapter.getLatencySamples(engine);
+
+        const int numCallbacks = static_cast<int>(rate) / kHostBlockSize;
+        const int switchAt = numCallbacks / 2;
+        const auto length = static_cast<size_t>(numCallbacks * kHostBlockSize);
+        std::vector<float> in(length), outL(length), outR(length);
+        auto random = getRandom();
+        for (auto& v : in)
+            v = random.nextFloat() - 0.5f;
+
+        int after = before;
+        for (int callback = 0; callback < numCallbacks; ++callback)
+        {
+            if (callback == switchAt)
+            {
+                engine.setPlaybackMode(3);
+                after = adapter.getLatencySamples(engine);
+            }
+
+            const auto o = static_cast<size_t>(callback * kHostBlockSize);
+            adapter.process(in.data() + o, in.data() + o, outL.data() + o, outR.data() + o, kHostBlockSize, engine);
+        }
+
+        auto error = [&](size_t from, size_t to, int latency)
+        {
+            float result = 0.0f;
+            for (size_t i = from; i < to; ++i)
+                result = std::max(result, std::abs(outL[i] - in[i - static_cast<size_t>(latency)]));
+            return result;
+        };
+
+        const auto name = juce::String(rate) + " Hz";
+        const auto switchSample = static_cast<size_t>(switchAt * kHostBlockSize);
+
+        expectGreaterOrEqual(after - before, CloudsEngine::kSpectralLatencySamples, name);
+        expectEquals(error(static_cast<size_t>(before), switchSample, before), 0.0f, name);
+        expectEquals(error(switchSample, length, after), 0.0f, name);
+        expect(adapter.isWetSuspended(), name);
+    }
+
+    // DRY/WET at 50%, down to 0% after a second and back up after three.
+    // While it is parked the output is the delayed input at the processor's
+    // dry level (trim 0.5, output gain 1.6) and the engine does not run.
+    // On the way back the wet signal starts from zero gain, whatever the
+    // resamplers or the engine held from before.
+    void checkAutomation(double rate)
+    {
+        CloudsEngine engine;
+        engine.init();
+        engine.setHostDryWet(true);
+        engine.setDryWet(0.5f);
+
+        constexpr int kHostBlockSize = 256;
+        SampleRateAdapter adapter;
+        adapter.prepare(rate, kHostBlockSize, engine.getLatencySamples());
+        const int latency = adapter.getLatencySamples(engine);
+
+        const int numCallbacks = static_cast<int>(5.0 * rate) / kHostBlockSize;
+        const auto length = static_cast<size_t>(numCallbacks * kHostBlockSize);
+        std::vector<float> in(length), outL(length), outR(length);
+        for (size_t i = 0; i < length; ++i)
+            in[i] = 0.25f * static_cast<float>(std::sin(6.283185307179586 * 1000.0 * static_cast<double>(i) / rate));
+
+        auto& telemetry = engine.getTelemetry();
+        int blocksWhileParked = 0, blocksAfter = 0;
+        bool suspended = false;
+
+        for (int callback = 0; callback < numCallbacks; ++callback)
+        {
+            const double seconds = callback * kHostBlockSize / rate;
+            engine.setDryWet(seconds < 1.0 || seconds >= 3.0 ? 0.5f : 0.0f);
+
+            const auto o = static_cast<size_t>(callback * kHostBlockSize);
+            telemetry.reset();
+            adapter.process(in.data() + o, in.data() + o, outL.data() + o, outR.data() + o, kHostBlockSize, engine);
+
+            if (seconds >= 2.0 && seconds < 3.0)
+            {
+                blocksWhileParked += telemetry.getNumReady();
+                suspended = suspended || adapter.isWetSuspended();
+            }
+            else if (seconds >= 3.0)
+            {
+                blocksAfter += telemetry.getNumReady();
+            }
+        }
+
+        const float dryGain = 0.5f * 1.6f;
+        auto dryError = [&](double from, double to)
+        {
+            float error = 0.0f;
+            const auto end = std::min(length, static_cast<size_t>(to * rate));
+            for (auto i = static_cast<size_t>(from * rate); i < end; ++i)
+                error = std::max(error, std::abs(outL[i] - in[i - static_cast<size_t>(latency)] * dryGain));
+            return error;
+        };
+
+        const auto name = juce::String(rate) + " Hz";
+
+        expect(suspended, name);
+        expectEquals(blocksWhileParked, 0, name);
+        expectGreaterThan(blocksAfter, 0, name);
+        expect(!adapter.isWetSuspended(), name);
+        expectLessThan(dryError(2.0, 3.0), 1.0e-6f, name);
+        expectLessThan(dryError(3.0, 3.001), 0.03f, name);
+        expectGreaterThan(dryError(4.0, 5.0), 0.03f, name);
+        expectEquals(adapter.getLatencySamples(engine), latency, name);
+        expectEquals(static_cast<int>(adapter.getUnderruns()), 0, name);
+    }
+};
+
+static HostDryWetTests hostDryWetTests;
@@ -0,0 +1,202 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+
+#include <vector>
+
+//==============================================================================
+// Idle detection in CloudsEngine / SampleRateAdapter and the host bypass fade
+//==============================================================================
+class IdleBypassTests : public juce::UnitTest
+{
+public:
+    IdleBypassTests() : juce::UnitTest("Idle And Bypass Tests") {}
+
+    void runTest() override
+    {
+        const int holdBlocks = static_cast<int>(CloudsEngine::kIdleHoldSeconds * 32000.0f) / 32;
+
+        beginTest("Engine goes idle after the hold time and wakes on input");
+        {
+            CloudsEngine engine, reference;
+            engine.init();
+            reference.init();
+            reference.setIdleDetectionEnabled(false);
+
+            for (auto* e : { &engine, &reference })
+            {
+                e->setPlaybackMode(2);
+                e->setDryWet(0.0f);
+            }
+
+            float silence[32] = {}, outL[32], outR[32], refL[32], refR[32];
+
+            // Some signal, then silence until the tail is gone.
+            for (int b = 0; b < 50; ++b)
+            {
+                float sine[32];
+                fillSine(sine, b);
+                engine.process(sine, sine, outL, outR, 32);
+                reference.process(sine, sine, refL, refR, 32);
+            }
+            expect(!engine.isIdle(), "Engine must not be idle while there is signal");
+
+            // The hold starts once the tail (parameter glide, delay) has decayed.
+            for (int b = 0; b < holdBlocks + 1000; ++b)
+            {
+                engine.process(silence, silence, outL, outR, 32);
+                reference.process(silence, silence, refL, refR, 32);
+            }
+            expect(engine.isIdle(), "Engine should be idle after the hold time");
+            expect(!reference.isIdle(), "Idle detection disabled must never go idle");
+
+            // Wakes on the very block that carries signal, and matches the reference.
+            float maxError = 0.0f, maxOut = 0.0f;
+            for (int b = 0; b < 20; ++b)
+            {
+                float sine[32];
+                fillSine(sine, b);
+                engine.process(sine, sine, outL, outR, 32);
+                reference.process(sine, sine, refL, refR, 32);
+
+                if (b == 0)
+                    expect(!engine.isIdle(), "Engine should wake on the first loud block");
+
+                for (int i = 0; i < 32; ++i)
+                {
+                    maxError = std::max(maxError, std::abs(outL[i] - refL[i]));
+                    maxOut = std::max(maxOut, std::abs(outL[i]));
+                }
+            }
+            expect(maxOut > 0.01f, "Woken engine should produce output");
+            expect(maxError < 1.0e-3f, "Wake-up differs from an engine that never slept: " + juce::String(maxError));
+        }
+
+        beginTest("Freeze prevents idle, trigger wakes");
+        {
+            CloudsEngine engine;
+            engine.init();
+            engine.setFreeze(true);
+
+            float silence[32] = {}, outL[32], outR[32];
+            for (int b = 0; b < holdBlocks + 10; ++b)
+                engine.process(silence, silence, outL, outR, 32);
+            expect(!engine.isIdle(), "Frozen engine must not go idle");
+
+            engine.setFreeze(false);
+            for (int b = 0; b < holdBlocks + 10; ++b)
+                engine.process(silence, silence, outL, outR, 32);
+            expect(engine.isIdle());
+
+            engine.setTrigger(true);
+            expect(!engine.isIdle(), "Pending trigger must wake the engine");
+        }
+
+        beginTest("Adapter skips the chain while idle");
+        {
+            CloudsEngine engine;
+            engine.init();
+            SampleRateAdapter adapter;
+            adapter.prepare(48000.0, 512);
+
+            std::vector<float> silence(512, 0.0f), outL(512), outR(512);
+            const int blocksForHold = static_cast<int>(CloudsEngine::kIdleHoldSeconds * 48000.0f / 512.0f) + 10;
+
+            for (int b = 0; b < blocksForHold; ++b)
+                adapter.process(silence.data(), silence.data(), outL.data(), outR.data(), 512, engine);
+
+            expect(engine.isIdle());
+            adapter.process(silence.data(), silence.data(), outL.data(), outR.data(), 512, engine);
+            expect(adapter.isIdle(), "Adapter should skip work for an idle engine and silent input");
+
+            std::vector<float> loud(512, 0.25f);
+            adapter.process(loud.data(), loud.data(), outL.data(), outR.data(), 512, engine);
+            expect(!adapter.isIdle() && !engine.isIdle(), "Signal must wake adapter and engine");
+        }
+
+        beginTest("Bypass fades to the dry input and then passes it through");
+        {
+            CloudsEngine engine;
+            engine.init();
+            engine.setDryWet(1.0f);
+
+            SampleRateAdapter adapter;
+            adapter.prepare(44100.0, 256);
+
+            std::vector<float> inL(256), inR(256), outL(256), outR(256);
+            auto signal = [](int n) { return 0.3f * std::sin(0.01f * static_cast<float>(n)); };
+            auto fill = [&](int block) {
+                for (int i = 0; i < 256; ++i)
+                {
+                    inL[static_cast<size_t>(i)] = signal(block * 256 + i);
+                    inR[static_cast<size_t>(i)] = -inL[static_cast<size_t>(i)];
+                }
+            };
+
+            // The input of block, delayed by what the adapter reports.
+            const int latency = adapter.getLatencySamples(engine);
+            expect(latency > 0);
+            auto isDelayedInput = [&](const std::vector<float>& l, const std::vector<float>* r, int block) {
+                for (int i = 0; i < 256; ++i)
+                {
+                    const float expected = signal(block * 256 + i - latency);
+                    if (l[static_cast<size_t>(i)] != expected || (r != nullptr && (*r)[static_cast<size_t>(i)] != -expected))
+                        return false;
+                }
+                return true;
+            };
+
+            for (int b = 0; b < 20; ++b)
+            {
+                fill(b);
+                adapter.process(inL.data(), inR.data(), outL.data(), outR.data(), 256, engine);
+            }
+
+            adapter.setBypass(true);
+            const int fadeBlocks = static_cast<int>(SampleRateAdapter::kBypassFadeMs * 44.1f / 256.0f) + 2;
+            float maxJump = 0.0f;
+            float previous = outL.back();
+            for (int b = 20; b < 20 + fadeBlocks; ++b)
+            {
+                fill(b);
+                adapter.process(inL.data(), inR.data(), outL.data(), outR.data(), 256, engine);
+                for (auto v : outL)
+                {
+                    maxJump = std::max(maxJump, std::abs(v - previous));
+                    previous = v;
+                }
+            }
+            expect(adapter.isFullyBypassed(), "Fade should have completed");
+            expect(maxJump < 0.1f, "Bypass fade should not click, jump=" + juce::String(maxJump));
+
+            // Lined up with the processed signal, as the host compensates it.
+            fill(20 + fadeBlocks);
+            adapter.process(inL.data(), inR.data(), outL.data(), outR.data(), 256, engine);
+            expect(isDelayedInput(outL, &outR, 20 + fadeBlocks),
+                   "Fully bypassed output must equal the input shifted by the reported latency");
+
+            // In place, as hosts do it.
+            fill(21 + fadeBlocks);
+            std::vector<float> buf(inL);
+            adapter.process(buf.data(), buf.data(), buf.data(), buf.data(), 256, engine);
+            expect(isDelayedInput(buf, nullptr, 21 + fadeBlocks));
+
+            adapter.setBypass(false);
+            for (int b = 0; b < fadeBlocks; ++b)
+            {
+                fill(b);
+                adapter.process(inL.data(), inR.data(), outL.data(), outR.data(), 256, engine);
+            }
+            expect(!adapter.isFullyBypassed());
+        }
+    }
+
+private:
+    static void fillSine(float* dest, int block)
+    {
+        for (int i = 0; i < 32; ++i)
+            dest[i] = 0.5f * std::sin(2.0f * 3.14159265f * 440.0f * static_cast<float>(block * 32 + i) / 32000.0f);
+    }
+};
+
+static IdleBypassTests idleBypassTests;
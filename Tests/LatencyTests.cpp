@@ -0,0 +1,131 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+
+#include <vector>
+
+//==============================================================================
+// Reported latency against the measured delay of an impulse through
+// SampleRateAdapter and CloudsEngine (dry signal only).
+//==============================================================================
+class LatencyTests : public juce::UnitTest
+{
+public:
+    LatencyTests() : juce::UnitTest("Latency Tests") {}
+
+    void runTest() override
+    {
+        using Scheduling = SampleRateAdapter::Scheduling;
+
+        const double rates[] = { 22050.0, 32000.0, 44100.0, 48000.0, 64000.0,
+                                 88200.0, 96000.0, 128000.0, 176400.0, 192000.0 };
+
+        for (auto scheduling : { Scheduling::OnDemand, Scheduling::Constant })
+        {
+            beginTest(juce::String("Impulse arrives at the reported latency, ")
+                      + (scheduling == Scheduling::Constant ? "constant" : "on-demand") + " scheduling");
+
+            for (auto rate : rates)
+                checkAlignment(rate, scheduling, false);
+        }
+
+        beginTest("Impulse arrives at the reported latency with latency compensation");
+        {
+            for (auto rate : { 32000.0, 44100.0, 48000.0, 96000.0 })
+                checkAlignment(rate, Scheduling::OnDemand, true);
+        }
+
+        beginTest("Engine latency adds exactly to the adapter's");
+        {
+            for (auto rate : rates)
+            {
+                CloudsEngine engine;
+                engine.init();
+
+                SampleRateAdapter adapter;
+                adapter.prepare(rate, 512);
+                const int base = adapter.getLatencySamples(engine);
+
+                engine.setPrepareMode(CloudsEngine::PrepareMode::Deferred);
+                engine.setLatencyCompensation(true);
+                const int engineLatency = engine.getLatencySamples();
+                expectEquals(engineLatency, CloudsEngine::kBlockSize + CloudsEngine::kMaxModeLatencySamples);
+
+                // Aligned for the engine latency: whole host samples.
+                adapter.prepare(rate, 512, engineLatency);
+                const double exact = base + engineLatency * rate / SampleRateAdapter::kInternalSampleRate;
+                expectWithinAbsoluteError(static_cast<double>(adapter.getLatencySamples(engine)), exact, 1.0,
+                                          juce::String(rate) + " Hz");
+            }
+        }
+
+        beginTest("Latency compensation keeps the latency across playback modes");
+        {
+            CloudsEngine engine;
+            engine.init();
+            engine.setLatencyCompensation(true);
+
+            for (int mode = 0; mode < 4; ++mode)
+            {
+                engine.setPlaybackMode(mode);
+                expectEquals(engine.getLatencySamples(), CloudsEngine::kMaxModeLatencySamples);
+            }
+
+            engine.setLatencyCompensation(false);
+            for (int mode = 0; mode < 4; ++mode)
+            {
+                engine.setPlaybackMode(mode);
+                expectEquals(engine.getLatencySamples(), CloudsEngine::getModeLatencySamples(mode));
+            }
+        }
+    }
+
+private:
+    void checkAlignment(double rate, SampleRateAdapter::Scheduling scheduling, bool compensation)
+    {
+        CloudsEngine engine;
+        engine.init();
+        engine.setDryWet(0.0f);
+        engine.setLatencyCompensation(compensation);
+
+        constexpr int kHostBlockSize = 100;
+        SampleRateAdapter adapter;
+        adapter.setScheduling(scheduling);
+        adapter.prepare(rate, kHostBlockSize, engine.getLatencySamples());
+
+        const int latency = adapter.getLatencySamples(engine);
+        const int impulseAt = 1000;
+        const int length = impulseAt + latency + 1000;
+
+        std::vector<float> in(static_cast<size_t>(length), 0.0f), outL(static_cast<size_t>(length)), outR(static_cast<size_t>(length));
+        in[static_cast<size_t>(impulseAt)] = 0.5f;
+
+        for (int offset = 0; offset < length; offset += kHostBlockSize)
+        {
+            const int n = std::min(kHostBlockSize, length - offset);
+            adapter.process(in.data() + offset, in.data() + offset,
+                            outL.data() + offset, outR.data() + offset, n, engine);
+        }
+
+        int peak = 0;
+        for (int i = 1; i < length; ++i)
+            if (std::abs(outL[static_cast<size_t>(i)]) > std::abs(outL[static_cast<size_t>(peak)]))
+                peak = i;
+
+        const auto name = juce::String(rate) + " Hz";
+        expectEquals(peak - impulseAt, latency, name);
+
+        // A whole-sample delay leaves the band-limited impulse symmetric
+        // about its peak; half a sample off would tilt it visibly.
+        if (peak > 0 && peak + 1 < length)
+        {
+            const float before = outL[static_cast<size_t>(peak - 1)];
+            const float after = outL[static_cast<size_t>(peak + 1)];
+            expectWithinAbsoluteError(before, after, 0.02f * std::abs(outL[static_cast<size_t>(peak)]), name);
+        }
+
+        expectEquals(static_cast<int>(adapter.getUnderruns()), 0, name);
+    }
+};
+
+static LatencyTests latencyTests;
@@ -0,0 +1,93 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "MirroredRing.h"
+#include "SampleRateAdapter.h"
+
+#include <vector>
+
+//==============================================================================
+// MirroredRing (mapped and copying fallback) and the adapter on top of it.
+//==============================================================================
+class MirroredRingTests : public juce::UnitTest
+{
+public:
+    MirroredRingTests() : juce::UnitTest("Mirrored Ring Tests") {}
+
+    void runTest() override
+    {
+        for (const bool allowMapping : { true, false })
+        {
+            const juce::String name = allowMapping ? " (mapped)" : " (fallback)";
+
+            beginTest("Capacity is a power of two" + name);
+            {
+                MirroredRing ring;
+                expect(ring.allocate(5000, allowMapping));
+                expect(ring.getCapacity() >= 5000);
+                expectEquals(ring.getCapacity() & (ring.getCapacity() - 1), 0);
+                if (!allowMapping)
+                    expect(!ring.isMirroredByMapping());
+
+                logMessage("capacity " + juce::String(ring.getCapacity())
+                           + (ring.isMirroredByMapping() ? ", mapped" : ", copying"));
+            }
+
+            beginTest("Every window is contiguous" + name);
+            {
+                MirroredRing ring;
+                ring.allocate(1024, allowMapping);
+                const int capacity = ring.getCapacity();
+                auto random = getRandom();
+
+                // Write ragged blocks straight through at(), read back
+                // windows that straddle the wrap point.
+                int64_t position = 0;
+                for (int block = 0; block < 200; ++block)
+                {
+                    const int n = 1 + random.nextInt(capacity / 3);
+                    float* dest = ring.at(position);
+                    for (int i = 0; i < n; ++i)
+                        dest[i] = static_cast<float>(position + i);
+                    ring.publish(position, n);
+                    position += n;
+
+                    const int window = std::min<int>(static_cast<int>(position), capacity);
+                    const float* src = ring.at(position - window);
+                    bool ok = true;
+                    for (int i = 0; i < window; ++i)
+                        ok = ok && src[i] == static_cast<float>(position - window + i);
+                    expect(ok, "window of " + juce::String(window) + " ending at " + juce::String(position));
+                }
+            }
+        }
+
+        beginTest("Adapter handles host blocks far larger than prepared");
+        {
+            CloudsEngine engine;
+            engine.init();
+            SampleRateAdapter adapter;
+            adapter.prepare(48000.0, 256);
+
+            std::vector<float> in(48000, 0.2f), outL(48000), outR(48000);
+            for (int pass = 0; pass < 3; ++pass)
+            {
+                adapter.process(in.data(), in.data(), outL.data(), outR.data(), 48000, engine);
+
+                bool finite = true;
+                for (auto v : outL)
+                    finite = finite && std::isfinite(v);
+                expect(finite);
+            }
+
+            // And back to small blocks without losing the schedule.
+            for (int block = 0; block < 100; ++block)
+            {
+                const int predicted = adapter.getEngineBlocksForCallback(37);
+                engine.getTelemetry().reset();
+                adapter.process(in.data(), in.data(), outL.data(), outR.data(), 37, engine);
+                expectEquals(engine.getTelemetry().getNumReady(), predicted);
+            }
+        }
+    }
+};
+
+static MirroredRingTests mirroredRingTests;
@@ -0,0 +1,154 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+#include "stmlib/utils/random.h"
+
+#include <vector>
+
+//==============================================================================
+// SampleRateAdapter bus layouts and single-lane resampling against the
+// stereo chain.
+//==============================================================================
+class MonoProcessingTests : public juce::UnitTest
+{
+public:
+    MonoProcessingTests() : juce::UnitTest("Mono Processing Tests") {}
+
+    void runTest() override
+    {
+        for (auto rate : { 32000.0, 44100.0, 48000.0, 96000.0 })
+        {
+            const auto name = juce::String(rate) + " Hz";
+
+            beginTest("Mono -> stereo gives the stereo result, " + name);
+            {
+                const auto reference = render(rate, 2, 2, 0, Source::Mono);
+                const auto mono = render(rate, 1, 2, 0, Source::Mono);
+                expectLessThan(maxDifference(reference.l, mono.l), 1.0e-3f, name);
+                expectLessThan(maxDifference(reference.r, mono.r), 1.0e-3f, name);
+                expectGreaterThan(peak(mono.l), 0.1f, name);
+            }
+
+            beginTest("Mono -> mono gives the stereo result folded, " + name);
+            {
+                const auto reference = render(rate, 2, 2, 0, Source::Mono);
+                const auto mono = render(rate, 1, 1, 0, Source::Mono);
+
+                std::vector<float> folded(reference.l.size());
+                for (size_t i = 0; i < folded.size(); ++i)
+                    folded[i] = 0.5f * (reference.l[i] + reference.r[i]);
+
+                expectLessThan(maxDifference(folded, mono.l), 1.0e-3f, name);
+                expect(mono.l == mono.r, name);
+            }
+        }
+
+        beginTest("A mono quality keeps a stereo input on two lanes");
+        {
+            // The processor folds only its wet path to mono; the dry signal
+            // is mixed from both input channels. Fully dry, the mono quality
+            // must give what the two-lane stereo quality does, and not the
+            // folded input.
+            for (auto rate : { 44100.0, 128000.0 })
+            {
+                const auto reference = render(rate, 2, 2, 0, Source::Stereo, 0.0f);
+                const auto monoQuality = render(rate, 2, 2, 1, Source::Stereo, 0.0f);
+                const auto mixedIn = render(rate, 2, 2, 1, Source::Mixed, 0.0f);
+
+                const auto name = juce::String(rate);
+                expectLessThan(maxDifference(reference.l, monoQuality.l), 1.0e-3f, name);
+                expectLessThan(maxDifference(reference.r, monoQuality.r), 1.0e-3f, name);
+                expectGreaterThan(maxDifference(monoQuality.r, mixedIn.r), 0.1f, name);
+            }
+        }
+
+        beginTest("Stereo -> mono is not a layout");
+        {
+            SampleRateAdapter adapter;
+            adapter.setBusLayout(1, 1);
+            expectEquals(adapter.getNumInputChannels(), 1);
+            expectEquals(adapter.getNumOutputChannels(), 1);
+            adapter.setBusLayout(1, 2);
+            expectEquals(adapter.getNumOutputChannels(), 2);
+        }
+    }
+
+private:
+    struct Output
+    {
+        std::vector<float> l, r;
+    };
+
+    // Mono is the left channel alone, passed as its own buffer to a stereo
+    // input; Mixed is the (l + r) / 2 mix in two separate buffers. Neither
+    // lets the adapter see a mono input, so both stay on two lanes.
+    enum class Source { Mono, Stereo, Mixed };
+
+    // Two seconds of the source in 100-sample callbacks; with dryWet at 0,
+    // the second half only, once the engine's DRY/WET has settled.
+    Output render(double rate, int numInputs, int numOutputs, int quality, Source source, float dryWet = 0.5f)
+    {
+        stmlib::Random::Seed(0x21);
+        CloudsEngine engine;
+        engine.init();
+        engine.setDryWet(dryWet);
+        engine.setFeedback(0.3f);
+        engine.setQuality(quality);
+
+        constexpr int kHostBlockSize = 100;
+        SampleRateAdapter adapter;
+        adapter.setBusLayout(numInputs, numOutputs);
+        adapter.prepare(rate, kHostBlockSize, engine.getLatencySamples());
+
+        const int length = static_cast<int>(2.0 * rate) / kHostBlockSize * kHostBlockSize;
+        std::vector<float> l(static_cast<size_t>(length)), r(l.size());
+        for (size_t i = 0; i < l.size(); ++i)
+        {
+            const double t = static_cast<double>(i) / rate;
+            l[i] = 0.4f * static_cast<float>(std::sin(6.283185307179586 * 440.0 * t));
+            r[i] = source == Source::Mono ? l[i] : 0.3f * static_cast<float>(std::sin(6.283185307179586 * 1250.0 * t));
+        }
+
+        if (source == Source::Mixed)
+            for (size_t i = 0; i < l.size(); ++i)
+                l[i] = r[i] = 0.5f * (l[i] + r[i]);
+
+        Output out { std::vector<float>(l.size()), std::vector<float>(l.size()) };
+        for (int offset = 0; offset < length; offset += kHostBlockSize)
+        {
+            const auto o = static_cast<size_t>(offset);
+            float* outR = numOutputs == 1 ? out.l.data() + o : out.r.data() + o;
+            adapter.process(l.data() + o, numInputs == 1 ? nullptr : r.data() + o,
+                            out.l.data() + o, outR, kHostBlockSize, engine);
+        }
+
+        if (numOutputs == 1)
+            out.r = out.l;
+
+        if (dryWet <= 0.0f)
+        {
+            out.l.erase(out.l.begin(), out.l.begin() + length / 2);
+            out.r.erase(out.r.begin(), out.r.begin() + length / 2);
+        }
+
+        return out;
+    }
+
+    static float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        float result = 0.0f;
+        for (size_t i = 0; i < a.size(); ++i)
+            result = std::max(result, std::abs(a[i] - b[i]));
+        return result;
+    }
+
+    static float peak(const std::vector<float>& a)
+    {
+        float result = 0.0f;
+        for (auto v : a)
+            result = std::max(result, std::abs(v));
+        return result;
+    }
+};
+
+static MonoProcessingTests monoProcessingTests;
@@ -0,0 +1,209 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "ParameterSnapshot.h"
+#include "stmlib/utils/random.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+// TripleBuffer / ControlEventQueue and the CloudsEngine setters that use them.
+// The threaded cases are meant to be run under -fsanitize=thread as well.
+//==============================================================================
+class ParameterSnapshotTests : public juce::UnitTest
+{
+public:
+    ParameterSnapshotTests() : juce::UnitTest("Parameter Snapshot Tests") {}
+
+    void runTest() override
+    {
+        beginTest("Triple buffer delivers the latest value");
+        {
+            TripleBuffer<int> buffer(7);
+            expect(!buffer.update(), "Nothing published yet");
+            expectEquals(buffer.read(), 7);
+
+            buffer.getWriteBuffer() = 1;
+            buffer.publish();
+            buffer.getWriteBuffer() = 2;
+            buffer.publish();
+
+            expect(buffer.update());
+            expectEquals(buffer.read(), 2);
+            expect(!buffer.update(), "Second update without a publish must report nothing new");
+            expectEquals(buffer.read(), 2);
+        }
+
+        beginTest("Triple buffer snapshots are never torn");
+        {
+            struct Wide { uint64_t words[16]; };
+            constexpr uint64_t kNumWrites = 200000;
+
+            TripleBuffer<Wide> buffer(Wide {});
+            std::atomic<bool> done { false };
+
+            std::thread producer([&]
+            {
+                for (uint64_t n = 1; n <= kNumWrites; ++n)
+                {
+                    auto& w = buffer.getWriteBuffer();
+                    for (auto& word : w.words)
+                        word = n;
+                    buffer.publish();
+                }
+                done.store(true, std::memory_order_release);
+            });
+
+            uint64_t last = 0;
+            int torn = 0, backwards = 0;
+
+            auto check = [&]
+            {
+                buffer.update();
+                const auto& w = buffer.read();
+                for (auto word : w.words)
+                    torn += (word != w.words[0]) ? 1 : 0;
+                backwards += (w.words[0] < last) ? 1 : 0;
+                last = w.words[0];
+            };
+
+            while (!done.load(std::memory_order_acquire))
+                check();
+            check();
+
+            producer.join();
+
+            expectEquals(torn, 0, "Consumer saw a half-written snapshot");
+            expectEquals(backwards, 0, "Consumer saw an older snapshot after a newer one");
+            expect(last == kNumWrites, "Final snapshot must be the last one published");
+        }
+
+        beginTest("Control events arrive in order and none are lost");
+        {
+            using Event = ControlEventQueue::Event;
+            constexpr int kNumEvents = 100000;
+
+            ControlEventQueue queue;
+            std::atomic<bool> done { false };
+
+            std::thread producer([&]
+            {
+                for (int n = 0; n < kNumEvents; ++n)
+                {
+                    const Event event { n % 3 == 0 ? Event::Type::Trigger : Event::Type::Freeze, (n & 1) != 0 };
+                    while (!queue.push(event))
+                        std::this_thread::yield();
+                }
+                done.store(true, std::memory_order_release);
+            });
+
+            int received = 0, mismatches = 0;
+            auto drain = [&]
+            {
+                queue.drain([&](const Event& event)
+                {
+                    const auto expectedType = received % 3 == 0 ? Event::Type::Trigger : Event::Type::Freeze;
+                    mismatches += (event.type != expectedType || event.value != ((received & 1) != 0)) ? 1 : 0;
+                    ++received;
+                });
+            };
+
+            while (!done.load(std::memory_order_acquire))
+                drain();
+            drain();
+
+            producer.join();
+
+            expectEquals(received, kNumEvents);
+            expectEquals(mismatches, 0);
+            expect(!queue.hasPending());
+        }
+
+        beginTest("Settings made before init are applied on the first block");
+        {
+            auto render = [](bool setBeforeInit)
+            {
+                stmlib::Random::Seed(0x33);
+
+                CloudsEngine engine;
+                if (setBeforeInit)
+                    engine.setPlaybackMode(3);
+                engine.init();
+                if (!setBeforeInit)
+                    engine.setPlaybackMode(3);
+
+                std::vector<float> out;
+                float in[32], outL[32], outR[32];
+                for (int block = 0; block < 100; ++block)
+                {
+                    for (int i = 0; i < 32; ++i)
+                        in[i] = 0.5f * std::sin(0.07f * static_cast<float>(block * 32 + i));
+
+                    engine.process(in, in, outL, outR, 32);
+                    out.insert(out.end(), outL, outL + 32);
+                }
+                return out;
+            };
+
+            const auto early = render(true);
+            const auto late = render(false);
+            expect(early == late, "Playback mode set before init must not be lost");
+        }
+
+        beginTest("Setters race process() without locks");
+        {
+            CloudsEngine engine;
+            engine.init();
+
+            std::atomic<bool> stop { false };
+
+            std::thread control([&]
+            {
+                juce::Random random(0x5eed);
+                int n = 0;
+
+                while (!stop.load(std::memory_order_acquire))
+                {
+                    EngineParameters p;
+                    p.position = random.nextFloat();
+                    p.size = random.nextFloat();
+                    p.pitch = random.nextFloat() * 24.0f - 12.0f;
+                    p.density = random.nextFloat();
+                    p.texture = random.nextFloat();
+                    p.dryWet = random.nextFloat();
+                    p.feedback = random.nextFloat() * 0.5f;
+                    p.playbackMode = (n / 500) % 4;
+                    p.quality = (n / 300) % 4;
+                    engine.setParameters(p);
+
+                    engine.setDensity(random.nextFloat());
+                    engine.setFreeze((n / 64) % 2 == 1);
+                    engine.setTrigger(n % 97 == 0);
+                    ++n;
+                }
+            });
+
+            std::vector<float> in(256), outL(256), outR(256);
+            bool finite = true;
+
+            for (int block = 0; block < 2000; ++block)
+            {
+                for (size_t i = 0; i < in.size(); ++i)
+                    in[i] = 0.3f * std::sin(0.05f * static_cast<float>(block * 256 + static_cast<int>(i)));
+
+                engine.process(in.data(), in.data(), outL.data(), outR.data(), 256);
+
+                for (size_t i = 0; i < outL.size(); ++i)
+                    finite = finite && std::isfinite(outL[i]) && std::isfinite(outR[i]);
+            }
+
+            stop.store(true, std::memory_order_release);
+            control.join();
+
+            expect(finite, "Output must stay finite while parameters change concurrently");
+        }
+    }
+};
+
+static ParameterSnapshotTests parameterSnapshotTests;
@@ -1,5 +1,5 @@
 #include <juce_audio_processors/juce_audio_processors.h>
-#include "PluginProcessor.h"
+#include "CloudsProcessor.h"
 #include "Parameters.h"
 
 //==============================================================================
@@ -88,6 +88,109 @@ public:
                     "Position not restored correctly");
             }
         }
+
+        beginTest("Latency is reported once and holds across playback modes");
+        {
+            CloudsVSTProcessor proc;
+            proc.prepareToPlay(48000.0, 512);
+
+            // Compensated: every mode carries the spectral mode's delay.
+            const int latency = proc.getLatencySamples();
+            expectGreaterOrEqual(latency, CloudsEngine::kSpectralLatencySamples);
+
+            juce::AudioBuffer<float> buffer(2, 512);
+            juce::MidiBuffer midi;
+            auto* mode = proc.getAPVTS().getParameter("playback_mode");
+            for (int m = 0; m < 4; ++m)
+            {
+                mode->setValueNotifyingHost(mode->convertTo0to1(static_cast<float>(m)));
+                for (int b = 0; b < 4; ++b)
+                {
+                    buffer.clear();
+                    proc.processBlock(buffer, midi);
+                }
+                expectEquals(proc.getLatencySamples(), latency, "mode " + juce::String(m));
+            }
+        }
+
+        beginTest("DRY/WET is mixed at the host rate");
+        {
+            CloudsVSTProcessor proc;
+            proc.prepareToPlay(44100.0, 256);
+            proc.getAPVTS().getParameter("dry_wet")->setValueNotifyingHost(0.0f);
+
+            // Only the host-rate mix stops the chain at 0% wet.
+            juce::AudioBuffer<float> buffer(2, 256);
+            juce::MidiBuffer midi;
+            for (int b = 0; b < 200; ++b)
+            {
+                buffer.clear();
+                proc.processBlock(buffer, midi);
+            }
+            expect(proc.getAdapter().isWetSuspended());
+        }
+
+        beginTest("Host bypass fades to the input and stops the chain");
+        {
+            CloudsVSTProcessor proc;
+            auto* bypass = proc.getAPVTS().getParameter("bypass");
+            expect(proc.getBypassParameter() == bypass);
+
+            constexpr int kBlockSize = 256;
+            proc.prepareToPlay(44100.0, kBlockSize);
+            const int latency = proc.getLatencySamples();
+
+            juce::AudioBuffer<float> buffer(2, kBlockSize);
+            juce::MidiBuffer midi;
+            auto signal = [](int n) { return 0.3f * std::sin(0.01f * static_cast<float>(n)); };
+            int lastBlock = 0;
+            auto processBlock = [&](int block)
+            {
+                for (int i = 0; i < kBlockSize; ++i)
+                {
+                    const float v = signal(block * kBlockSize + i);
+                    buffer.setSample(0, i, v);
+                    buffer.setSample(1, i, -v);
+                }
+                proc.processBlock(buffer, midi);
+                lastBlock = block;
+            };
+
+            // Against the input of the last block, shifted by the reported
+            // latency as the host lines it up with the other tracks.
+            auto maxError = [&]
+            {
+                float error = 0.0f;
+                for (int i = 0; i < kBlockSize; ++i)
+                {
+                    const float v = signal(lastBlock * kBlockSize + i - latency);
+                    error = std::max(error, std::abs(buffer.getSample(0, i) - v));
+                    error = std::max(error, std::abs(buffer.getSample(1, i) + v));
+                }
+                return error;
+            };
+
+            for (int b = 0; b < 40; ++b)
+                processBlock(b);
+            expect(!proc.getAdapter().isFullyBypassed());
+            expectGreaterThan(maxError(), 0.01f, "Processed output should differ from the input");
+
+            // processBlock() reads the parameter itself; nothing else is told.
+            bypass->setValueNotifyingHost(1.0f);
+            const int fadeBlocks = static_cast<int>(SampleRateAdapter::kBypassFadeMs * 44.1f / kBlockSize) + 2;
+            for (int b = 40; b < 40 + fadeBlocks; ++b)
+                processBlock(b);
+            expect(proc.getAdapter().isFullyBypassed(), "Fade should have completed");
+
+            processBlock(40 + fadeBlocks);
+            expectEquals(maxError(), 0.0f, "Fully bypassed output must equal the input shifted by the latency");
+            expectEquals(proc.getLatencySamples(), latency, "Bypass keeps the reported latency");
+
+            bypass->setValueNotifyingHost(0.0f);
+            for (int b = 0; b < fadeBlocks; ++b)
+                processBlock(b);
+            expect(!proc.getAdapter().isFullyBypassed());
+        }
     }
 };
 
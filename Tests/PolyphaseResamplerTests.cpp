@@ -0,0 +1,437 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "PolyphaseResampler.h"
+#include "SampleRateAdapter.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+//==============================================================================
+// PolyphaseResampler: kernels, gain, alias rejection and table sharing.
+//==============================================================================
+class PolyphaseResamplerTests : public juce::UnitTest
+{
+public:
+    PolyphaseResamplerTests() : juce::UnitTest("Polyphase Resampler Tests") {}
+
+    void runTest() override
+    {
+        using Quality = PolyphaseResampler::Quality;
+
+        beginTest("SIMD inner product matches scalar");
+        {
+            auto random = getRandom();
+            std::vector<float> c0(64), c1(64), frames(128);
+            for (size_t i = 0; i < 64; ++i)
+            {
+                c0[i] = random.nextFloat() - 0.5f;
+                c1[i] = random.nextFloat() - 0.5f;
+                frames[2 * i] = random.nextFloat() * 2.0f - 1.0f;
+                frames[2 * i + 1] = random.nextFloat() * 2.0f - 1.0f;
+            }
+
+            for (int taps = 8; taps <= 64; taps += 8)
+            {
+                float aL, aR, bL, bR;
+                ResamplerKernels::interpolatedDot(c0.data(), c1.data(), 0.37f, frames.data(), taps, aL, aR);
+                ResamplerKernels::scalar::interpolatedDot(c0.data(), c1.data(), 0.37f, frames.data(), taps, bL, bR);
+                expectWithinAbsoluteError(aL, bL, 1.0e-5f);
+                expectWithinAbsoluteError(aR, bR, 1.0e-5f);
+
+                expectWithinAbsoluteError(ResamplerKernels::interpolatedDotMono(c0.data(), c1.data(), 0.37f, frames.data(), taps),
+                                          ResamplerKernels::scalar::interpolatedDotMono(c0.data(), c1.data(), 0.37f, frames.data(), taps),
+                                          1.0e-5f);
+            }
+        }
+
+        beginTest("A mono lane gives the stereo result on every path");
+        {
+            // Same signal on both channels; up, down, generic, fixed, halfband and cascade.
+            for (auto [in, out] : { std::pair { 44100.0, 32000.0 }, std::pair { 32000.0, 48000.0 },
+                                    std::pair { 64000.0, 32000.0 }, std::pair { 32000.0, 128000.0 },
+                                    std::pair { 128000.0, 32000.0 }, std::pair { 22050.0, 32000.0 } })
+            {
+                for (bool specialised : { true, false })
+                {
+                    PolyphaseResampler stereo, mono;
+                    stereo.prepare(in, out, Quality::Medium, 4096, specialised);
+                    mono.setNumChannels(1);
+                    mono.prepare(in, out, Quality::Medium, 4096, specialised);
+                    expectEquals(mono.getNumChannels(), 1);
+
+                    std::vector<float> x(4096), aL(16384), aR(16384), bL(16384), bR(16384);
+                    for (size_t i = 0; i < x.size(); ++i)
+                        x[i] = 0.5f * static_cast<float>(std::sin(6.283185307179586 * 1500.0 * static_cast<double>(i) / in));
+
+                    stereo.write(x.data(), x.data(), 4096);
+                    mono.write(x.data(), x.data(), 4096);
+                    const int n = stereo.process(aL.data(), aR.data(), 16384);
+                    expectEquals(mono.process(bL.data(), bR.data(), 16384), n);
+
+                    float maxError = 0.0f;
+                    for (size_t i = 0; i < static_cast<size_t>(n); ++i)
+                        maxError = std::max({ maxError, std::abs(aL[i] - bL[i]), std::abs(aR[i] - bR[i]) });
+
+                    const auto name = juce::String(in) + " -> " + juce::String(out) + (specialised ? "" : " (generic)");
+                    expectGreaterThan(n, 1000, name);
+                    expectLessThan(maxError, 1.0e-5f, name);
+                }
+            }
+        }
+
+        beginTest("Changing the channel count mid-stream keeps the output going");
+        {
+            for (auto [in, out] : { std::pair { 44100.0, 32000.0 }, std::pair { 128000.0, 32000.0 },
+                                    std::pair { 32000.0, 96000.0 } })
+            {
+                PolyphaseResampler reference, switching;
+                reference.prepare(in, out, Quality::Medium, 256);
+                switching.prepare(in, out, Quality::Medium, 256);
+
+                std::vector<float> x(256), aL(1024), aR(1024), bL(1024), bR(1024);
+                double phase = 0.0;
+                float maxError = 0.0f;
+
+                for (int block = 0; block < 64; ++block)
+                {
+                    for (auto& v : x)
+                    {
+                        v = 0.5f * static_cast<float>(std::sin(phase));
+                        phase += 6.283185307179586 * 700.0 / in;
+                    }
+
+                    // Mono for a while, then stereo again, on identical channels.
+                    switching.setNumChannels(block >= 16 && block < 40 ? 1 : 2);
+
+                    reference.write(x.data(), x.data(), 256);
+                    switching.write(x.data(), x.data(), 256);
+                    const int n = reference.process(aL.data(), aR.data(), 1024);
+                    expectEquals(switching.process(bL.data(), bR.data(), 1024), n);
+
+                    for (size_t i = 0; i < static_cast<size_t>(n); ++i)
+                        maxError = std::max({ maxError, std::abs(aL[i] - bL[i]), std::abs(aR[i] - bR[i]) });
+                }
+
+                expectLessThan(maxError, 1.0e-5f, juce::String(in) + " -> " + juce::String(out));
+            }
+        }
+
+        beginTest("Channels stay apart in the interleaved ring");
+        {
+            // Tone on the left only, through every path; interleaved and
+            // planar output must be the same samples.
+            for (auto rate : { 44100.0, 64000.0, 128000.0, 22050.0 })
+            {
+                PolyphaseResampler planar, interleaved;
+                planar.prepare(rate, 32000.0, Quality::Medium, 4096);
+                interleaved.prepare(rate, 32000.0, Quality::Medium, 4096);
+
+                std::vector<float> l(4096), silence(4096, 0.0f), outL(4096), outR(4096), outLR(8192);
+                for (size_t i = 0; i < l.size(); ++i)
+                    l[i] = 0.5f * static_cast<float>(std::sin(6.283185307179586 * 1000.0 * static_cast<double>(i) / rate));
+
+                planar.write(l.data(), silence.data(), 4096);
+                interleaved.write(l.data(), silence.data(), 4096);
+                const int n = planar.process(outL.data(), outR.data(), 4096);
+                expectEquals(interleaved.processInterleaved(outLR.data(), 4096), n);
+
+                bool same = true, rightSilent = true;
+                float peakL = 0.0f;
+                for (size_t i = 0; i < static_cast<size_t>(n); ++i)
+                {
+                    same = same && outLR[2 * i] == outL[i] && outLR[2 * i + 1] == outR[i];
+                    rightSilent = rightSilent && outR[i] == 0.0f;
+                    peakL = std::max(peakL, std::abs(outL[i]));
+                }
+
+                expect(same, juce::String(rate));
+                expect(rightSilent, juce::String(rate));
+                expect(peakL > 0.4f, juce::String(rate));
+            }
+        }
+
+        beginTest("Tables are shared and sized per quality");
+        {
+            PolyphaseResampler a, b, c;
+            a.prepare(48000.0, 32000.0, Quality::Medium, 512);
+            b.prepare(48000.0, 32000.0, Quality::Medium, 1024);
+            c.prepare(48000.0, 32000.0, Quality::Long, 512);
+
+            expect(a.getTable() == b.getTable(), "Same quality and ratio should share one table");
+            expect(a.getTable() != c.getTable());
+            expectEquals(a.getNumTaps() % 8, 0);
+            expect(c.getNumTaps() > a.getNumTaps());
+        }
+
+        beginTest("prepare() picks a path per host rate");
+        {
+            using Path = PolyphaseResampler::Path;
+            const std::pair<double, Path> expected[] = { { 44100.0, Path::FixedRatio }, { 48000.0, Path::FixedRatio },
+                                                         { 88200.0, Path::FixedRatio }, { 96000.0, Path::FixedRatio },
+                                                         { 64000.0, Path::Halfband },   { 128000.0, Path::Halfband },
+                                                         { 22050.0, Path::Generic },    { 192000.0, Path::Generic } };
+
+            for (const auto& [rate, path] : expected)
+            {
+                PolyphaseResampler down, up;
+                down.prepare(rate, 32000.0, Quality::Medium, 512);
+                up.prepare(32000.0, rate, Quality::Medium, 512);
+
+                expect(down.getPath() == path && up.getPath() == path, juce::String(rate));
+                expectEquals(down.getNumStages(), rate == 128000.0 ? 2 : 1);
+                expectEquals(up.getNumStages(), rate == 128000.0 ? 2 : 1);
+            }
+
+            PolyphaseResampler forced;
+            forced.prepare(128000.0, 32000.0, Quality::Medium, 512, false);
+            expect(forced.getPath() == Path::Generic);
+            expectEquals(forced.getNumStages(), 1);
+        }
+
+        beginTest("Rate ratios are reduced fractions");
+        {
+            int64_t num = 0, den = 0;
+            PolyphaseResampler::getRatio(44100.0, 32000.0, num, den);
+            expect(num == 441 && den == 320);
+            PolyphaseResampler::getRatio(32000.0, 96000.0, num, den);
+            expect(num == 1 && den == 3);
+            PolyphaseResampler::getRatio(44099.5, 32000.0, num, den);
+            expect(num == 88199 && den == 64000);
+        }
+
+        beginTest("Output count is exact over long runs");
+        {
+            // One minute at 44.1 kHz in ragged chunks. With a rational phase
+            // the outputs are exactly those whose centre lies half a kernel
+            // before the end of the input, whatever the chunking.
+            PolyphaseResampler resampler;
+            resampler.prepare(44100.0, 32000.0, Quality::Short, 4096);
+            std::vector<float> in(4096, 0.25f), outL(4096), outR(4096);
+            auto random = getRandom();
+
+            int64_t written = 0, produced = 0;
+            while (written < 60 * 44100)
+            {
+                const int n = 1 + random.nextInt(4095);
+                const int available = resampler.getNumAvailable(n);
+                resampler.write(in.data(), in.data(), n);
+                written += n;
+
+                const int got = resampler.process(outL.data(), outR.data(), 4096);
+                expectEquals(got, available);
+                produced += got;
+            }
+
+            const int64_t half = resampler.getNumTaps() / 2;
+            const int64_t expected = ((written - half) * 320 + 440) / 441;
+            expect(produced == expected, juce::String(produced) + " outputs, expected " + juce::String(expected));
+
+            const int needed = resampler.getInputFramesNeeded(100);
+            expectEquals(resampler.getNumAvailable(needed - 1), 99);
+            expectEquals(resampler.getNumAvailable(needed), 100);
+        }
+
+        beginTest("Adapter predicts the engine blocks of each callback");
+        {
+            for (auto rate : { 44100.0, 48000.0, 32000.0 })
+            {
+                CloudsEngine engine;
+                engine.init();
+                SampleRateAdapter adapter;
+                adapter.prepare(rate, 2048);
+
+                std::vector<float> in(2048, 0.1f), outL(2048), outR(2048);
+                auto random = getRandom();
+                auto& telemetry = engine.getTelemetry();
+
+                for (int callback = 0; callback < 300; ++callback)
+                {
+                    const int n = 1 + random.nextInt(2048);
+                    const int predicted = adapter.getEngineBlocksForCallback(n);
+
+                    telemetry.reset();
+                    adapter.process(in.data(), in.data(), outL.data(), outR.data(), n, engine);
+                    expectEquals(telemetry.getNumReady(), predicted);
+                }
+            }
+        }
+
+        for (auto quality : { Quality::Short, Quality::Medium, Quality::Long })
+        {
+            const auto name = juce::String(" (quality ") + juce::String(static_cast<int>(quality)) + ")";
+
+            beginTest("DC passes at unity gain" + name);
+            {
+                for (auto ratio : { 44100.0 / 32000.0, 0.5, 6.0 })
+                {
+                    PolyphaseResampler resampler;
+                    resampler.prepare(32000.0 * ratio, 32000.0, quality, 4096);
+
+                    std::vector<float> in(4096, 0.5f), outL(4096), outR(4096);
+                    resampler.write(in.data(), in.data(), 4096);
+                    const int n = resampler.process(outL.data(), outR.data(), 4096);
+
+                    expect(n > 100);
+                    for (int i = n / 2; i < n; ++i)
+                        expectWithinAbsoluteError(outL[static_cast<size_t>(i)], 0.5f, 1.0e-4f);
+                }
+            }
+
+            beginTest("Pass band keeps level, stop band is rejected" + name);
+            {
+                // 48 kHz -> 32 kHz: 1 kHz stays, 20 kHz would alias to 12 kHz.
+                const float passband = measureLevel(quality, 48000.0, 32000.0, 1000.0);
+                const float stopband = measureLevel(quality, 48000.0, 32000.0, 20000.0);
+                const float required = quality == Quality::Short ? -50.0f : -70.0f;
+
+                logMessage("pass " + juce::String(passband, 3) + " dB, alias " + juce::String(stopband, 1) + " dB");
+                expectWithinAbsoluteError(passband, 0.0f, 0.1f);
+                expect(stopband < required, "alias at " + juce::String(stopband) + " dB");
+            }
+
+            beginTest("Halfband paths keep the pass band and reject aliases" + name);
+            {
+                // 64 kHz: 24 kHz would alias to 8 kHz. 128 kHz: 56 kHz would
+                // alias to 8 kHz in the first stage, 40 kHz to 24 kHz and
+                // then to 8 kHz in the second.
+                const float required = quality == Quality::Short ? -50.0f : -70.0f;
+
+                expectWithinAbsoluteError(measureLevel(quality, 64000.0, 32000.0, 1000.0), 0.0f, 0.1f);
+                expectWithinAbsoluteError(measureLevel(quality, 128000.0, 32000.0, 1000.0), 0.0f, 0.1f);
+                expectWithinAbsoluteError(measureLevel(quality, 32000.0, 64000.0, 1000.0), 0.0f, 0.1f);
+                expectWithinAbsoluteError(measureLevel(quality, 32000.0, 128000.0, 1000.0), 0.0f, 0.1f);
+
+                for (auto [rate, frequency] : { std::pair { 64000.0, 24000.0 }, std::pair { 128000.0, 56000.0 },
+                                                std::pair { 128000.0, 40000.0 } })
+                {
+                    const float alias = measureLevel(quality, rate, 32000.0, frequency);
+                    expect(alias < required, juce::String(frequency) + " Hz at " + juce::String(rate)
+                                                 + " Hz aliases at " + juce::String(alias) + " dB");
+                }
+            }
+
+            beginTest("Fixed-ratio kernels match the generic path" + name);
+            {
+                // Same design, exact rows instead of interpolated ones.
+                for (auto [in, out] : { std::pair { 44100.0, 32000.0 }, std::pair { 32000.0, 44100.0 },
+                                        std::pair { 48000.0, 32000.0 }, std::pair { 32000.0, 88200.0 },
+                                        std::pair { 96000.0, 32000.0 } })
+                {
+                    PolyphaseResampler fixed, generic;
+                    fixed.prepare(in, out, quality, 4096);
+                    generic.prepare(in, out, quality, 4096, false);
+                    expect(fixed.getPath() == PolyphaseResampler::Path::FixedRatio);
+                    expect(generic.getPath() == PolyphaseResampler::Path::Generic);
+                    expectEquals(fixed.getNumTaps(), generic.getNumTaps());
+
+                    std::vector<float> x(4096), aL(8192), aR(8192), bL(8192), bR(8192);
+                    for (size_t i = 0; i < x.size(); ++i)
+                        x[i] = 0.5f * static_cast<float>(std::sin(6.283185307179586 * 3000.0 * static_cast<double>(i) / in));
+
+                    fixed.write(x.data(), x.data(), 4096);
+                    generic.write(x.data(), x.data(), 4096);
+                    const int n = fixed.process(aL.data(), aR.data(), 8192);
+                    expectEquals(generic.process(bL.data(), bR.data(), 8192), n);
+
+                    float maxError = 0.0f;
+                    for (size_t i = 0; i < static_cast<size_t>(n); ++i)
+                        maxError = std::max(maxError, std::abs(aL[i] - bL[i]));
+                    expect(maxError < 1.0e-3f, juce::String(in) + " -> " + juce::String(out) + ": " + juce::String(maxError));
+                }
+            }
+
+            beginTest("getNumAvailable agrees with process" + name);
+            {
+                PolyphaseResampler resampler;
+                std::vector<float> in(1024, 0.1f), outL(4096), outR(4096);
+
+                // Fixed, single halfband, and both directions of the cascade.
+                for (auto [inRate, outRate] : { std::pair { 44100.0, 32000.0 }, std::pair { 64000.0, 32000.0 },
+                                                std::pair { 128000.0, 32000.0 }, std::pair { 32000.0, 128000.0 } })
+                {
+                    resampler.prepare(inRate, outRate, quality, 1024);
+
+                    for (int block = 1; block < 40; ++block)
+                    {
+                        const int n = (block * 37) % 1024;
+                        const int predicted = resampler.getNumAvailable(n);
+                        resampler.write(in.data(), in.data(), n);
+                        const int available = resampler.getNumAvailable();
+                        expectEquals(available, predicted);
+                        expectEquals(resampler.process(outL.data(), outR.data(), 4096), available);
+                        expectEquals(resampler.getNumAvailable(), 0);
+                    }
+                }
+            }
+        }
+
+        beginTest("Adapter keeps the level of a 1 kHz tone");
+        {
+            // Relative to the direct 32 kHz path, so the engine's own gain cancels.
+            double reference = 0.0;
+
+            for (auto rate : { 32000.0, 44100.0, 48000.0, 96000.0 })
+            {
+                CloudsEngine engine;
+                engine.init();
+                engine.setDryWet(0.0f);
+                SampleRateAdapter adapter;
+                adapter.prepare(rate, 512);
+
+                std::vector<float> inL(512), inR(512), outL(512), outR(512);
+                double phase = 0.0, sumIn = 0.0, sumOut = 0.0;
+
+                for (int block = 0; block < 200; ++block)
+                {
+                    for (size_t i = 0; i < 512; ++i)
+                    {
+                        phase += 1000.0 / rate;
+                        inL[i] = inR[i] = 0.25f * static_cast<float>(std::sin(6.283185307179586 * phase));
+                    }
+                    adapter.process(inL.data(), inR.data(), outL.data(), outR.data(), 512, engine);
+
+                    if (block >= 100)
+                        for (size_t i = 0; i < 512; ++i)
+                        {
+                            sumIn += inL[i] * inL[i];
+                            sumOut += outL[i] * outL[i];
+                        }
+                }
+
+                const double gainDb = 10.0 * std::log10(sumOut / sumIn);
+                if (rate == 32000.0)
+                    reference = gainDb;
+
+                logMessage(juce::String(rate) + " Hz: " + juce::String(gainDb - reference, 3) + " dB");
+                expectWithinAbsoluteError(gainDb, reference, 0.05);
+            }
+        }
+    }
+
+private:
+    // RMS level in dB of a sine at `frequency` after resampling, relative to
+    // the input's RMS.
+    static float measureLevel(PolyphaseResampler::Quality quality, double inputRate, double outputRate, double frequency)
+    {
+        constexpr int numInput = 32768;
+        PolyphaseResampler resampler;
+        resampler.prepare(inputRate, outputRate, quality, numInput);
+
+        std::vector<float> in(numInput), outL(numInput), outR(numInput);
+        for (int i = 0; i < numInput; ++i)
+            in[static_cast<size_t>(i)] = 0.5f * static_cast<float>(std::sin(6.283185307179586 * frequency * i / inputRate));
+
+        resampler.write(in.data(), in.data(), numInput);
+        const int n = resampler.process(outL.data(), outR.data(), numInput);
+
+        // Skip the start-up transient.
+        double sum = 0.0;
+        int count = 0;
+        for (int i = n / 4; i < n; ++i, ++count)
+            sum += static_cast<double>(outL[static_cast<size_t>(i)]) * outL[static_cast<size_t>(i)];
+
+        return static_cast<float>(10.0 * std::log10(sum / count / 0.125 + 1.0e-30));
+    }
+};
+
+static PolyphaseResamplerTests polyphaseResamplerTests;
@@ -0,0 +1,253 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+#include "Semaphore.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+// CloudsEngine::PrepareMode::Worker
+//==============================================================================
+class PrepareWorkerTests : public juce::UnitTest
+{
+public:
+    PrepareWorkerTests() : juce::UnitTest("Prepare Worker Tests") {}
+
+    void runTest() override
+    {
+        beginTest("Latency is reported only in worker mode");
+        {
+            CloudsEngine engine;
+            engine.init();
+            expectEquals(engine.getLatencySamples(), 0);
+
+            SampleRateAdapter adapter;
+            adapter.prepare(48000.0, 512);
+            const int resamplerLatency = adapter.getLatencySamples(engine);
+
+            engine.setPrepareMode(CloudsEngine::PrepareMode::Worker);
+            expectEquals(engine.getLatencySamples(), CloudsEngine::kBlockSize);
+            expectEquals(adapter.getLatencySamples(engine) - resamplerLatency, 48);
+
+            engine.setPrepareMode(CloudsEngine::PrepareMode::Inline);
+            expectEquals(engine.getLatencySamples(), 0);
+        }
+
+        beginTest("Worker mode processes all playback modes");
+        {
+            // Paced like a realtime host with the worker's work done before
+            // each callback, nothing counts as an overrun, and since
+            // Prepare() and Process() take turns the output is Inline
+            // mode's, sample for sample.
+            const auto reference = render(CloudsEngine::PrepareMode::Inline);
+            const auto worker = render(CloudsEngine::PrepareMode::Worker);
+
+            expectEquals(worker.overruns, 0u);
+            expectEquals(worker.overrunBlocks, 0);
+            expectEquals(worker.workerBlocks, static_cast<int>(worker.output.size()) / 32);
+            expectEquals(maxDifference(worker.output, reference.output, reference.output.size()), 0.0f);
+            expectGreaterThan(peak(reference.output), 0.1f);
+        }
+
+        beginTest("An unpaced worker is withdrawn or dropped, never waited for");
+        {
+            // Back-to-back calls give the worker no time at all; every
+            // Prepare() it has not finished is an overrun. One it had not
+            // started runs inline and the output still matches; one it was
+            // in the middle of leaves that call's block silent, and the
+            // processor's state takes a different path from there on.
+            const auto reference = render(CloudsEngine::PrepareMode::Inline);
+            const auto worker = render(CloudsEngine::PrepareMode::Worker, false);
+
+            expectEquals(static_cast<int>(worker.overruns), worker.overrunBlocks);
+
+            int firstDropped = -1;
+            for (size_t block = 0; block < worker.flags.size(); ++block)
+            {
+                if ((worker.flags[block] & TelemetryRecord::kPrepareDropped) == 0)
+                    continue;
+
+                if (firstDropped < 0)
+                    firstDropped = static_cast<int>(block);
+
+                for (size_t i = 0; i < 32; ++i)
+                    expectEquals(worker.output[32 * block + i], 0.0f, "Dropped block not silent");
+            }
+
+            const size_t matching = firstDropped < 0 ? worker.output.size() : 32 * static_cast<size_t>(firstDropped);
+            expectEquals(maxDifference(worker.output, reference.output, matching), 0.0f);
+        }
+
+        beginTest("Re-init and mode changes with a running worker");
+        {
+            // Both engines go through the same inits and Prepare() schedule
+            // changes; paced, the worker's output is Inline mode's throughout.
+            CloudsEngine engine, reference;
+            engine.setPrepareMode(CloudsEngine::PrepareMode::Worker);
+
+            std::vector<float> output, referenceOutput;
+            float inL[32], inR[32], outL[32], outR[32];
+            int block = 0;
+
+            auto run = [&](int numBlocks)
+            {
+                for (int b = 0; b < numBlocks; ++b, ++block)
+                {
+                    fillSine(inL, inR, block);
+                    engine.process(inL, inR, outL, outR, 32);
+                    engine.endCallback();
+                    output.insert(output.end(), outL, outL + 32);
+
+                    reference.process(inL, inR, outL, outR, 32);
+                    referenceOutput.insert(referenceOutput.end(), outL, outL + 32);
+
+                    do
+                        juce::Thread::sleep(1);
+                    while (engine.isPrepareInFlight());
+                }
+            };
+
+            for (int i = 0; i < 5; ++i)
+            {
+                engine.init();
+                reference.init();
+                for (auto* e : { &engine, &reference })
+                {
+                    e->setDryWet(1.0f);
+                    e->setFeedback(0.3f);
+                    e->setPlaybackMode(i % 4);
+                }
+                run(20);
+
+                engine.setPrepareMode(i % 2 == 0 ? CloudsEngine::PrepareMode::Inline
+                                                 : CloudsEngine::PrepareMode::Worker);
+                run(20);
+            }
+
+            expectEquals(engine.getPrepareOverruns(), 0u);
+            expectEquals(maxDifference(output, referenceOutput, output.size()), 0.0f);
+            expectGreaterThan(peak(referenceOutput), 0.1f);
+        }
+
+        beginTest("Semaphore counts posts and wakes a waiting thread");
+        {
+            Semaphore semaphore;
+            expect(!semaphore.tryWait());
+
+            semaphore.post();
+            semaphore.post();
+            expect(semaphore.tryWait());
+            expect(semaphore.tryWait());
+            expect(!semaphore.tryWait());
+
+            std::atomic<int> woken { 0 };
+            std::thread waiter([&]
+            {
+                for (int i = 0; i < 100; ++i)
+                {
+                    semaphore.wait();
+                    woken.fetch_add(1);
+                }
+            });
+
+            for (int i = 0; i < 100; ++i)
+            {
+                semaphore.post();
+                if (i % 10 == 0)
+                    juce::Thread::sleep(1);
+            }
+
+            waiter.join();
+            expectEquals(woken.load(), 100);
+            expect(!semaphore.tryWait());
+        }
+    }
+
+private:
+    struct Rendered
+    {
+        std::vector<float> output;
+        uint32_t overruns = 0;
+        int overrunBlocks = 0;
+        int workerBlocks = 0;
+        std::vector<uint8_t> flags;   // per block
+    };
+
+    static void fillSine(float* inL, float* inR, int block)
+    {
+        for (int i = 0; i < 32; ++i)
+        {
+            const float t = static_cast<float>(block * 32 + i) / 32000.0f;
+            inL[i] = inR[i] = 0.5f * std::sin(2.0f * 3.14159f * 440.0f * t);
+        }
+    }
+
+    // 200 blocks of a 440 Hz sine in each playback mode, left channel, one
+    // block per callback. Paced: a millisecond between calls, as a 32-frame
+    // realtime callback at 32 kHz would be, or longer if the worker has not
+    // got round to its Prepare() (the scheduler decides that, not the engine).
+    Rendered render(CloudsEngine::PrepareMode mode, bool paced = true)
+    {
+        CloudsEngine engine;
+        engine.setPrepareMode(mode);
+        engine.init();
+        engine.setDryWet(1.0f);
+        engine.setFeedback(0.3f);
+
+        constexpr int kNumSamples = 32;
+        float inL[kNumSamples], inR[kNumSamples], outL[kNumSamples], outR[kNumSamples];
+
+        Rendered rendered;
+        auto& telemetry = engine.getTelemetry();
+        telemetry.reset();
+
+        for (int playbackMode = 0; playbackMode < 4; ++playbackMode)
+        {
+            engine.setPlaybackMode(playbackMode);
+
+            for (int block = 0; block < 200; ++block)
+            {
+                fillSine(inL, inR, block);
+                engine.process(inL, inR, outL, outR, kNumSamples);
+                engine.endCallback();
+                rendered.output.insert(rendered.output.end(), outL, outL + kNumSamples);
+
+                telemetry.forEach([&](const TelemetryRecord& record)
+                {
+                    rendered.flags.push_back(record.flags);
+                    rendered.overrunBlocks += (record.flags & TelemetryRecord::kPrepareOverrun) != 0 ? 1 : 0;
+                    rendered.workerBlocks += (record.flags & TelemetryRecord::kPrepareWorker) != 0 ? 1 : 0;
+                });
+
+                if (paced)
+                    do
+                        juce::Thread::sleep(1);
+                    while (engine.isPrepareInFlight());
+            }
+        }
+
+        rendered.overruns = engine.getPrepareOverruns();
+        return rendered;
+    }
+
+    // Over the first numSamples samples.
+    static float maxDifference(const std::vector<float>& a, const std::vector<float>& b, size_t numSamples)
+    {
+        float result = 0.0f;
+        for (size_t i = 0; i < numSamples; ++i)
+            result = std::max(result, std::abs(a[i] - b[i]));
+        return result;
+    }
+
+    static float peak(const std::vector<float>& a)
+    {
+        float result = 0.0f;
+        for (auto v : a)
+            result = std::max(result, std::abs(v));
+        return result;
+    }
+};
+
+static PrepareWorkerTests prepareWorkerTests;
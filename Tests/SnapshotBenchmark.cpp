@@ -0,0 +1,88 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "CloudsEngine.h"
+
+// Compares CloudsEngine::init() against restoring a warmed-up snapshot and
+// cloning a golden engine, i.e. what prepareToPlay / preset recall pay per
+// instance.
+int main(int argc, char* argv[])
+{
+    const int kIterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+
+    using Clock = std::chrono::steady_clock;
+    auto microsPerIteration = [kIterations](Clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count() / kIterations;
+    };
+
+    std::cout << "=== CloudsEngine snapshot benchmark (" << kIterations << " iterations) ===" << std::endl;
+
+    // Golden engine: initialised and run for a while so the snapshot is
+    // representative of a live instance.
+    CloudsEngine golden;
+    golden.init();
+    {
+        float in[32] = {}, outL[32], outR[32];
+        for (int b = 0; b < 100; ++b)
+            golden.process(in, in, outL, outR, 32);
+    }
+
+    juce::MemoryBlock blob;
+    golden.captureSnapshot(blob);
+    std::cout << "Snapshot size: " << blob.getSize() << " bytes" << std::endl;
+
+    // The first restore in a process also finds the processor's pointer
+    // members; every later one reuses them.
+    double firstRestoreUs = 0.0;
+    {
+        auto first = std::make_unique<CloudsEngine>();
+        const auto firstStart = Clock::now();
+        first->restoreSnapshot(blob.getData(), blob.getSize());
+        firstRestoreUs = std::chrono::duration<double, std::micro>(Clock::now() - firstStart).count();
+    }
+
+    // Fresh engines each time, as in a session load.
+    std::vector<std::unique_ptr<CloudsEngine>> engines;
+    auto makeEngines = [&engines, kIterations] {
+        engines.clear();
+        for (int i = 0; i < kIterations; ++i)
+            engines.push_back(std::make_unique<CloudsEngine>());
+    };
+
+    makeEngines();
+    auto start = Clock::now();
+    for (auto& e : engines)
+        e->init();
+    const double initUs = microsPerIteration(Clock::now() - start);
+
+    makeEngines();
+    start = Clock::now();
+    for (auto& e : engines)
+        e->restoreSnapshot(blob.getData(), blob.getSize());
+    const double restoreUs = microsPerIteration(Clock::now() - start);
+
+    makeEngines();
+    start = Clock::now();
+    for (auto& e : engines)
+        e->cloneFrom(golden);
+    const double cloneUs = microsPerIteration(Clock::now() - start);
+
+    // Re-preparing an existing instance (sample-rate change): buffers are reused.
+    start = Clock::now();
+    for (auto& e : engines)
+        e->restoreSnapshot(blob.getData(), blob.getSize());
+    const double restoreWarmUs = microsPerIteration(Clock::now() - start);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "init()                     : " << initUs << " us" << std::endl;
+    std::cout << "restoreSnapshot() (first)  : " << firstRestoreUs << " us  (once per process)" << std::endl;
+    std::cout << "restoreSnapshot() (fresh)  : " << restoreUs << " us  (x" << initUs / restoreUs << ")" << std::endl;
+    std::cout << "cloneFrom()       (fresh)  : " << cloneUs << " us  (x" << initUs / cloneUs << ")" << std::endl;
+    std::cout << "restoreSnapshot() (reused) : " << restoreWarmUs << " us  (x" << initUs / restoreWarmUs << ")" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "PointerRelocation.h"
+#include "stmlib/utils/random.h"
+
+#include <vector>
+
+//==============================================================================
+// CloudsEngine::captureSnapshot / restoreSnapshot / cloneFrom
+//==============================================================================
+class SnapshotTests : public juce::UnitTest
+{
+public:
+    SnapshotTests() : juce::UnitTest("Snapshot Tests") {}
+
+    void runTest() override
+    {
+        beginTest("Uninitialised engine captures nothing");
+        {
+            CloudsEngine engine;
+            juce::MemoryBlock blob;
+            engine.captureSnapshot(blob);
+            expectEquals(static_cast<int>(blob.getSize()), 0);
+            expect(!engine.restoreSnapshot(blob.getData(), blob.getSize()));
+        }
+
+        beginTest("Restored and cloned engines continue exactly like the original");
+        {
+            juce::MemoryBlock blob;
+            auto golden = std::make_unique<CloudsEngine>();
+            golden->init();
+            golden->setPlaybackMode(2);
+            golden->setDryWet(0.8f);
+            golden->setFeedback(0.4f);
+            render(*golden, 0, 150);
+            golden->captureSnapshot(blob);
+
+            CloudsEngine restored, cloned;
+            expect(restored.restoreSnapshot(blob.getData(), blob.getSize()), "restore failed");
+            expect(cloned.cloneFrom(*golden), "clone failed");
+            expect(restored.isInitialised() && cloned.isInitialised());
+
+            // What the original goes on to do.
+            const auto expected = render(*golden, 150, 200);
+
+            // Nothing may still point into the golden engine's memory.
+            golden.reset();
+
+            const auto a = render(restored, 150, 200);
+            const auto b = render(cloned, 150, 200);
+
+            CloudsEngine restoredAgain;
+            restoredAgain.restoreSnapshot(blob.getData(), blob.getSize());
+            const auto c = render(restoredAgain, 150, 200);
+
+            expect(a == expected, "Restored snapshot diverges from the original");
+            expect(a == b, "Clone diverges from restored snapshot");
+            expect(a == c, "Restoring the same snapshot twice is not deterministic");
+
+            float peak = 0.0f;
+            for (auto v : a)
+                peak = std::max(peak, std::abs(v));
+            expect(peak > 0.01f, "Restored engine should produce audio");
+        }
+
+        beginTest("Restore over an initialised engine");
+        {
+            CloudsEngine source, target;
+            source.init();
+            render(source, 0, 50);
+            target.init();
+
+            juce::MemoryBlock blob;
+            source.captureSnapshot(blob);
+            expect(target.restoreSnapshot(blob.getData(), blob.getSize()));
+            expect(!target.getHostDryWet());
+
+            // Host dry/wet decides what the engine's DRY/WET does, so it
+            // travels with the state.
+            source.setHostDryWet(true);
+            source.captureSnapshot(blob);
+            expect(target.restoreSnapshot(blob.getData(), blob.getSize()));
+            expect(target.getHostDryWet());
+        }
+
+        beginTest("Malformed snapshots are rejected");
+        {
+            CloudsEngine source, target;
+            source.init();
+
+            juce::MemoryBlock blob;
+            source.captureSnapshot(blob);
+
+            expect(!target.restoreSnapshot(blob.getData(), blob.getSize() - 1), "Truncated blob accepted");
+
+            juce::MemoryBlock corrupt(blob);
+            static_cast<uint8_t*>(corrupt.getData())[0] ^= 0xff;
+            expect(!target.restoreSnapshot(corrupt.getData(), corrupt.getSize()), "Bad magic accepted");
+            expect(!target.isInitialised());
+
+            // SnapshotHeader: magic, version, processorSize, then largeBufferSize.
+            corrupt = blob;
+            const uint32_t wrongSize = 2 * 118784;
+            std::memcpy(static_cast<uint8_t*>(corrupt.getData()) + 3 * sizeof(uint32_t), &wrongSize, sizeof(wrongSize));
+            expect(!target.restoreSnapshot(corrupt.getData(), corrupt.getSize()), "Wrong buffer size accepted");
+            expect(!target.isInitialised());
+
+            // ... smallBufferSize, hostDryWet, then the token of the process
+            // that took it: its pointers into static tables mean nothing here.
+            corrupt = blob;
+            static_cast<uint8_t*>(corrupt.getData())[6 * sizeof(uint32_t)] ^= 0x01;
+            expect(!target.restoreSnapshot(corrupt.getData(), corrupt.getSize()), "Snapshot from another process accepted");
+            expect(!target.isInitialised());
+        }
+
+        beginTest("Relocation rebases pointer members only");
+        {
+            // One pointer into itself, one into a buffer, one past the end
+            // of the buffer, nullptr, and data words holding buffer and
+            // object addresses.
+            struct Toy
+            {
+                Toy* self;
+                float* data;
+                float* end;
+                float* unused;
+                uintptr_t lookalike;
+                uintptr_t selfLookalike;
+            };
+
+            // Separate heap blocks: a pointer one past the end of one block
+            // never lands on the start of another, as with the engine's own.
+            std::vector<float> buffers[3] = { std::vector<float>(16), std::vector<float>(16), std::vector<float>(16) };
+            float* bufferA = buffers[0].data();
+            float* bufferB = buffers[1].data();
+            float* bufferC = buffers[2].data();
+            auto toys = std::make_unique<Toy[]>(5);
+            Toy& a = toys[0];
+            Toy& b = toys[1];
+            Toy& c = toys[2];
+            const auto blocksFor = [](Toy& toy, float* buffer)
+            {
+                return std::vector<PointerRelocation::Block> {
+                    { reinterpret_cast<uintptr_t>(&toy), sizeof(Toy) },
+                    { reinterpret_cast<uintptr_t>(buffer), 16 * sizeof(float) },
+                };
+            };
+            const auto build = [](Toy& toy, float* buffer)
+            {
+                toy = { &toy, buffer + 3, buffer + 16, nullptr, 0x1234, 0x5678 };
+            };
+
+            build(a, bufferA);
+            build(b, bufferB);
+            const auto blocksA = blocksFor(a, bufferA);
+            const auto blocksB = blocksFor(b, bufferB);
+            const auto offsets = PointerRelocation::findPointers(&a, blocksA.data(), &b, blocksB.data(), sizeof(Toy), 2);
+            expectEquals(static_cast<int>(offsets.size()), 3);
+
+            // Only the unused pointer is set in another configuration.
+            Toy& d = toys[3];
+            Toy& e = toys[4];
+            build(d, bufferA);
+            build(e, bufferB);
+            d.unused = bufferA + 1;
+            e.unused = bufferB + 1;
+            auto merged = offsets;
+            PointerRelocation::merge(merged, PointerRelocation::findPointers(&d, blocksFor(d, bufferA).data(),
+                                                                             &e, blocksFor(e, bufferB).data(), sizeof(Toy), 2));
+            expectEquals(static_cast<int>(merged.size()), 4);
+
+            // The data words now look exactly like pointers into the source.
+            a.lookalike = reinterpret_cast<uintptr_t>(bufferA + 5);
+            a.selfLookalike = reinterpret_cast<uintptr_t>(&a);
+            std::memcpy(&c, &a, sizeof(Toy));
+
+            expect(PointerRelocation::validate(&c, sizeof(Toy), merged.data(), merged.size(), blocksA.data(), 2));
+            const auto blocksC = blocksFor(c, bufferC);
+            PointerRelocation::relocate(&c, merged.data(), merged.size(), blocksA.data(), blocksC.data(), 2);
+
+            expect(c.self == &c);
+            expect(c.data == bufferC + 3);
+            expect(c.end == bufferC + 16);
+            expect(c.unused == nullptr);
+            expect(c.lookalike == reinterpret_cast<uintptr_t>(bufferA + 5), "Data word rebased");
+            expect(c.selfLookalike == reinterpret_cast<uintptr_t>(&a), "Data word rebased");
+
+            // A pointer member outside every block is refused.
+            a.data = bufferB;
+            expect(!PointerRelocation::validate(&a, sizeof(Toy), merged.data(), merged.size(), blocksA.data(), 2));
+        }
+    }
+
+private:
+    // Renders blocks [firstBlock, lastBlock) of a fixed stimulus from a fixed
+    // random seed, so two engines in the same state produce the same output.
+    static std::vector<float> render(CloudsEngine& engine, int firstBlock, int lastBlock)
+    {
+        constexpr int numSamples = 32;
+        stmlib::Random::Seed(0x5eed);
+
+        std::vector<float> out;
+        float inL[numSamples], inR[numSamples], outL[numSamples], outR[numSamples];
+
+        for (int block = firstBlock; block < lastBlock; ++block)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float t = static_cast<float>(block * numSamples + i) / 32000.0f;
+                inL[i] = 0.5f * std::sin(2.0f * 3.14159265f * 330.0f * t);
+                inR[i] = 0.5f * std::sin(2.0f * 3.14159265f * 440.0f * t);
+            }
+
+            engine.process(inL, inR, outL, outR, numSamples);
+            out.insert(out.end(), outL, outL + numSamples);
+            out.insert(out.end(), outR, outR + numSamples);
+        }
+        return out;
+    }
+};
+
+static SnapshotTests snapshotTests;
@@ -0,0 +1,358 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "CloudsEngine.h"
+#include "CloudsProcessor.h"
+#include "SampleRateAdapter.h"
+
+// Per-callback latency of SampleRateAdapter + CloudsEngine under randomised
+// host block sizes and parameter automation.
+//
+//   TailLatencyBenchmark [--minutes m] [--rate hz] [--max-block n] [--worker | --processor]
+//                        [--budget-max f] [--budget-p999 f] [--seed n] [--out results.json]
+//
+// Simulates `minutes` of audio (default 10; use 60+ for soak runs) in
+// callbacks whose size is drawn per call, like hosts that split buffers at
+// automation points or loop boundaries. Between callbacks the automation
+// moves the continuous parameters and, at random, switches playback mode or
+// quality, toggles freeze and fires triggers, which are the events that
+// cause sporadic slow callbacks.
+//
+// By default the callbacks go straight to SampleRateAdapter::process(), set
+// up the way CloudsVSTProcessor sets it up. --processor runs them through
+// CloudsVSTProcessor::processBlock() instead, with the automation written to
+// its parameters, so the per-callback parameter reads are timed as well.
+// --worker moves Prepare() to the worker thread; the processor runs it inline.
+//
+// Every callback's wall time is divided by its deadline (block / rate). The
+// report gives p50 / p99 / p99.9 / max of that load, and the worst callbacks
+// with the events that preceded them. The program exits with 1 when the max
+// load exceeds --budget-max (default 1.0 = missed deadline) or the p99.9
+// load exceeds --budget-p999 (default 0.5).
+namespace
+{
+    enum EventFlags : uint8_t
+    {
+        kModeChange    = 1 << 0,
+        kQualityChange = 1 << 1,
+        kFreezeToggle  = 1 << 2,
+        kTrigger       = 1 << 3,
+    };
+
+    struct Callback
+    {
+        float load;          // wall time / deadline
+        float micros;
+        uint16_t blockSize;
+        uint8_t events;
+        uint8_t mode;
+    };
+
+    std::string describeEvents(uint8_t events)
+    {
+        std::string s;
+        auto add = [&s](const char* name) { s += s.empty() ? name : std::string("+") + name; };
+        if (events & kModeChange)    add("mode");
+        if (events & kQualityChange) add("quality");
+        if (events & kFreezeToggle)  add("freeze");
+        if (events & kTrigger)       add("trigger");
+        return s.empty() ? "-" : s;
+    }
+
+    double percentile(std::vector<float>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+
+        const auto index = static_cast<size_t>(std::min<double>(static_cast<double>(sorted.size() - 1),
+                                                                std::ceil(p / 100.0 * static_cast<double>(sorted.size())) - 1.0));
+        return sorted[index];
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double minutes = 10.0;
+    double sampleRate = 48000.0;
+    int maxBlock = 2048;
+    bool worker = false;
+    bool useProcessor = false;
+    double budgetMax = 1.0;
+    double budgetP999 = 0.5;
+    unsigned seed = 1;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--minutes" && hasValue)          minutes = std::max(0.01, std::atof(argv[++i]));
+        else if (arg == "--rate" && hasValue)        sampleRate = std::max(8000.0, std::atof(argv[++i]));
+        else if (arg == "--max-block" && hasValue)   maxBlock = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--budget-max" && hasValue)  budgetMax = std::atof(argv[++i]);
+        else if (arg == "--budget-p999" && hasValue) budgetP999 = std::atof(argv[++i]);
+        else if (arg == "--seed" && hasValue)        seed = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--out" && hasValue)         outPath = argv[++i];
+        else if (arg == "--worker")                  worker = true;
+        else if (arg == "--processor")               useProcessor = true;
+        else
+        {
+            std::cerr << "usage: TailLatencyBenchmark [--minutes m] [--rate hz] [--max-block n] [--worker | --processor]\n"
+                         "                            [--budget-max f] [--budget-p999 f] [--seed n] [--out results.json]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    if (worker && useProcessor)
+    {
+        std::cerr << "--worker and --processor cannot be combined" << std::endl;
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    auto uniform = [&rng](float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); };
+    auto chance = [&rng](double p) { return std::bernoulli_distribution(p)(rng); };
+
+    std::unique_ptr<CloudsEngine> engine;
+    std::unique_ptr<SampleRateAdapter> adapter;
+    std::unique_ptr<CloudsVSTProcessor> processor;
+
+    if (useProcessor)
+    {
+        processor = std::make_unique<CloudsVSTProcessor>();
+        processor->prepareToPlay(sampleRate, maxBlock);
+    }
+    else
+    {
+        // As CloudsVSTProcessor::prepareToPlay() does it, for the engine's
+        // latency and rate.
+        engine = std::make_unique<CloudsEngine>();
+        adapter = std::make_unique<SampleRateAdapter>();
+        engine->init();
+        engine->setIdleDetectionEnabled(false);
+        engine->setPrepareMode(worker ? CloudsEngine::PrepareMode::Worker : CloudsEngine::PrepareMode::Inline);
+        engine->setLatencyCompensation(true);
+        engine->setHostDryWet(true);
+        adapter->prepare(sampleRate, maxBlock, engine->getLatencySamples(), engine->getSampleRate());
+    }
+
+    // --processor: automation goes to the parameters, as a host writes it.
+    auto setParameter = [&](const char* id, float value)
+    {
+        auto* parameter = processor->getAPVTS().getParameter(id);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    };
+    bool triggerHeld = false;
+
+    // Common power-of-two sizes most of the time, arbitrary sizes otherwise.
+    const int commonSizes[] = { 32, 64, 128, 256, 512, 1024, 2048 };
+    auto drawBlockSize = [&]
+    {
+        if (chance(0.7))
+        {
+            std::vector<int> allowed;
+            for (auto s : commonSizes)
+                if (s <= maxBlock)
+                    allowed.push_back(s);
+            if (!allowed.empty())
+                return allowed[std::uniform_int_distribution<size_t>(0, allowed.size() - 1)(rng)];
+        }
+        return std::uniform_int_distribution<int>(1, maxBlock)(rng);
+    };
+
+    std::vector<float> inL(static_cast<size_t>(maxBlock)), inR(static_cast<size_t>(maxBlock));
+    std::vector<float> outL(static_cast<size_t>(maxBlock)), outR(static_cast<size_t>(maxBlock));
+    juce::AudioBuffer<float> buffer(2, maxBlock);
+    juce::MidiBuffer midi;
+
+    const auto totalSamples = static_cast<int64_t>(minutes * 60.0 * sampleRate);
+    std::vector<Callback> callbacks;
+    callbacks.reserve(static_cast<size_t>(totalSamples / 256));
+
+    int mode = 0, quality = 0;
+    bool freeze = false;
+    double phase = 0.0;
+    float position = 0.5f, size = 0.5f, pitch = 0.0f, density = 0.5f, texture = 0.5f;
+
+    std::cerr << "Simulating " << minutes << " min at " << sampleRate << " Hz, blocks up to " << maxBlock
+              << (worker ? ", Prepare on worker" : "") << (useProcessor ? ", through the processor" : "") << std::endl;
+
+    for (int64_t done = 0; done < totalSamples;)
+    {
+        const int n = static_cast<int>(std::min<int64_t>(drawBlockSize(), totalSamples - done));
+
+        // Automation for this callback
+        uint8_t events = 0;
+        auto drift = [&](float& v, float lo, float hi, float step) { v = std::min(hi, std::max(lo, v + uniform(-step, step))); };
+        drift(position, 0.0f, 1.0f, 0.02f);
+        drift(size, 0.0f, 1.0f, 0.02f);
+        drift(pitch, -24.0f, 24.0f, 0.5f);
+        drift(density, 0.0f, 1.0f, 0.02f);
+        drift(texture, 0.0f, 1.0f, 0.02f);
+
+        if (processor != nullptr)
+        {
+            setParameter("position", position);
+            setParameter("size", size);
+            setParameter("pitch", pitch);
+            setParameter("density", density);
+            setParameter("texture", texture);
+
+            // TRIGGER is a button: released again after one callback.
+            if (triggerHeld)
+                setParameter("trigger", 0.0f);
+            triggerHeld = false;
+        }
+        else
+        {
+            engine->setPosition(position);
+            engine->setSize(size);
+            engine->setPitch(pitch);
+            engine->setDensity(density);
+            engine->setTexture(texture);
+        }
+
+        if (chance(0.002))
+        {
+            mode = (mode + 1 + std::uniform_int_distribution<int>(0, 2)(rng)) % 4;
+            if (processor != nullptr)
+                setParameter("playback_mode", static_cast<float>(mode));
+            else
+                engine->setPlaybackMode(mode);
+            events |= kModeChange;
+        }
+        if (chance(0.001))
+        {
+            quality = (quality + 1 + std::uniform_int_distribution<int>(0, 2)(rng)) % 4;
+            if (processor != nullptr)
+                setParameter("quality", static_cast<float>(quality));
+            else
+                engine->setQuality(quality);
+            events |= kQualityChange;
+        }
+        if (chance(0.005))
+        {
+            freeze = !freeze;
+            if (processor != nullptr)
+                setParameter("freeze", freeze ? 1.0f : 0.0f);
+            else
+                engine->setFreeze(freeze);
+            events |= kFreezeToggle;
+        }
+        if (chance(0.01))
+        {
+            if (processor != nullptr)
+            {
+                setParameter("trigger", 1.0f);
+                triggerHeld = true;
+            }
+            else
+            {
+                engine->setTrigger(true);
+            }
+            events |= kTrigger;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            phase += 220.0 / sampleRate;
+            phase -= std::floor(phase);
+            const auto idx = static_cast<size_t>(i);
+            inL[idx] = 0.4f * static_cast<float>(std::sin(6.283185307179586 * phase));
+            inR[idx] = 0.4f * static_cast<float>(std::sin(6.283185307179586 * 1.5 * phase));
+        }
+
+        // The processor works in place, so its buffer is filled outside the timing.
+        if (processor != nullptr)
+        {
+            buffer.setSize(2, n, false, false, true);
+            buffer.copyFrom(0, 0, inL.data(), n);
+            buffer.copyFrom(1, 0, inR.data(), n);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (processor != nullptr)
+            processor->processBlock(buffer, midi);
+        else
+            adapter->process(inL.data(), inR.data(), outL.data(), outR.data(), n, *engine);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const double deadline = n / sampleRate;
+        callbacks.push_back({ static_cast<float>(seconds / deadline), static_cast<float>(seconds * 1.0e6),
+                              static_cast<uint16_t>(n), events, static_cast<uint8_t>(mode) });
+        done += n;
+    }
+
+    std::vector<float> loads;
+    loads.reserve(callbacks.size());
+    for (const auto& c : callbacks)
+        loads.push_back(c.load);
+    std::sort(loads.begin(), loads.end());
+
+    const double p50 = percentile(loads, 50.0);
+    const double p99 = percentile(loads, 99.0);
+    const double p999 = percentile(loads, 99.9);
+    const double maxLoad = loads.empty() ? 0.0 : loads.back();
+
+    std::vector<Callback> worst(callbacks);
+    const size_t numWorst = std::min<size_t>(10, worst.size());
+    std::partial_sort(worst.begin(), worst.begin() + static_cast<long>(numWorst), worst.end(),
+                      [](const Callback& a, const Callback& b) { return a.load > b.load; });
+
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << "Callbacks: " << callbacks.size() << std::endl;
+    std::cout << "Load (fraction of deadline)  p50 " << p50 << "  p99 " << p99
+              << "  p99.9 " << p999 << "  max " << maxLoad << std::endl;
+    std::cout << "Worst callbacks:" << std::endl;
+    for (size_t i = 0; i < numWorst; ++i)
+    {
+        const auto& c = worst[i];
+        std::cout << "  load " << c.load << "  " << std::setprecision(1) << c.micros << " us  block "
+                  << c.blockSize << "  mode " << static_cast<int>(c.mode) << "  events "
+                  << describeEvents(c.events) << std::setprecision(4) << std::endl;
+    }
+
+    if (!outPath.empty())
+    {
+        std::ofstream file(outPath);
+        file << std::setprecision(6);
+        file << "{\n"
+             << "  \"benchmark\": \"clouds_tail_latency\",\n"
+             << "  \"sampleRate\": " << sampleRate << ",\n"
+             << "  \"maxBlock\": " << maxBlock << ",\n"
+             << "  \"prepareWorker\": " << (worker ? "true" : "false") << ",\n"
+             << "  \"processor\": " << (useProcessor ? "true" : "false") << ",\n"
+             << "  \"minutes\": " << minutes << ",\n"
+             << "  \"callbacks\": " << callbacks.size() << ",\n"
+             << "  \"load\": { \"p50\": " << p50 << ", \"p99\": " << p99
+             << ", \"p999\": " << p999 << ", \"max\": " << maxLoad << " },\n"
+             << "  \"budget\": { \"max\": " << budgetMax << ", \"p999\": " << budgetP999 << " }\n"
+             << "}\n";
+    }
+
+    bool pass = true;
+    if (maxLoad > budgetMax)
+    {
+        std::cout << "FAIL: max load " << maxLoad << " exceeds budget " << budgetMax << std::endl;
+        pass = false;
+    }
+    if (p999 > budgetP999)
+    {
+        std::cout << "FAIL: p99.9 load " << p999 << " exceeds budget " << budgetP999 << std::endl;
+        pass = false;
+    }
+    if (pass)
+        std::cout << "PASS" << std::endl;
+
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "EngineTelemetry.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+// TelemetryRing and the per-block records CloudsEngine writes into it.
+//==============================================================================
+class TelemetryTests : public juce::UnitTest
+{
+public:
+    TelemetryTests() : juce::UnitTest("Telemetry Tests") {}
+
+    void runTest() override
+    {
+        beginTest("Records are cache-line sized");
+        {
+            expectEquals(static_cast<int>(alignof(TelemetryRecord)), 64);
+            expectEquals(static_cast<int>(sizeof(TelemetryRecord)), 64);
+        }
+
+        beginTest("Ring drains in order and drops when full");
+        {
+            auto ring = std::make_unique<TelemetryRing>();
+            constexpr int capacity = static_cast<int>(TelemetryRing::kCapacity);
+
+            for (int i = 0; i < capacity + 10; ++i)
+            {
+                TelemetryRecord r;
+                r.blockIndex = static_cast<uint64_t>(i);
+                expect(ring->push(r) == (i < capacity));
+            }
+
+            expectEquals(ring->getNumReady(), capacity);
+            expectEquals(static_cast<int>(ring->getDroppedCount()), 10);
+
+            std::vector<TelemetryRecord> out(static_cast<size_t>(capacity));
+            expectEquals(ring->drain(out.data(), 100), 100);
+
+            bool ordered = true;
+            for (int i = 0; i < 100; ++i)
+                ordered = ordered && out[static_cast<size_t>(i)].blockIndex == static_cast<uint64_t>(i);
+            expect(ordered);
+
+            TelemetryRecord r;
+            r.blockIndex = 9999;
+            expect(ring->push(r), "Draining must free slots");
+
+            const int rest = ring->drain(out.data(), capacity);
+            expectEquals(rest, capacity - 100 + 1);
+            expect(out[static_cast<size_t>(rest - 1)].blockIndex == 9999);
+            expectEquals(ring->getNumReady(), 0);
+        }
+
+        beginTest("Engine writes one record per engine block");
+        {
+            auto engine = std::make_unique<CloudsEngine>();
+            engine->init();
+            engine->setPlaybackMode(2);
+            engine->setQuality(1);
+
+            std::vector<float> in(100), outL(100), outR(100);
+            for (size_t i = 0; i < in.size(); ++i)
+                in[i] = std::sin(0.1f * static_cast<float>(i));
+
+            engine->process(in.data(), in.data(), outL.data(), outR.data(), 100);   // 4 engine blocks
+
+            std::vector<TelemetryRecord> records(16);
+            const int n = engine->getTelemetry().drain(records.data(), 16);
+            expectEquals(n, 4);
+
+            bool sane = true;
+            for (int i = 0; i < n; ++i)
+            {
+                const auto& r = records[static_cast<size_t>(i)];
+                sane = sane && r.blockIndex == static_cast<uint64_t>(i);
+                sane = sane && r.playbackMode == 2 && r.quality == 1;
+                sane = sane && r.inputPeak > 0.0f && r.inputRms > 0.0f && r.inputRms <= r.inputPeak + 1.0e-4f;
+                sane = sane && r.processMicros >= 0.0f && r.prepareMicros >= 0.0f;
+                sane = sane && (r.flags & TelemetryRecord::kIdle) == 0;
+            }
+            expect(sane, "Records should carry block index, mode and input levels");
+        }
+
+        beginTest("Input clips are counted");
+        {
+            auto engine = std::make_unique<CloudsEngine>();
+            engine->init();
+            engine->setInputTrim(4.0f);
+
+            std::vector<float> in(32, 1.0f), out(32);
+            engine->process(in.data(), in.data(), out.data(), out.data(), 32);
+
+            TelemetryRecord r;
+            expectEquals(engine->getTelemetry().drain(&r, 1), 1);
+            expectEquals(static_cast<int>(r.inputClips), 64);
+        }
+
+        beginTest("A concurrent reader sees every block");
+        {
+            auto engine = std::make_unique<CloudsEngine>();
+            engine->init();
+
+            constexpr int numBlocks = 4000;
+            std::atomic<bool> done { false };
+            uint64_t expected = 0;
+            int gaps = 0;
+
+            std::thread reader([&]
+            {
+                auto& ring = engine->getTelemetry();
+                auto check = [&](const TelemetryRecord& r)
+                {
+                    gaps += (r.blockIndex != expected) ? 1 : 0;
+                    expected = r.blockIndex + 1;
+                };
+
+                while (!done.load(std::memory_order_acquire))
+                {
+                    ring.forEach(check);
+                    std::this_thread::yield();
+                }
+                ring.forEach(check);
+            });
+
+            std::vector<float> in(32, 0.1f), outL(32), outR(32);
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                engine->process(in.data(), in.data(), outL.data(), outR.data(), 32);
+
+                // Keep the writer from lapping a reader that is not scheduled.
+                while (engine->getTelemetry().getNumReady() > static_cast<int>(TelemetryRing::kCapacity) / 2)
+                    std::this_thread::yield();
+            }
+
+            done.store(true, std::memory_order_release);
+            reader.join();
+
+            expectEquals(gaps, 0);
+            expect(expected == static_cast<uint64_t>(numBlocks));
+            expectEquals(static_cast<int>(engine->getTelemetry().getDroppedCount()), 0);
+        }
+    }
+};
+
+static TelemetryTests telemetryTests;
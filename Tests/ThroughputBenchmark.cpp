@@ -0,0 +1,200 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+#include "EngineKernels.h"
+
+// Throughput of SampleRateAdapter + CloudsEngine for every playback mode x
+// quality x host sample rate x host block size.
+//
+//   ThroughputBenchmark [--seconds s] [--quick] [--out results.json]
+//
+// Each case renders `seconds` of host-rate audio (default 2) after a short
+// warm-up and reports ns per host sample and the realtime factor (audio time
+// / wall time, single core). The JSON goes to --out or stdout; progress goes
+// to stderr. --quick limits the run to 48 kHz at 512 samples, for CI.
+namespace
+{
+    struct Case
+    {
+        int mode;
+        int quality;
+        double sampleRate;
+        int blockSize;
+    };
+
+    struct Result
+    {
+        Case c;
+        double nsPerSample;
+        double realtimeFactor;
+        double wallSeconds;
+    };
+
+    const char* const kModeNames[] = { "granular", "stretch", "looping", "spectral" };
+
+    // Deterministic, broadband stimulus: two detuned saws plus noise, so
+    // every mode has transients and pitched material to work on.
+    void fillStimulus(std::vector<float>& l, std::vector<float>& r, double sampleRate)
+    {
+        uint32_t seed = 0x2545f491;
+        double phaseA = 0.0, phaseB = 0.0;
+
+        for (size_t i = 0; i < l.size(); ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const float noise = static_cast<float>(seed >> 8) / 16777216.0f * 2.0f - 1.0f;
+
+            phaseA += 110.0 / sampleRate;
+            phaseB += 164.8 / sampleRate;
+            phaseA -= std::floor(phaseA);
+            phaseB -= std::floor(phaseB);
+
+            l[i] = 0.3f * static_cast<float>(2.0 * phaseA - 1.0) + 0.05f * noise;
+            r[i] = 0.3f * static_cast<float>(2.0 * phaseB - 1.0) - 0.05f * noise;
+        }
+    }
+
+    Result runCase(const Case& c, double seconds)
+    {
+        auto engine = std::make_unique<CloudsEngine>();
+        auto adapter = std::make_unique<SampleRateAdapter>();
+
+        engine->init();
+        engine->setIdleDetectionEnabled(false);
+        engine->setPlaybackMode(c.mode);
+        engine->setQuality(c.quality);
+        engine->setDensity(0.7f);
+        engine->setDryWet(0.7f);
+        engine->setFeedback(0.3f);
+        engine->setReverb(0.3f);
+        adapter->prepare(c.sampleRate, c.blockSize, engine->getLatencySamples(), engine->getSampleRate());
+
+        // One second of stimulus, looped.
+        const auto stimulusLength = static_cast<size_t>(c.sampleRate);
+        std::vector<float> inL(stimulusLength), inR(stimulusLength);
+        fillStimulus(inL, inR, c.sampleRate);
+        std::vector<float> outL(static_cast<size_t>(c.blockSize)), outR(static_cast<size_t>(c.blockSize));
+
+        size_t readPos = 0;
+        auto runBlocks = [&](int64_t numBlocks)
+        {
+            for (int64_t b = 0; b < numBlocks; ++b)
+            {
+                if (readPos + static_cast<size_t>(c.blockSize) > stimulusLength)
+                    readPos = 0;
+
+                adapter->process(inL.data() + readPos, inR.data() + readPos,
+                                 outL.data(), outR.data(), c.blockSize, *engine);
+                readPos += static_cast<size_t>(c.blockSize);
+            }
+        };
+
+        const auto blocksPerSecond = static_cast<int64_t>(c.sampleRate / c.blockSize) + 1;
+        runBlocks(blocksPerSecond / 4);
+
+        const auto numBlocks = std::max<int64_t>(1, static_cast<int64_t>(seconds * c.sampleRate / c.blockSize));
+
+        const auto start = std::chrono::steady_clock::now();
+        runBlocks(numBlocks);
+        const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const double samples = static_cast<double>(numBlocks) * c.blockSize;
+        return { c, wall * 1.0e9 / samples, (samples / c.sampleRate) / wall, wall };
+    }
+
+    void writeJson(std::ostream& out, const std::vector<Result>& results, double seconds)
+    {
+        out << std::setprecision(6);
+        out << "{\n";
+        out << "  \"benchmark\": \"clouds_throughput\",\n";
+        out << "  \"kernels\": \"" << EngineKernels::getInstructionSetName() << "\",\n";
+        out << "  \"engineRate\": " << SampleRateAdapter::kInternalSampleRate << ",\n";
+        out << "  \"secondsPerCase\": " << seconds << ",\n";
+        out << "  \"results\": [\n";
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& r = results[i];
+            out << "    { \"mode\": \"" << kModeNames[r.c.mode] << "\", \"quality\": " << r.c.quality
+                << ", \"sampleRate\": " << r.c.sampleRate << ", \"blockSize\": " << r.c.blockSize
+                << ", \"nsPerSample\": " << r.nsPerSample << ", \"realtimeFactor\": " << r.realtimeFactor
+                << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+
+        out << "  ]\n";
+        out << "}\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = 2.0;
+    bool quick = false;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc)
+            seconds = std::max(0.01, std::atof(argv[++i]));
+        else if (arg == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (arg == "--quick")
+            quick = true;
+        else
+        {
+            std::cerr << "usage: ThroughputBenchmark [--seconds s] [--quick] [--out results.json]" << std::endl;
+            return 1;
+        }
+    }
+
+    const std::vector<double> sampleRates = quick ? std::vector<double> { 48000.0 }
+                                                  : std::vector<double> { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+    const std::vector<int> blockSizes = quick ? std::vector<int> { 512 }
+                                              : std::vector<int> { 32, 64, 128, 256, 512, 1024, 2048 };
+
+    std::vector<Result> results;
+
+    for (int mode = 0; mode < 4; ++mode)
+        for (int quality = 0; quality < 4; ++quality)
+            for (auto rate : sampleRates)
+                for (auto block : blockSizes)
+                {
+                    const auto r = runCase({ mode, quality, rate, block }, seconds);
+                    results.push_back(r);
+
+                    std::cerr << std::fixed << std::setprecision(1)
+                              << std::setw(9) << kModeNames[mode] << " q" << quality
+                              << std::setw(9) << rate << " Hz" << std::setw(6) << block
+                              << std::setprecision(2) << std::setw(10) << r.nsPerSample << " ns/sample"
+                              << std::setprecision(1) << std::setw(8) << r.realtimeFactor << "x realtime"
+                              << std::endl;
+                }
+
+    if (outPath.empty())
+    {
+        writeJson(std::cout, results, seconds);
+    }
+    else
+    {
+        std::ofstream file(outPath);
+        writeJson(file, results, seconds);
+        if (!file)
+        {
+            std::cerr << "cannot write " << outPath << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+#include "TraceRecorder.h"
+#include "stmlib/utils/random.h"
+
+#include <random>
+#include <vector>
+
+//==============================================================================
+// TraceRecorder / TraceReader: a recorded session replays bit for bit.
+//==============================================================================
+class TraceReplayTests : public juce::UnitTest
+{
+public:
+    TraceReplayTests() : juce::UnitTest("Trace Replay Tests") {}
+
+    void runTest() override
+    {
+        const auto file = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                              .getChildFile("clouds_trace_test.cltr");
+
+        beginTest("Replay reproduces the recorded output");
+        {
+            std::vector<float> recorded;
+            {
+                auto engine = std::make_unique<CloudsEngine>();
+                auto adapter = std::make_unique<SampleRateAdapter>();
+                engine->init();
+                adapter->prepare(kSampleRate, kMaxBlock);
+                stmlib::Random::Seed(0xc10d);
+
+                TraceRecorder recorder;
+                expect(recorder.start(file, *engine, *adapter, kSampleRate, kMaxBlock), "start failed");
+                adapter->setTraceRecorder(&recorder);
+                recorded = runSession(*engine, *adapter);
+                recorder.stop();
+                expect(!recorder.hasOverflowed());
+            }
+
+            // Different global RNG state in between; restore must reseed it.
+            stmlib::Random::Seed(0x1234);
+
+            TraceReader reader;
+            juce::String error;
+            expect(reader.open(file, error), error);
+            expectEquals(reader.getHeader().maxBlockSize, kMaxBlock);
+
+            // The second pass re-inits the engine the first one ran.
+            auto engine = std::make_unique<CloudsEngine>();
+            auto adapter = std::make_unique<SampleRateAdapter>();
+
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                expect(reader.restore(*engine, *adapter), "restore failed");
+                reader.rewind();
+
+                TraceReader::Event event;
+                const auto replayed = replay(reader, *engine, *adapter, event);
+                expect(event.tag == TraceFormat::kEnd, "Trace should end with an End record");
+                expectEquals(static_cast<int>(replayed.size()), static_cast<int>(recorded.size()));
+                expect(replayed == recorded, "Replay diverges from the recorded output");
+            }
+        }
+
+        beginTest("Replay restores the adapter configuration and host rate estimates");
+        {
+            // Mono in, varispeed with a moving estimate, long kernels and
+            // latency compensation: none of them the defaults a fresh
+            // engine and adapter start from.
+            std::vector<float> recorded;
+            {
+                auto engine = std::make_unique<CloudsEngine>();
+                auto adapter = std::make_unique<SampleRateAdapter>();
+                engine->init();
+                engine->setLatencyCompensation(true);
+                adapter->setBusLayout(1, 2);
+                adapter->setVarispeed(true);
+                adapter->setResamplerQuality(PolyphaseResampler::Quality::Long);
+                adapter->prepare(kSampleRate, kMaxBlock, engine->getLatencySamples());
+                stmlib::Random::Seed(0xc10d);
+
+                TraceRecorder recorder;
+                expect(recorder.start(file, *engine, *adapter, kSampleRate, kMaxBlock), "start failed");
+                adapter->setTraceRecorder(&recorder);
+                recorded = runSession(*engine, *adapter, true);
+                recorder.stop();
+                expect(!recorder.hasOverflowed());
+            }
+
+            TraceReader reader;
+            juce::String error;
+            expect(reader.open(file, error), error);
+
+            const auto& header = reader.getHeader();
+            expectEquals(header.numInputChannels, 1);
+            expectEquals(header.varispeed, 1u);
+            expectEquals(header.latencyCompensation, 1u);
+
+            int hostRates = 0;
+            TraceReader::Event event;
+            while (reader.next(event))
+                hostRates += event.tag == TraceFormat::kHostRate ? 1 : 0;
+            expectGreaterThan(hostRates, 100);
+
+            auto engine = std::make_unique<CloudsEngine>();
+            auto adapter = std::make_unique<SampleRateAdapter>();
+            expect(reader.restore(*engine, *adapter), "restore failed");
+            reader.rewind();
+
+            const auto replayed = replay(reader, *engine, *adapter, event);
+            expect(adapter->isVarispeed());
+            expect(engine->getLatencyCompensation());
+            expectEquals(static_cast<int>(replayed.size()), static_cast<int>(recorded.size()));
+            expect(replayed == recorded, "Replay diverges from the recorded output");
+        }
+
+        beginTest("Recording only starts right after init() and prepare()");
+        {
+            auto engine = std::make_unique<CloudsEngine>();
+            auto adapter = std::make_unique<SampleRateAdapter>();
+            TraceRecorder recorder;
+            expect(!recorder.start(file, *engine, *adapter, kSampleRate, kMaxBlock), "Uninitialised engine accepted");
+
+            engine->init();
+            adapter->prepare(kSampleRate, kMaxBlock);
+
+            std::vector<float> in(static_cast<size_t>(kMaxBlock), 0.1f), out(static_cast<size_t>(kMaxBlock));
+            adapter->process(in.data(), in.data(), out.data(), out.data(), kMaxBlock, *engine);
+            expect(!recorder.start(file, *engine, *adapter, kSampleRate, kMaxBlock), "Engine that has run accepted");
+
+            engine->init();
+            expect(!recorder.start(file, *engine, *adapter, kSampleRate, kMaxBlock), "Adapter that has run accepted");
+
+            adapter->prepare(kSampleRate, kMaxBlock);
+            expect(recorder.start(file, *engine, *adapter, kSampleRate, kMaxBlock));
+            recorder.stop();
+        }
+
+        beginTest("Overflow ends the trace cleanly");
+        {
+            auto engine = std::make_unique<CloudsEngine>();
+            auto adapter = std::make_unique<SampleRateAdapter>();
+            engine->init();
+            adapter->prepare(kSampleRate, kMaxBlock);
+
+            // Far too small for one second of audio; the writer cannot keep up.
+            TraceRecorder recorder(16 << 10);
+            expect(recorder.start(file, *engine, *adapter, kSampleRate, kMaxBlock));
+            adapter->setTraceRecorder(&recorder);
+
+            std::vector<float> in(static_cast<size_t>(kMaxBlock), 0.1f), out(static_cast<size_t>(kMaxBlock));
+            for (int b = 0; b < 200; ++b)
+                adapter->process(in.data(), in.data(), out.data(), out.data(), kMaxBlock, *engine);
+            recorder.stop();
+            expect(recorder.hasOverflowed());
+
+            TraceReader reader;
+            juce::String error;
+            expect(reader.open(file, error), error);
+
+            TraceReader::Event event;
+            int blocks = 0;
+            while (reader.next(event))
+                blocks += event.tag == TraceFormat::kBlock ? 1 : 0;
+
+            expect(event.tag == TraceFormat::kOverflow);
+            expect(blocks > 0 && blocks < 200);
+        }
+
+        beginTest("Truncated and foreign files");
+        {
+            juce::MemoryBlock data;
+            expect(file.loadFileAsData(data));
+
+            // Cut in the middle of the records: reads up to the cut, then stops.
+            const auto truncated = file.getSiblingFile("clouds_trace_truncated.cltr");
+            truncated.replaceWithData(data.getData(), data.getSize() - 7);
+
+            TraceReader reader;
+            juce::String error;
+            expect(reader.open(truncated, error), error);
+            TraceReader::Event event;
+            while (reader.next(event)) {}
+            expect(event.tag != TraceFormat::kEnd && event.tag != TraceFormat::kOverflow);
+
+            // Cut inside the header
+            truncated.replaceWithData(data.getData(), 10);
+            expect(!reader.open(truncated, error));
+
+            static_cast<uint8_t*>(data.getData())[0] ^= 0xff;
+            truncated.replaceWithData(data.getData(), data.getSize());
+            expect(!reader.open(truncated, error));
+
+            truncated.deleteFile();
+        }
+
+        file.deleteFile();
+    }
+
+private:
+    static constexpr double kSampleRate = 44100.0;
+    static constexpr int kMaxBlock = 512;
+
+    // Random host block sizes with automation, mode switches, freeze,
+    // triggers and bypass between callbacks, and with drift a host rate
+    // estimate that wanders around kSampleRate. Returns the interleaved
+    // output.
+    static std::vector<float> runSession(CloudsEngine& engine, SampleRateAdapter& adapter, bool drift = false)
+    {
+        std::mt19937 rng(7);
+        auto uniform = [&rng](float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); };
+
+        std::vector<float> inL(static_cast<size_t>(kMaxBlock)), inR(static_cast<size_t>(kMaxBlock));
+        std::vector<float> outL(static_cast<size_t>(kMaxBlock)), outR(static_cast<size_t>(kMaxBlock));
+        std::vector<float> result;
+        double phase = 0.0;
+
+        for (int callback = 0; callback < 300; ++callback)
+        {
+            const int n = std::uniform_int_distribution<int>(1, kMaxBlock)(rng);
+
+            engine.setPosition(uniform(0.0f, 1.0f));
+            engine.setDensity(uniform(0.3f, 0.9f));
+            engine.setDryWet(0.7f);
+            if (callback % 60 == 30)
+                engine.setPlaybackMode((callback / 60) % 4);
+            if (callback % 45 == 20)
+                engine.setFreeze(callback % 90 == 20);
+            if (callback % 7 == 0)
+            {
+                engine.setTrigger(true);
+                if (callback % 14 == 0)
+                    engine.setTrigger(true);
+            }
+            adapter.setBypass(callback >= 200 && callback < 230);
+            if (drift)
+                adapter.setHostRateEstimate(kSampleRate * (1.0 + 0.005 * std::sin(0.05 * callback)));
+
+            for (int i = 0; i < n; ++i)
+            {
+                phase += 330.0 / kSampleRate;
+                phase -= std::floor(phase);
+                inL[static_cast<size_t>(i)] = 0.5f * static_cast<float>(std::sin(6.283185307179586 * phase));
+                inR[static_cast<size_t>(i)] = 0.5f * static_cast<float>(std::sin(6.283185307179586 * 1.5 * phase));
+            }
+
+            adapter.process(inL.data(), inR.data(), outL.data(), outR.data(), n, engine);
+            append(result, outL.data(), outR.data(), n);
+        }
+        return result;
+    }
+
+    static std::vector<float> replay(TraceReader& reader, CloudsEngine& engine, SampleRateAdapter& adapter,
+                                     TraceReader::Event& event)
+    {
+        std::vector<float> outL(static_cast<size_t>(kMaxBlock)), outR(static_cast<size_t>(kMaxBlock));
+        std::vector<float> result;
+
+        while (reader.next(event))
+        {
+            switch (event.tag)
+            {
+                case TraceFormat::kParameters: engine.setParameters(event.parameters); break;
+                case TraceFormat::kFreeze:     engine.setFreeze(event.state); break;
+                case TraceFormat::kBypass:     adapter.setBypass(event.state); break;
+                case TraceFormat::kHostRate:   adapter.setHostRateEstimate(event.hostRate); break;
+
+                case TraceFormat::kTrigger:
+                    for (uint32_t t = 0; t < event.triggers; ++t)
+                        engine.setTrigger(true);
+                    break;
+
+                case TraceFormat::kBlock:
+                    adapter.process(event.left, event.right, outL.data(), outR.data(), event.numSamples, engine);
+                    append(result, outL.data(), outR.data(), event.numSamples);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+        return result;
+    }
+
+    static void append(std::vector<float>& dest, const float* l, const float* r, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            dest.push_back(l[i]);
+            dest.push_back(r[i]);
+        }
+    }
+};
+
+static TraceReplayTests traceReplayTests;
@@ -0,0 +1,183 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "CloudsEngine.h"
+#include "DriftEstimator.h"
+#include "PolyphaseResampler.h"
+#include "SampleRateAdapter.h"
+
+#include <vector>
+
+//==============================================================================
+// DriftEstimator and SampleRateAdapter's varispeed mode.
+//==============================================================================
+class VarispeedTests : public juce::UnitTest
+{
+public:
+    VarispeedTests() : juce::UnitTest("Varispeed Tests") {}
+
+    void runTest() override
+    {
+        beginTest("Drift estimator locks onto a drifting host clock through jitter");
+        {
+            auto random = getRandom();
+
+            for (auto ppm : { -150.0, 0.0, 100.0 })
+            {
+                constexpr double kNominal = 48000.0;
+                const double actual = kNominal * (1.0 + ppm * 1.0e-6);
+
+                DriftEstimator estimator;
+                estimator.reset(kNominal);
+
+                // 40 s of 256-sample callbacks, timestamps jittered by up to
+                // 100 us either way.
+                double time = 3.0;
+                for (int callback = 0; callback < 7500; ++callback)
+                {
+                    const double jitter = 2.0e-4 * (random.nextDouble() - 0.5);
+                    estimator.update(time + jitter, 256);
+                    time += 256.0 / actual;
+                }
+
+                const auto name = juce::String(ppm) + " ppm";
+                expectEquals(static_cast<int>(estimator.getNumUpdates()), 7500, name);
+                expectWithinAbsoluteError(estimator.getDriftPpm(), ppm, 5.0, name);
+                expectWithinAbsoluteError(estimator.getSampleRate(), actual, 0.25, name);
+            }
+        }
+
+        beginTest("Drift estimator restarts after a clock jump");
+        {
+            DriftEstimator estimator;
+            estimator.reset(44100.0);
+
+            double time = 0.0;
+            for (int callback = 0; callback < 1000; ++callback, time += 512.0 / 44100.0)
+                estimator.update(time, 512);
+
+            // A dropout: the next callback is a second late.
+            time += 1.0;
+            estimator.update(time, 512);
+            expectEquals(static_cast<int>(estimator.getNumUpdates()), 1);
+            expectWithinAbsoluteError(estimator.getDriftPpm(), 0.0, 5.0);
+        }
+
+        beginTest("Only the Generic resampler path takes a varispeed ratio");
+        {
+            PolyphaseResampler resampler;
+            resampler.prepare(44100.0, 32000.0, PolyphaseResampler::Quality::Medium, 256);
+            expect(!resampler.setRatio(1.4));
+
+            resampler.prepare(44100.0, 32000.0, PolyphaseResampler::Quality::Medium, 256, false);
+            expect(resampler.setRatio(1.4));
+            expectEquals(resampler.getRatioDenominator(), PolyphaseResampler::kVarispeedDenominator);
+            expect(!resampler.setRatio(0.0));
+        }
+
+        beginTest("Varispeed follows the host rate without clicks, resets or underruns");
+        {
+            for (auto rate : { 32000.0, 44100.0, 48000.0, 96000.0 })
+                checkGlide(rate);
+        }
+
+        beginTest("Varispeed keeps the nominal latency");
+        {
+            CloudsEngine engine;
+            engine.init();
+
+            SampleRateAdapter adapter;
+            adapter.prepare(48000.0, 512);
+            const int fixed = adapter.getLatencySamples(engine);
+
+            adapter.setVarispeed(true);
+            adapter.prepare(48000.0, 512);
+            expectWithinAbsoluteError(adapter.getLatencySamples(engine), fixed, 8);
+
+            // 32 kHz resamples too under varispeed.
+            adapter.prepare(32000.0, 512);
+            expectGreaterThan(adapter.getLatencySamples(engine), SampleRateAdapter::kBlockSize);
+        }
+    }
+
+private:
+    // A 1 kHz sine through the dry path while the host rate estimate swings
+    // 0.5% up and back. A click or a reset would show as a jump in the
+    // sine's second difference.
+    void checkGlide(double rate)
+    {
+        CloudsEngine engine;
+        engine.init();
+        engine.setDryWet(0.0f);
+
+        constexpr int kHostBlockSize = 256;
+        SampleRateAdapter adapter;
+        adapter.setVarispeed(true);
+        adapter.setScheduling(SampleRateAdapter::Scheduling::Constant);   // ignored under varispeed
+        adapter.prepare(rate, kHostBlockSize);
+
+        const int latency = adapter.getLatencySamples(engine);
+        const int numCallbacks = static_cast<int>(6.0 * rate) / kHostBlockSize;
+        const double increment = 2.0 * 3.14159265358979323846 * 1000.0 / rate;
+
+        std::vector<float> in(kHostBlockSize), outL(kHostBlockSize), outR(kHostBlockSize);
+        double phase = 0.0;
+        float previous[2] = { 0.0f, 0.0f };
+        float maxSecondDifference = 0.0f, minPeak = 1.0f, blockPeak = 0.0f;
+        int mispredicted = 0, blocksSincePeak = 0;
+        int64_t sample = 0;
+
+        auto& telemetry = engine.getTelemetry();
+
+        for (int callback = 0; callback < numCallbacks; ++callback)
+        {
+            // Up 0.5% over the second second, back over the fourth.
+            const double seconds = static_cast<double>(sample) / rate;
+            const double target = seconds < 1.0 ? rate
+                                : seconds < 3.0 ? rate * 1.005
+                                                : rate;
+            adapter.setHostRateEstimate(target + rate * 1.0e-4 * std::sin(seconds));
+
+            for (auto& x : in)
+            {
+                x = 0.5f * static_cast<float>(std::sin(phase));
+                phase += increment;
+            }
+
+            const int predicted = adapter.getEngineBlocksForCallback(kHostBlockSize);
+            telemetry.reset();
+            adapter.process(in.data(), in.data(), outL.data(), outR.data(), kHostBlockSize, engine);
+            mispredicted += telemetry.getNumReady() != predicted ? 1 : 0;
+
+            for (int i = 0; i < kHostBlockSize; ++i, ++sample)
+            {
+                const float x = outL[static_cast<size_t>(i)];
+                if (sample > latency + static_cast<int64_t>(rate / 2))
+                {
+                    maxSecondDifference = std::max(maxSecondDifference, std::abs(x - 2.0f * previous[1] + previous[0]));
+                    blockPeak = std::max(blockPeak, std::abs(x));
+                    if (++blocksSincePeak == static_cast<int>(rate / 100))
+                    {
+                        minPeak = std::min(minPeak, blockPeak);
+                        blockPeak = 0.0f;
+                        blocksSincePeak = 0;
+                    }
+                }
+                previous[0] = previous[1];
+                previous[1] = x;
+            }
+        }
+
+        // A sine of amplitude A at w rad/sample has second differences up to
+        // A * w^2 (the dry path's tanh keeps A under 0.5).
+        const float bound = static_cast<float>(0.5 * increment * increment * 1.05 + 2.0e-3);
+        const auto name = juce::String(rate) + " Hz";
+
+        expectLessThan(maxSecondDifference, bound, name);
+        expectGreaterThan(minPeak, 0.3f, name);
+        expectEquals(mispredicted, 0, name);
+        expectEquals(static_cast<int>(adapter.getUnderruns()), 0, name);
+        expectEquals(adapter.getLatencySamples(engine), latency, name);
+        expectWithinAbsoluteError(adapter.getCurrentHostRate(), rate * (1.0 + 1.0e-4 * std::sin(6.0)), rate * 1.0e-4, name);
+    }
+};
+
+static VarispeedTests varispeedTests;
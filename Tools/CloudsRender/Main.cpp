@@ -0,0 +1,421 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+#include "stmlib/utils/random.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Offline renderer for the SampleRateAdapter + CloudsEngine chain.
+//
+//   CloudsRender [options] input.wav [input2.wav ...]
+//
+//   --out-dir <dir>       where to write results (default: next to each input)
+//   --suffix <text>       appended to the output file name (default "_clouds")
+//   --spec <file.json>    parameters, see RenderSpec::loadJson
+//   --jobs <n>            files rendered at once (default: all cores)
+//   --tail <seconds>      silence rendered after the input (default 4)
+//   --bits <16|24|32>     output bit depth (default 24; 32 = float)
+//   --<parameter> <value> any RenderSpec parameter, overriding the spec file
+//
+// stmlib::Random is one global shared by every GranularProcessor in the
+// process, so files are never rendered on threads side by side: with more
+// than one job, each file is rendered by a child CloudsRender process of its
+// own (--jobs 1), and the RNG is re-seeded per file. Every render is then
+// bit-for-bit repeatable, whatever --jobs is.
+//
+// A process renders its files one after the other with one engine and one
+// adapter. Engines are cloned from a warmed-up golden engine that already
+// holds the spec, instead of going through init() for every file. Inputs
+// are memory-mapped; outputs go through a large FileOutputStream buffer in
+// kChunkSize blocks.
+//
+// The chain's output trails its input by the adapter's latency. That much
+// more is rendered and dropped from the front, so the output lines up with
+// the input and is as long as the input plus the tail.
+namespace
+{
+    constexpr int kChunkSize = 4096;
+    constexpr size_t kWriteBufferBytes = 4 << 20;
+
+    struct RenderSpec
+    {
+        EngineParameters parameters;
+        bool freeze = false;
+        bool hostDryWet = false;
+        double tailSeconds = 4.0;
+        int bitsPerSample = 24;
+        uint32_t seed = 0x1234;
+
+        // Keys match the plugin's parameter IDs where there is one:
+        // position, size, pitch, density, texture, dry_wet, spread, feedback,
+        // reverb, input_trim, output_gain, mode, quality, freeze, host_dry_wet,
+        // tail, bits, seed.
+        bool set(const juce::String& key, const juce::var& value)
+        {
+            auto& p = parameters;
+            if (key == "position")          p.position = static_cast<float>(value);
+            else if (key == "size")         p.size = static_cast<float>(value);
+            else if (key == "pitch")        p.pitch = static_cast<float>(value);
+            else if (key == "density")      p.density = static_cast<float>(value);
+            else if (key == "texture")      p.texture = static_cast<float>(value);
+            else if (key == "dry_wet")      p.dryWet = static_cast<float>(value);
+            else if (key == "spread")       p.stereoSpread = static_cast<float>(value);
+            else if (key == "feedback")     p.feedback = static_cast<float>(value);
+            else if (key == "reverb")       p.reverb = static_cast<float>(value);
+            else if (key == "input_trim")   p.inputTrim = static_cast<float>(value);
+            else if (key == "output_gain")  p.outputGain = static_cast<float>(value);
+            else if (key == "mode")         p.playbackMode = juce::jlimit(0, 3, static_cast<int>(value));
+            else if (key == "quality")      p.quality = juce::jlimit(0, 3, static_cast<int>(value));
+            else if (key == "freeze")       freeze = static_cast<bool>(value);
+            else if (key == "host_dry_wet") hostDryWet = static_cast<bool>(value);
+            else if (key == "tail")         tailSeconds = std::max(0.0, static_cast<double>(value));
+            else if (key == "bits")         bitsPerSample = static_cast<int>(value);
+            else if (key == "seed")         seed = static_cast<uint32_t>(static_cast<int>(value));
+            else
+                return false;
+
+            return true;
+        }
+
+        // { "position": 0.3, "mode": 2, ... } with the keys listed in set().
+        bool loadJson(const juce::File& file, juce::String& error)
+        {
+            const auto json = juce::JSON::parse(file);
+            auto* object = json.getDynamicObject();
+
+            if (object == nullptr)
+            {
+                error = "cannot parse " + file.getFullPathName();
+                return false;
+            }
+
+            for (const auto& property : object->getProperties())
+            {
+                if (!set(property.name.toString(), property.value))
+                {
+                    error = "unknown key or value '" + property.name.toString() + "' in " + file.getFileName();
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    struct Job
+    {
+        juce::File input;
+        juce::File output;
+        bool ok = false;
+        juce::String error;
+        double seconds = 0.0;
+        int64_t frames = 0;
+    };
+
+    class Renderer
+    {
+    public:
+        Renderer(const RenderSpec& spec, const CloudsEngine& golden)
+            : spec_(spec), golden_(golden) {}
+
+        void render(Job& job)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            job.ok = renderFile(job);
+            job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        bool renderFile(Job& job)
+        {
+            juce::WavAudioFormat wav;
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(wav.createMemoryMappedReader(job.input));
+
+            if (reader == nullptr || !reader->mapEntireFile())
+            {
+                job.error = "cannot map " + job.input.getFullPathName();
+                return false;
+            }
+
+            const double sampleRate = reader->sampleRate;
+            const auto inputFrames = reader->lengthInSamples;
+            const auto tailFrames = static_cast<int64_t>(spec_.tailSeconds * sampleRate);
+            const int numInputChannels = static_cast<int>(reader->numChannels);
+
+            job.output.deleteFile();
+            auto stream = std::make_unique<juce::FileOutputStream>(job.output, kWriteBufferBytes);
+            if (stream->failedToOpen())
+            {
+                job.error = "cannot write " + job.output.getFullPathName();
+                return false;
+            }
+
+            std::unique_ptr<juce::AudioFormatWriter> writer(
+                wav.createWriterFor(stream.get(), sampleRate, 2,
+                                    spec_.bitsPerSample, {}, 0));
+            if (writer == nullptr)
+            {
+                job.error = "unsupported output format (" + juce::String(spec_.bitsPerSample) + " bit)";
+                return false;
+            }
+            stream.release();   // owned by the writer now
+
+            stmlib::Random::Seed(spec_.seed);
+
+            if (!engine_.cloneFrom(golden_))
+            {
+                job.error = "cannot clone engine";
+                return false;
+            }
+            engine_.setHostDryWet(spec_.hostDryWet);
+            adapter_.setBusLayout(numInputChannels > 1 ? 2 : 1, 2);
+            adapter_.prepare(sampleRate, kChunkSize, engine_.getLatencySamples(), engine_.getSampleRate());
+
+            const int latency = adapter_.getLatencySamples(engine_);
+            const int64_t renderFrames = latency + inputFrames + tailFrames;
+
+            juce::AudioBuffer<float> in(std::max(2, numInputChannels), kChunkSize);
+            juce::AudioBuffer<float> out(2, kChunkSize);
+
+            for (int64_t position = 0; position < renderFrames; position += kChunkSize)
+            {
+                const int n = static_cast<int>(std::min<int64_t>(kChunkSize, renderFrames - position));
+                const int fromFile = static_cast<int>(juce::jlimit<int64_t>(0, n, inputFrames - position));
+                const int skip = static_cast<int>(juce::jlimit<int64_t>(0, n, latency - position));
+
+                in.clear();
+                if (fromFile > 0)
+                    reader->read(&in, 0, fromFile, position, true, true);
+
+                const float* l = in.getReadPointer(0);
+                const float* r = numInputChannels > 1 ? in.getReadPointer(1) : l;
+
+                adapter_.process(l, r, out.getWritePointer(0), out.getWritePointer(1), n, engine_);
+
+                if (skip < n && !writer->writeFromAudioSampleBuffer(out, skip, n - skip))
+                {
+                    job.error = "write failed for " + job.output.getFullPathName();
+                    return false;
+                }
+            }
+
+            job.frames = inputFrames + tailFrames;
+            return true;
+        }
+
+        const RenderSpec& spec_;
+        const CloudsEngine& golden_;
+        CloudsEngine engine_;
+        SampleRateAdapter adapter_;
+    };
+
+    // Renders the jobs one after the other in this process.
+    void renderInProcess(std::vector<Job>& jobs, const RenderSpec& spec)
+    {
+        // One golden engine; every file starts from an exact copy of it. It
+        // runs on silence with the spec applied first, so smoothing has
+        // settled and the playback mode is active before the first input
+        // sample.
+        CloudsEngine golden;
+        golden.init();
+        golden.setHostDryWet(spec.hostDryWet);
+        golden.setParameters(spec.parameters);
+        golden.setFreeze(spec.freeze);
+        {
+            float silence[CloudsEngine::kBlockSize] = {}, outL[CloudsEngine::kBlockSize], outR[CloudsEngine::kBlockSize];
+            for (int b = 0; b < 400; ++b)
+                golden.process(silence, silence, outL, outR, CloudsEngine::kBlockSize);
+        }
+
+        auto renderer = std::make_unique<Renderer>(spec, golden);
+        for (auto& job : jobs)
+            renderer->render(job);
+    }
+
+    // Renders jobs[i] in a CloudsRender child process each, numJobs at a time.
+    void renderInChildProcesses(std::vector<Job>& jobs, const juce::StringArray& options, int numJobs)
+    {
+        struct Running
+        {
+            Job* job;
+            std::unique_ptr<juce::ChildProcess> process;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        const auto executable = juce::File::getSpecialLocation(juce::File::currentExecutableFile).getFullPathName();
+        std::vector<Running> running;
+        size_t next = 0;
+
+        while (next < jobs.size() || !running.empty())
+        {
+            while (next < jobs.size() && static_cast<int>(running.size()) < numJobs)
+            {
+                auto& job = jobs[next++];
+                juce::StringArray command(executable);
+                command.addArray(options);
+                command.add("--jobs");
+                command.add("1");
+                command.add(job.input.getFullPathName());
+
+                auto process = std::make_unique<juce::ChildProcess>();
+                if (!process->start(command, juce::ChildProcess::wantStdErr))
+                {
+                    job.error = "cannot start " + executable;
+                    continue;
+                }
+                running.push_back({ &job, std::move(process), std::chrono::steady_clock::now() });
+            }
+
+            for (auto it = running.begin(); it != running.end();)
+            {
+                if (it->process->isRunning())
+                {
+                    ++it;
+                    continue;
+                }
+
+                // The child reports a failure as "FAILED <input>: <error>".
+                auto& job = *it->job;
+                const auto output = it->process->readAllProcessOutput().trim();
+                const auto prefix = "FAILED " + job.input.getFullPathName() + ": ";
+                job.ok = it->process->getExitCode() == 0;
+                job.error = output.startsWith(prefix) ? output.substring(prefix.length()) : output;
+                job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - it->start).count();
+                it = running.erase(it);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    void printUsage()
+    {
+        std::cerr << "usage: CloudsRender [--out-dir dir] [--suffix text] [--spec file.json] [--jobs n]\n"
+                     "                    [--tail seconds] [--bits 16|24|32] [--<parameter> value ...]\n"
+                     "                    input.wav [input2.wav ...]" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    RenderSpec spec;
+    juce::File outDir;
+    juce::String suffix = "_clouds";
+    int numJobs = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<Job> jobs;
+
+    // Everything but --jobs and the inputs, for the child processes.
+    juce::StringArray options;
+
+    // The spec file is applied first so command-line values override it.
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (juce::String(argv[i]) == "--spec")
+        {
+            juce::String error;
+            if (!spec.loadJson(juce::File::getCurrentWorkingDirectory().getChildFile(argv[i + 1]), error))
+            {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg(argv[i]);
+
+        if (arg.startsWith("--"))
+        {
+            if (i + 1 >= argc)
+            {
+                printUsage();
+                return 1;
+            }
+
+            const juce::String value(argv[++i]);
+            const auto key = arg.substring(2);
+
+            if (key != "jobs")
+            {
+                options.add(arg);
+                options.add(value);
+            }
+
+            if (key == "spec")
+                continue;
+            if (key == "out-dir")
+                outDir = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            else if (key == "suffix")
+                suffix = value;
+            else if (key == "jobs")
+                numJobs = std::max(1, value.getIntValue());
+            else if (!spec.set(key.replaceCharacter('-', '_'), value.containsOnly("0123456789.-")
+                                                                  ? juce::var(value.getDoubleValue())
+                                                                  : juce::var(value)))
+            {
+                std::cerr << "unknown option or value " << arg << " " << value << std::endl;
+                printUsage();
+                return 1;
+            }
+            continue;
+        }
+
+        Job job;
+        job.input = juce::File::getCurrentWorkingDirectory().getChildFile(arg);
+        const auto dir = outDir == juce::File() ? job.input.getParentDirectory() : outDir;
+        job.output = dir.getChildFile(job.input.getFileNameWithoutExtension() + suffix + ".wav");
+        jobs.push_back(job);
+    }
+
+    if (jobs.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (outDir != juce::File())
+        outDir.createDirectory();
+
+    numJobs = std::min(numJobs, static_cast<int>(jobs.size()));
+    const auto start = std::chrono::steady_clock::now();
+
+    if (numJobs > 1)
+        renderInChildProcesses(jobs, options, numJobs);
+    else
+        renderInProcess(jobs, spec);
+
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failures = 0;
+    int64_t totalFrames = 0;
+    for (const auto& job : jobs)
+    {
+        if (job.ok)
+        {
+            totalFrames += job.frames;
+            std::cout << job.output.getFullPathName() << "  (" << job.seconds << " s)" << std::endl;
+        }
+        else
+        {
+            ++failures;
+            std::cerr << "FAILED " << job.input.getFullPathName() << ": " << job.error << std::endl;
+        }
+    }
+
+    // Child processes only report success or failure.
+    std::cout << jobs.size() - static_cast<size_t>(failures) << "/" << jobs.size() << " files";
+    if (numJobs == 1)
+        std::cout << ", " << totalFrames << " frames";
+    std::cout << " in " << wallSeconds << " s";
+    if (numJobs > 1)
+        std::cout << " on " << numJobs << " processes";
+    std::cout << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "CloudsEngine.h"
+#include "SampleRateAdapter.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Replays a trace written by TraceRecorder through a fresh engine.
+//
+//   CloudsReplay [--loops n] [--out output.wav] trace.cltr
+//
+// Every loop re-inits the engine and prepares the adapter with the
+// configuration in the trace, restores the RNG state and feeds the recorded
+// callbacks, in their original sizes, to a SampleRateAdapter. The output is therefore identical on every
+// loop and to what the host heard, which makes a captured session usable
+// for profiling (run under perf / VTune with a high --loops) and for
+// regression checks (compare the printed hash before and after a change).
+//
+// Prints the FNV-1a hash of the output and p50 / p99 / max of the
+// per-callback time as a fraction of its deadline. --out writes the first
+// loop as a 32-bit float WAV.
+namespace
+{
+    uint64_t fnv1a(uint64_t hash, const float* data, int numSamples)
+    {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < sizeof(float) * static_cast<size_t>(numSamples); ++i)
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        return hash;
+    }
+
+    double percentile(std::vector<float>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+
+        const auto index = static_cast<size_t>(std::min<double>(static_cast<double>(sorted.size() - 1),
+                                                                std::ceil(p / 100.0 * static_cast<double>(sorted.size())) - 1.0));
+        return sorted[index];
+    }
+
+    void printUsage()
+    {
+        std::cerr << "usage: CloudsReplay [--loops n] [--out output.wav] trace.cltr" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int loops = 1;
+    juce::File outFile, traceFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const juce::String arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--loops" && hasValue)
+            loops = std::max(1, juce::String(argv[++i]).getIntValue());
+        else if (arg == "--out" && hasValue)
+            outFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (!arg.startsWith("--") && traceFile == juce::File())
+            traceFile = juce::File::getCurrentWorkingDirectory().getChildFile(arg);
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (traceFile == juce::File())
+    {
+        printUsage();
+        return 1;
+    }
+
+    TraceReader reader;
+    juce::String error;
+    if (!reader.open(traceFile, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    const auto& header = reader.getHeader();
+    auto engine = std::make_unique<CloudsEngine>();
+    auto adapter = std::make_unique<SampleRateAdapter>();
+
+    std::vector<float> outL(static_cast<size_t>(header.maxBlockSize));
+    std::vector<float> outR(static_cast<size_t>(header.maxBlockSize));
+    std::vector<float> loads;
+
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    if (outFile != juce::File())
+    {
+        outFile.deleteFile();
+        auto stream = std::make_unique<juce::FileOutputStream>(outFile);
+        juce::WavAudioFormat wav;
+        if (!stream->failedToOpen())
+            writer.reset(wav.createWriterFor(stream.get(), header.sampleRate, 2, 32, {}, 0));
+        if (writer == nullptr)
+        {
+            std::cerr << "cannot write " << outFile.getFullPathName() << std::endl;
+            return 1;
+        }
+        stream.release();   // owned by the writer now
+    }
+
+    uint64_t firstHash = 0;
+    bool deterministic = true;
+    TraceFormat::Tag endTag = TraceFormat::kEnd;
+
+    for (int loop = 0; loop < loops; ++loop)
+    {
+        if (!reader.restore(*engine, *adapter))
+        {
+            std::cerr << traceFile.getFileName() << ": cannot restore the recorded configuration" << std::endl;
+            return 1;
+        }
+        reader.rewind();
+
+        uint64_t hash = 0xcbf29ce484222325ull;
+        TraceReader::Event event;
+
+        while (reader.next(event))
+        {
+            switch (event.tag)
+            {
+                case TraceFormat::kParameters: engine->setParameters(event.parameters); break;
+                case TraceFormat::kFreeze:     engine->setFreeze(event.state); break;
+                case TraceFormat::kBypass:     adapter->setBypass(event.state); break;
+                case TraceFormat::kHostRate:   adapter->setHostRateEstimate(event.hostRate); break;
+
+                case TraceFormat::kTrigger:
+                    for (uint32_t t = 0; t < event.triggers; ++t)
+                        engine->setTrigger(true);
+                    break;
+
+                case TraceFormat::kBlock:
+                {
+                    const int n = event.numSamples;
+                    const auto start = std::chrono::steady_clock::now();
+                    adapter->process(event.left, event.right, outL.data(), outR.data(), n, *engine);
+                    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                    if (n > 0)
+                        loads.push_back(static_cast<float>(seconds * header.sampleRate / n));
+
+                    hash = fnv1a(fnv1a(hash, outL.data(), n), outR.data(), n);
+
+                    if (loop == 0 && writer != nullptr)
+                    {
+                        const float* channels[] = { outL.data(), outR.data() };
+                        writer->writeFromFloatArrays(channels, 2, n);
+                    }
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+        endTag = event.tag;
+
+        if (loop == 0)
+            firstHash = hash;
+        else if (hash != firstHash)
+            deterministic = false;
+    }
+
+    writer.reset();
+
+    std::sort(loads.begin(), loads.end());
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << "Callbacks: " << loads.size() / static_cast<size_t>(loops) << " x " << loops << " loops" << std::endl;
+    std::cout << "Load (fraction of deadline)  p50 " << percentile(loads, 50.0) << "  p99 " << percentile(loads, 99.0)
+              << "  max " << (loads.empty() ? 0.0 : loads.back()) << std::endl;
+    std::cout << "Output hash: " << std::hex << std::setw(16) << std::setfill('0') << firstHash << std::dec << std::endl;
+
+    if (endTag == TraceFormat::kOverflow)
+        std::cout << "Note: the recorder overflowed; the trace stops early" << std::endl;
+    else if (endTag != TraceFormat::kEnd)
+        std::cout << "Note: the trace is truncated" << std::endl;
+
+    if (!deterministic)
+    {
+        std::cout << "FAIL: output differs between loops" << std::endl;
+        return 1;
+    }
+    return 0;
+}